@@ -1,13 +1,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <time.h>
 #include "queue.h"
 #include "parse_input.h"
+#include "frontier.h"
 #include "bfs.h"
 
-// Function calculates IDs of cubes neighbouring to [cube]
-// and adds them to the [lab->queue].
-void add_adjacent_cubes(Labyrinth lab, size_t cube) {
+size_t get_neighbours(Labyrinth lab, size_t cube, size_t *neighbours) {
+    size_t count = 0;
     size_t dimensions = 1;
     // While calculating neighbouring cubes IDs, function checks if [cube] has
     // enough space for two adjacent cubes in both directions in each dimension.
@@ -16,33 +17,144 @@ void add_adjacent_cubes(Labyrinth lab, size_t cube) {
     size_t divider;
 
     for (size_t i = 0; i < get_dimensions_number(lab); i++) {
+        divider = dimensions * read_dimensions_array(lab, i);
         if (cube < get_size(lab) - dimensions) {
             size_t new_cube1 = cube + dimensions;
-            if (!get_bit_state(lab, new_cube1)) {
-                divider = dimensions * read_dimensions_array(lab, i);
-                if (new_cube1 / divider == cube / divider) {
-                    push(get_queue(lab), new_cube1);
-                    set_bit_state(lab, new_cube1);
-                }
-            }
+            if (new_cube1 / divider == cube / divider)
+                neighbours[count++] = new_cube1;
         }
         if (cube >= dimensions) {
             size_t new_cube2 = cube - dimensions;
-            if (!get_bit_state(lab, new_cube2)) {
-                divider = dimensions * read_dimensions_array(lab, i);
-                if (new_cube2 / divider == cube / divider) {
-                    push(get_queue(lab), new_cube2);
-                    set_bit_state(lab, new_cube2);
+            if (new_cube2 / divider == cube / divider)
+                neighbours[count++] = new_cube2;
+        }
+        dimensions = divider;
+    }
+    return count;
+}
+
+// Function marks free cubes neighbouring to [cube] as visited
+// and adds them to the [lab->queue].
+void add_adjacent_cubes(Labyrinth lab, size_t cube, size_t *neighbours) {
+    size_t count = get_neighbours(lab, cube, neighbours);
+    for (size_t i = 0; i < count; i++) {
+        if (!get_bit_state(lab, neighbours[i])) {
+            push(get_queue(lab), neighbours[i]);
+            set_bit_state(lab, neighbours[i]);
+        }
+    }
+}
+
+// Function returns the number of seconds that passed since [begin].
+double elapsed_time(struct timespec *begin) {
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    return (now.tv_sec - begin->tv_sec) + (now.tv_nsec - begin->tv_nsec) / 1e9;
+}
+
+// Function returns true if more than [limits->cells] cubes were expanded.
+bool cells_exceeded(Limits *limits, size_t cells) {
+    return limits->cells != 0 && cells > limits->cells;
+}
+
+// Function returns true if the search should be stopped: the time or memory
+// limit was exceeded or the search was cancelled.
+bool limits_exceeded(Limits *limits, struct timespec *begin, size_t memory) {
+    if (limits->cancel != NULL && *(limits->cancel))
+        return true;
+    if (limits->memory != 0 && memory > limits->memory)
+        return true;
+    return limits->time != 0 && elapsed_time(begin) > limits->time;
+}
+
+// Function implements a breadth-first search that processes the labyrinth
+// level by level. Both the current and the next level are stored
+// in compressed frontiers, the first level is taken from [lab->queue].
+Status bfs_compressed(Labyrinth lab, size_t finish, size_t *distance,
+                      Limits *limits, size_t *neighbours,
+                      struct timespec *begin) {
+    Frontier current = create_frontier();
+    Frontier next = create_frontier();
+    if (current == NULL || next == NULL) {
+        free_frontier(current);
+        free_frontier(next);
+        free(neighbours);
+        error(lab, 0);
+    }
+
+    while (!empty(get_queue(lab))) {
+        if (!frontier_add(current, front(get_queue(lab))))
+            break;
+        pop(get_queue(lab));
+    }
+
+    Status status = NOT_FOUND;
+    size_t cells = 0;
+    size_t cube;
+    bool no_memory = !empty(get_queue(lab));
+    while (!no_memory && status == NOT_FOUND && !frontier_empty(current)) {
+        while (frontier_next(current, &cube)) {
+            if (cube == finish) {
+                status = FOUND;
+                break;
+            }
+            size_t count = get_neighbours(lab, cube, neighbours);
+            for (size_t i = 0; i < count && !no_memory; i++) {
+                if (!get_bit_state(lab, neighbours[i])) {
+                    set_bit_state(lab, neighbours[i]);
+                    no_memory = !frontier_add(next, neighbours[i]);
+                }
+            }
+            if (no_memory)
+                break;
+            if (cells_exceeded(limits, ++cells)) {
+                status = LIMIT;
+                break;
+            }
+            if (cells % LIMITS_CHECK_INTERVAL == 0) {
+                size_t memory = frontier_memory(current) + frontier_memory(next);
+                if (limits_exceeded(limits, begin, memory)) {
+                    status = LIMIT;
+                    break;
                 }
             }
         }
-        dimensions *= read_dimensions_array(lab, i);
+        if (status == NOT_FOUND) {
+            (*distance)++;
+            Frontier temp = current;
+            current = next;
+            next = temp;
+            frontier_clear(next);
+        }
     }
+
+    free_frontier(current);
+    free_frontier(next);
+    if (no_memory) {
+        free(neighbours);
+        error(lab, 0);
+    }
+    return status;
 }
 
 // Length of the shortest path to [finish] cube is stored in [distance].
-bool bfs(Labyrinth lab, size_t token, size_t finish, size_t *distance) {
-    bool found = false;
+Status bfs(Labyrinth lab, size_t token, size_t finish, size_t *distance,
+           Limits *limits) {
+    struct timespec begin;
+    timespec_get(&begin, TIME_UTC);
+    size_t *neighbours = malloc(2 * get_dimensions_number(lab) * sizeof(size_t));
+    if (neighbours == NULL)
+        error(lab, 0);
+
+    if (limits->compress) {
+        Status status = bfs_compressed(lab, finish, distance, limits,
+                                       neighbours, &begin);
+        free(neighbours);
+        return status;
+    }
+
+    Status status = NOT_FOUND;
+    size_t cells = 0;
     while (!empty(get_queue(lab))) {
         size_t cube = front(get_queue(lab));
         // Token at the front of the queue increments distance to the finish
@@ -54,16 +166,26 @@ bool bfs(Labyrinth lab, size_t token, size_t finish, size_t *distance) {
         }
         else {
             if (cube == finish) {
-                found = true;
+                status = FOUND;
                 break;
             }
-            add_adjacent_cubes(lab, cube);
+            add_adjacent_cubes(lab, cube, neighbours);
             if (cube == token && last(get_queue(lab)) != token) {
                 push(get_queue(lab), token);
                 (*distance)++;
             }
             pop(get_queue(lab));
+            // The other limits are checked only once in a while to keep
+            // the search fast.
+            if (cells_exceeded(limits, ++cells)
+                || (cells % LIMITS_CHECK_INTERVAL == 0
+                    && limits_exceeded(limits, &begin,
+                                       queue_memory(get_queue(lab))))) {
+                status = LIMIT;
+                break;
+            }
         }
     }
-    return found;
-}
\ No newline at end of file
+    free(neighbours);
+    return status;
+}
@@ -1,8 +1,44 @@
 #ifndef BFS_H
 #define BFS_H
 
-// Function implements a breadth-first search algorithm.
-// Returns true if a way was found.
-bool bfs(Labyrinth lab, size_t token, size_t finish, size_t *distance);
+#include <signal.h>
 
-#endif
\ No newline at end of file
+// Number of expanded cubes between two consecutive checks of the time
+// and memory limits and of the cancel flag. The cells limit is checked
+// after every expanded cube.
+#define LIMITS_CHECK_INTERVAL 1024
+
+// Structure stores limits of a single search: wall-clock [time] in seconds,
+// number of expanded [cells] and number of bytes occupied by the frontier
+// of the search [memory]. Zero value means that there is no limit.
+// If [compress] is true, the frontier is stored level by level
+// in a compressed form. The search is cancelled as soon as [cancel]
+// (if it is not NULL) points to a nonzero value.
+typedef struct Limits {
+    double time;
+    size_t cells;
+    size_t memory;
+    bool compress;
+    volatile sig_atomic_t *cancel;
+} Limits;
+
+// Possible results of the search.
+typedef enum Status {
+    FOUND,
+    NOT_FOUND,
+    LIMIT
+} Status;
+
+// Function stores IDs of cubes adjacent to [cube] in [neighbours]
+// and returns their number. The array has to fit twice the number
+// of dimensions. Walls are not filtered out.
+size_t get_neighbours(Labyrinth lab, size_t cube, size_t *neighbours);
+
+// Function implements a breadth-first search algorithm starting from
+// the cubes in [lab->queue]. Returns FOUND if a way was found,
+// NOT_FOUND if there is no way and LIMIT if one of the [limits]
+// was exceeded.
+Status bfs(Labyrinth lab, size_t token, size_t finish, size_t *distance,
+           Limits *limits);
+
+#endif
@@ -0,0 +1,221 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "queue.h"
+#include "parse_input.h"
+#include "bfs.h"
+#include "distance_field.h"
+
+// Member [distance] stores distances from [start] to all cubes,
+// [neighbours] is an auxiliary array for get_neighbours and [queue]
+// is used to propagate changes of the distances.
+struct DistanceField {
+    Labyrinth lab;
+    size_t start;
+    size_t *distance;
+    size_t *neighbours;
+    Queue queue;
+};
+
+// Structure describes a cube that lost its shortest path after a wall was
+// added, together with the best distance offered by its unaffected
+// neighbours.
+typedef struct Seed {
+    size_t cube;
+    size_t distance;
+} Seed;
+
+// Function decreases distances of free neighbours of [cube] that can be
+// reached faster through it and adds them to [field->queue].
+void relax_neighbours(DistanceField field, size_t cube) {
+    size_t count = get_neighbours(field->lab, cube, field->neighbours);
+    for (size_t i = 0; i < count; i++) {
+        size_t next = field->neighbours[i];
+        if (!get_bit_state(field->lab, next)
+            && field->distance[next] > field->distance[cube] + 1) {
+            field->distance[next] = field->distance[cube] + 1;
+            push(field->queue, next);
+        }
+    }
+}
+
+// Function propagates distances from the cubes in [field->queue]
+// to all free cubes that can be reached faster through them.
+void propagate(DistanceField field) {
+    while (!empty(field->queue)) {
+        size_t cube = front(field->queue);
+        pop(field->queue);
+        relax_neighbours(field, cube);
+    }
+}
+
+DistanceField create_distance_field(Labyrinth lab, size_t start) {
+    DistanceField field = malloc(sizeof(struct DistanceField));
+    if (field == NULL)
+        return NULL;
+    field->lab = lab;
+    field->start = start;
+    field->distance = malloc(get_size(lab) * sizeof(size_t));
+    field->neighbours = malloc(2 * get_dimensions_number(lab) * sizeof(size_t));
+    field->queue = create_queue();
+    if (field->distance == NULL || field->neighbours == NULL) {
+        free_distance_field(field);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < get_size(lab); i++)
+        field->distance[i] = UNREACHABLE;
+    if (!get_bit_state(lab, start)) {
+        field->distance[start] = 0;
+        push(field->queue, start);
+        propagate(field);
+    }
+    return field;
+}
+
+size_t get_distance(DistanceField field, size_t cube) {
+    return field->distance[cube];
+}
+
+// Function returns the smallest distance of a neighbour of [cube]
+// increased by one, or UNREACHABLE if no neighbour can be reached.
+size_t best_neighbour(DistanceField field, size_t cube) {
+    size_t best = UNREACHABLE;
+    size_t count = get_neighbours(field->lab, cube, field->neighbours);
+    for (size_t i = 0; i < count; i++) {
+        size_t distance = field->distance[field->neighbours[i]];
+        if (distance != UNREACHABLE && distance + 1 < best)
+            best = distance + 1;
+    }
+    return best;
+}
+
+// Function returns true if [cube] has a neighbour that is one step closer
+// to the start.
+bool has_support(DistanceField field, size_t cube) {
+    size_t count = get_neighbours(field->lab, cube, field->neighbours);
+    for (size_t i = 0; i < count; i++) {
+        if (field->distance[field->neighbours[i]] + 1 == field->distance[cube])
+            return true;
+    }
+    return false;
+}
+
+// Function adds to [field->queue] neighbours of [cube] that are one step
+// further from the start than [distance].
+void push_successors(DistanceField field, size_t cube, size_t distance) {
+    size_t count = get_neighbours(field->lab, cube, field->neighbours);
+    for (size_t i = 0; i < count; i++) {
+        if (field->distance[field->neighbours[i]] == distance + 1)
+            push(field->queue, field->neighbours[i]);
+    }
+}
+
+int compare_seeds(const void *a, const void *b) {
+    size_t x = ((const Seed *)a)->distance;
+    size_t y = ((const Seed *)b)->distance;
+    return (x > y) - (x < y);
+}
+
+// Function finds cubes that lost all their shortest paths when [cube]
+// became a wall. They are processed level by level, so a cube is affected
+// only if none of its neighbours from the previous level kept its
+// distance. Affected cubes become unreachable and are stored in [seeds].
+bool find_affected(DistanceField field, size_t cube, Seed **seeds,
+                   size_t *seeds_number) {
+    size_t max_size = 16;
+    *seeds = malloc(max_size * sizeof(Seed));
+    *seeds_number = 0;
+    if (*seeds == NULL)
+        return false;
+
+    size_t distance = field->distance[cube];
+    field->distance[cube] = UNREACHABLE;
+    push_successors(field, cube, distance);
+    while (!empty(field->queue)) {
+        size_t next = front(field->queue);
+        pop(field->queue);
+        if (field->distance[next] == UNREACHABLE || has_support(field, next))
+            continue;
+
+        if (*seeds_number == max_size) {
+            max_size *= 2;
+            Seed *new_seeds = realloc(*seeds, max_size * sizeof(Seed));
+            if (new_seeds == NULL)
+                return false;
+            *seeds = new_seeds;
+        }
+        (*seeds)[(*seeds_number)++].cube = next;
+        distance = field->distance[next];
+        field->distance[next] = UNREACHABLE;
+        push_successors(field, next, distance);
+    }
+    return true;
+}
+
+bool add_wall(DistanceField field, size_t cube) {
+    if (get_bit_state(field->lab, cube))
+        return true;
+    set_bit_state(field->lab, cube);
+    if (field->distance[cube] == UNREACHABLE)
+        return true;
+
+    Seed *seeds;
+    size_t seeds_number;
+    if (!find_affected(field, cube, &seeds, &seeds_number)) {
+        while (!empty(field->queue))
+            pop(field->queue);
+        free(seeds);
+        return false;
+    }
+
+    // Affected cubes start from the distances offered by the rest of the
+    // labyrinth. They are merged in ascending order with the cubes reached
+    // from them, as in a search with many starting points.
+    for (size_t i = 0; i < seeds_number; i++)
+        seeds[i].distance = best_neighbour(field, seeds[i].cube);
+    qsort(seeds, seeds_number, sizeof(Seed), compare_seeds);
+
+    size_t i = 0;
+    while (i < seeds_number && seeds[i].distance != UNREACHABLE) {
+        if (!empty(field->queue)
+            && field->distance[front(field->queue)] < seeds[i].distance) {
+            size_t next = front(field->queue);
+            pop(field->queue);
+            relax_neighbours(field, next);
+        }
+        else {
+            if (seeds[i].distance < field->distance[seeds[i].cube]) {
+                field->distance[seeds[i].cube] = seeds[i].distance;
+                relax_neighbours(field, seeds[i].cube);
+            }
+            i++;
+        }
+    }
+    propagate(field);
+    free(seeds);
+    return true;
+}
+
+void remove_wall(DistanceField field, size_t cube) {
+    if (!get_bit_state(field->lab, cube))
+        return;
+    clear_bit_state(field->lab, cube);
+    if (cube == field->start)
+        field->distance[cube] = 0;
+    else
+        field->distance[cube] = best_neighbour(field, cube);
+    if (field->distance[cube] != UNREACHABLE) {
+        push(field->queue, cube);
+        propagate(field);
+    }
+}
+
+void free_distance_field(DistanceField field) {
+    if (field != NULL) {
+        free(field->distance);
+        free(field->neighbours);
+        free_queue(field->queue);
+        free(field);
+    }
+}
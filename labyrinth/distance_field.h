@@ -0,0 +1,35 @@
+#ifndef DISTANCE_FIELD_H
+#define DISTANCE_FIELD_H
+
+#include <stdint.h>
+
+// Distance of a cube that can not be reached from the start.
+#define UNREACHABLE SIZE_MAX
+
+// The structure DistanceField stores distances from the start cube to all
+// cubes of the labyrinth. Walls are read from [lab->bits_array], which
+// is not used to mark visited cubes. When a wall is added or removed,
+// only the distances that have changed are recalculated.
+typedef struct DistanceField *DistanceField;
+
+// Function calculates distances from [start] to all cubes of [lab].
+// Returns NULL if failed to allocate memory.
+DistanceField create_distance_field(Labyrinth lab, size_t start);
+
+// Function returns the distance from the start to [cube]
+// or UNREACHABLE if there is no way.
+size_t get_distance(DistanceField field, size_t cube);
+
+// Function marks [cube] as a wall and recalculates distances of cubes
+// whose all shortest paths led through it.
+// Returns false if failed to allocate memory.
+bool add_wall(DistanceField field, size_t cube);
+
+// Function marks [cube] as free and decreases distances of cubes
+// that can be reached faster through it.
+void remove_wall(DistanceField field, size_t cube);
+
+// Function deallocates the memory previously used by the field.
+void free_distance_field(DistanceField field);
+
+#endif
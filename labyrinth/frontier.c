@@ -0,0 +1,149 @@
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "frontier.h"
+
+// Number of IDs sorted and encoded together.
+#define CHUNK_SIZE 4096
+#define INITIAL_DATA_SIZE 1024
+
+// Member [data] stores encoded chunks, [chunk] stores IDs that have not been
+// encoded yet. Members with the prefix [read_] describe the current position
+// of the reading: offset in [data], number of IDs left in the current chunk,
+// previously decoded ID and position in [chunk].
+struct Frontier {
+    unsigned char *data;
+    size_t data_size, data_max_size;
+    size_t *chunk;
+    size_t chunk_size;
+    bool chunk_sorted;
+    size_t read_position, read_left, read_previous, read_chunk;
+};
+
+Frontier create_frontier() {
+    Frontier frontier = malloc(sizeof(struct Frontier));
+    if (frontier == NULL)
+        return NULL;
+    frontier->data = malloc(INITIAL_DATA_SIZE);
+    frontier->chunk = malloc(CHUNK_SIZE * sizeof(size_t));
+    if (frontier->data == NULL || frontier->chunk == NULL) {
+        free_frontier(frontier);
+        return NULL;
+    }
+    frontier->data_max_size = INITIAL_DATA_SIZE;
+    frontier_clear(frontier);
+    return frontier;
+}
+
+// Function writes [val] at the end of [frontier->data] as a sequence of
+// bytes, seven bits in each. The highest bit marks that more bytes follow.
+bool encode_number(Frontier frontier, size_t val) {
+    // A number takes at most ten bytes.
+    if (frontier->data_size + 10 > frontier->data_max_size) {
+        size_t new_size = 2 * frontier->data_max_size;
+        unsigned char *new_data = realloc(frontier->data, new_size);
+        if (new_data == NULL)
+            return false;
+        frontier->data = new_data;
+        frontier->data_max_size = new_size;
+    }
+    while (val >= 0x80) {
+        frontier->data[frontier->data_size++] = (val & 0x7f) | 0x80;
+        val >>= 7;
+    }
+    frontier->data[frontier->data_size++] = val;
+    return true;
+}
+
+// Function reads a number written by encode_number starting
+// at [frontier->read_position].
+size_t decode_number(Frontier frontier) {
+    size_t val = 0;
+    int shift = 0;
+    unsigned char byte;
+    do {
+        byte = frontier->data[frontier->read_position++];
+        val |= (size_t)(byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    return val;
+}
+
+int compare_ids(const void *a, const void *b) {
+    size_t x = *(const size_t *)a;
+    size_t y = *(const size_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Function sorts the IDs gathered in [frontier->chunk] and encodes them.
+bool encode_chunk(Frontier frontier) {
+    qsort(frontier->chunk, frontier->chunk_size, sizeof(size_t), compare_ids);
+    if (!encode_number(frontier, frontier->chunk_size))
+        return false;
+    size_t previous = 0;
+    for (size_t i = 0; i < frontier->chunk_size; i++) {
+        if (!encode_number(frontier, frontier->chunk[i] - previous))
+            return false;
+        previous = frontier->chunk[i];
+    }
+    frontier->chunk_size = 0;
+    return true;
+}
+
+bool frontier_add(Frontier frontier, size_t val) {
+    if (frontier->chunk_size == CHUNK_SIZE && !encode_chunk(frontier))
+        return false;
+    frontier->chunk[frontier->chunk_size++] = val;
+    frontier->chunk_sorted = false;
+    return true;
+}
+
+bool frontier_next(Frontier frontier, size_t *val) {
+    if (frontier->read_left == 0 && frontier->read_position < frontier->data_size) {
+        frontier->read_left = decode_number(frontier);
+        frontier->read_previous = 0;
+    }
+    if (frontier->read_left > 0) {
+        frontier->read_previous += decode_number(frontier);
+        frontier->read_left--;
+        *val = frontier->read_previous;
+        return true;
+    }
+    // IDs which have not been encoded are read at the end.
+    if (!frontier->chunk_sorted) {
+        qsort(frontier->chunk, frontier->chunk_size, sizeof(size_t), compare_ids);
+        frontier->chunk_sorted = true;
+    }
+    if (frontier->read_chunk < frontier->chunk_size) {
+        *val = frontier->chunk[frontier->read_chunk++];
+        return true;
+    }
+    return false;
+}
+
+bool frontier_empty(Frontier frontier) {
+    return frontier->data_size == 0 && frontier->chunk_size == 0;
+}
+
+void frontier_clear(Frontier frontier) {
+    frontier->data_size = 0;
+    frontier->chunk_size = 0;
+    frontier->chunk_sorted = true;
+    frontier->read_position = 0;
+    frontier->read_left = 0;
+    frontier->read_previous = 0;
+    frontier->read_chunk = 0;
+}
+
+size_t frontier_memory(Frontier frontier) {
+    return sizeof(struct Frontier) + frontier->data_max_size
+           + CHUNK_SIZE * sizeof(size_t);
+}
+
+void free_frontier(Frontier frontier) {
+    if (frontier != NULL) {
+        free(frontier->data);
+        free(frontier->chunk);
+        free(frontier);
+    }
+}
@@ -0,0 +1,35 @@
+#ifndef FRONTIER_H
+#define FRONTIER_H
+
+// The structure Frontier stores one level of the breadth-first search
+// in a compressed form. Added IDs are gathered in chunks, each chunk is
+// sorted and written to [data] as its length followed by the differences
+// between consecutive IDs, all encoded as variable-length numbers.
+typedef struct Frontier *Frontier;
+
+// An auxiliary function to create an empty frontier.
+// Returns NULL if failed to allocate memory.
+Frontier create_frontier();
+
+// Function adds element with value [val] to the frontier.
+// Returns false if failed to allocate memory.
+bool frontier_add(Frontier frontier, size_t val);
+
+// Function stores the next element of the frontier in [val].
+// Elements are returned chunk by chunk, in ascending order inside a chunk.
+// Returns false if all the elements have been read.
+bool frontier_next(Frontier frontier, size_t *val);
+
+// Function returns true if no element was added to the frontier.
+bool frontier_empty(Frontier frontier);
+
+// Function removes all elements of the frontier.
+void frontier_clear(Frontier frontier);
+
+// Function returns the number of bytes occupied by the frontier.
+size_t frontier_memory(Frontier frontier);
+
+// Function deallocates the memory previously used by the frontier.
+void free_frontier(Frontier frontier);
+
+#endif
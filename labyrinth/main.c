@@ -1,11 +1,107 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 #include "queue.h"
 #include "parse_input.h"
 #include "bfs.h"
+#include "distance_field.h"
+
+// Flag set by the signal handler to stop the search.
+volatile sig_atomic_t cancelled = 0;
+
+void cancel_search(int signal_number) {
+    (void) signal_number;
+    cancelled = 1;
+}
+
+// Function reads the program arguments: limits of the search (-t seconds,
+// -n number of expanded cubes, -m bytes of the frontier), -z to store
+// the frontier in a compressed form and -i to turn on the batch mode.
+// Returns false if the arguments are incorrect.
+bool parse_arguments(int argc, char *argv[], Limits *limits, bool *batch) {
+    for (int i = 1; i < argc; i++) {
+        char *end = NULL;
+        if (strcmp(argv[i], "-z") == 0) {
+            limits->compress = true;
+            continue;
+        }
+        if (strcmp(argv[i], "-i") == 0) {
+            *batch = true;
+            continue;
+        }
+        if (i + 1 == argc)
+            return false;
+        if (strcmp(argv[i], "-t") == 0)
+            limits->time = strtod(argv[i + 1], &end);
+        else if (strcmp(argv[i], "-n") == 0)
+            limits->cells = strtoull(argv[i + 1], &end, 10);
+        else if (strcmp(argv[i], "-m") == 0)
+            limits->memory = strtoull(argv[i + 1], &end, 10);
+        else
+            return false;
+        if (*end != '\0' || end == argv[i + 1] || limits->time < 0)
+            return false;
+        i++;
+    }
+    return true;
+}
+
+// Function prints the distance from the start to [cube].
+void print_distance(DistanceField field, size_t cube) {
+    size_t distance = get_distance(field, cube);
+    if (distance != UNREACHABLE)
+        printf("%lu\n", distance);
+    else
+        printf("NO WAY\n");
+}
+
+// Function keeps distances from [start] to all cubes and reads edits
+// of the labyrinth from the following lines of input. After each edit
+// only the affected part of the distances is recalculated.
+void run_batch(Labyrinth lab, size_t start, size_t finish) {
+    DistanceField field = create_distance_field(lab, start);
+    if (field == NULL)
+        error(lab, 0);
+    print_distance(field, finish);
+
+    int line_number = 5;
+    size_t cube = finish;
+    char command;
+    while ((command = parse_edit(lab, line_number, &cube)) != '\0') {
+        if (command == '+') {
+            if (!add_wall(field, cube)) {
+                free_distance_field(field);
+                error(lab, 0);
+            }
+        }
+        else if (command == '-') {
+            remove_wall(field, cube);
+        }
+        else {
+            finish = cube;
+            print_distance(field, finish);
+        }
+        cube = finish;
+        line_number++;
+    }
+
+    free_distance_field(field);
+    free_all(lab);
+}
+
+int main(int argc, char *argv[]) {
+    Limits limits = {0, 0, 0, false, &cancelled};
+    bool batch = false;
+    if (!parse_arguments(argc, argv, &limits, &batch)) {
+        fprintf(stderr,
+                "Usage: %s [-t seconds] [-n cubes] [-m bytes] [-z] [-i]\n",
+                argv[0]);
+        return 1;
+    }
+    signal(SIGINT, cancel_search);
+    signal(SIGTERM, cancel_search);
 
-int main() {
     Labyrinth lab = create_labyrinth();
 
     parse_1(lab);
@@ -22,6 +118,7 @@ int main() {
     size_t start = parse_2_3(lab, 2);
     size_t finish = parse_2_3(lab, 3);
 
+    set_batch_mode(lab, batch);
     parse_4(lab);
 
     // Prints error if cube of starting or finishing position is not free.
@@ -30,16 +127,24 @@ int main() {
     if (get_bit_state(lab, finish))
         error(lab, 3);
 
+    if (batch) {
+        run_batch(lab, start, finish);
+        return 0;
+    }
+
     push(get_queue(lab), start);
     set_bit_state(lab, start);
 
     size_t distance = 0;
-    if (bfs(lab, start, finish, &distance))
+    Status status = bfs(lab, start, finish, &distance, &limits);
+    if (status == FOUND)
         printf("%lu\n", distance);
+    else if (status == LIMIT)
+        printf("LIMIT\n");
     else
         printf("NO WAY\n");
 
     free_all(lab);
 
     return 0;
-}
\ No newline at end of file
+}
@@ -15,6 +15,7 @@ struct Labyrinth {
     size_t dimensions_number, size, bits_number;
     unsigned char *bits_array;
     Queue queue;
+    bool batch_mode;
 };
 
 size_t *get_dimensions_array(Labyrinth lab) {
@@ -49,6 +50,10 @@ void create_bits_array(Labyrinth lab) {
     lab->bits_array = calloc(lab->bits_number, sizeof(unsigned char));
 }
 
+void set_batch_mode(Labyrinth lab, bool value) {
+    lab->batch_mode = value;
+}
+
 Queue get_queue(Labyrinth lab) {
     return lab->queue;
 }
@@ -67,6 +72,7 @@ Labyrinth create_labyrinth() {
     lab->size = 1;
     lab->queue = create_queue();
     lab->bits_array = NULL;
+    lab->batch_mode = false;
     return lab;
 }
 
@@ -96,6 +102,12 @@ void set_bit_state(Labyrinth lab, size_t cube_id) {
     lab->bits_array[i] = lab->bits_array[i] | (1 << remainder);
 }
 
+void clear_bit_state(Labyrinth lab, size_t cube_id) {
+    size_t remainder = cube_id % NUMBER_OF_BITS_IN_BYTE;
+    size_t i = cube_id / NUMBER_OF_BITS_IN_BYTE;
+    lab->bits_array[i] = lab->bits_array[i] & ~(1 << remainder);
+}
+
 // Function checks if there are characters other than whitespace at the end
 // of the input line.
 void wrong_input(Labyrinth lab, int line_number) {
@@ -105,7 +117,8 @@ void wrong_input(Labyrinth lab, int line_number) {
             error(lab, line_number);
         }
     }
-    if (line_number == 4) {
+    // In the batch mode next lines contain edits of the labyrinth.
+    if (line_number == 4 && !lab->batch_mode) {
         while ((c = getchar()) && c != EOF) {
             if (c == '\n' || !isspace(c)) {
                 error(lab, 5);
@@ -376,4 +389,24 @@ void parse_4(Labyrinth lab) {
             break;
         }
     }
+}
+
+char parse_edit(Labyrinth lab, int line_number, size_t *cube) {
+    char c;
+    while ((c = getchar()) && c != EOF && c != '\n' && isspace(c)) {}
+    if (c == EOF)
+        return '\0';
+    if (c != '+' && c != '-' && c != '?')
+        error(lab, line_number);
+
+    char command = c;
+    while ((c = getchar()) && c != EOF && c != '\n' && isspace(c)) {}
+    ungetc(c, stdin);
+    // A query without coordinates concerns the previous finishing position.
+    if (command == '?' && (c == '\n' || c == EOF)) {
+        getchar();
+        return command;
+    }
+    *cube = parse_2_3(lab, line_number);
+    return command;
 }
\ No newline at end of file
@@ -19,6 +19,7 @@ size_t get_bits_number(Labyrinth lab);
 void set_bits_number(Labyrinth lab, size_t value);
 unsigned char *get_bits_array(Labyrinth lab);
 void create_bits_array(Labyrinth lab);
+void set_batch_mode(Labyrinth lab, bool value);
 Queue get_queue(Labyrinth lab);
 void free_all(Labyrinth lab);
 
@@ -35,6 +36,9 @@ bool get_bit_state(Labyrinth lab, size_t number);
 // Function marks specified cube in [lab->bits_array] as not free.
 void set_bit_state(Labyrinth lab, size_t number);
 
+// Function marks specified cube in [lab->bits_array] as free.
+void clear_bit_state(Labyrinth lab, size_t number);
+
 // Function reads the first line of input and fills [lab->dimensions_array].
 void parse_1(Labyrinth lab);
 
@@ -49,4 +53,10 @@ size_t ceiling(size_t a, size_t b);
 // Function reads fourth line of input and marks specified cubes as walls.
 void parse_4(Labyrinth lab);
 
+// Function reads a line of the batch mode: a command '+' (add a wall),
+// '-' (remove a wall) or '?' (query the distance) followed by coordinates
+// of a cube, which ID is stored in [cube]. The coordinates of a query
+// are optional. Returns the command or '\0' at the end of input.
+char parse_edit(Labyrinth lab, int line_number, size_t *cube);
+
 #endif
\ No newline at end of file
@@ -9,10 +9,11 @@ struct Node {
 };
 
 // Members [first] and [last] indicate successively the first and
-// the last element added to the queue.
+// the last element added to the queue, [count] is the number of elements.
 struct Queue {
     Node first;
     Node last;
+    size_t count;
 };
 
 Node create_node(size_t val){
@@ -26,6 +27,7 @@ Queue create_queue() {
     Queue q = malloc(sizeof(struct Queue));
     q->first = NULL;
     q->last = NULL;
+    q->count = 0;
     return q;
 }
 
@@ -45,6 +47,7 @@ void push(Queue queue, size_t val) {
         prev_last->next = node;
         queue->last = node;
     }
+    queue->count++;
 }
 
 // Following functions front, pop and last assume that
@@ -58,6 +61,7 @@ void pop(Queue queue) {
     Node prev_first = queue->first;
     Node new_first = prev_first->next;
     queue->first = new_first;
+    queue->count--;
     free(prev_first);
 }
 ;
@@ -66,6 +70,10 @@ size_t last(Queue queue) {
     return node->value;
 }
 
+size_t queue_memory(Queue queue) {
+    return sizeof(struct Queue) + queue->count * sizeof(struct Node);
+}
+
 void free_queue(Queue queue) {
     while(!empty(queue)) {
         pop(queue);
@@ -27,6 +27,9 @@ void pop(Queue queue);
 // Function returns value of the last element in the queue.
 size_t last(Queue queue);
 
+// Function returns the number of bytes occupied by the queue.
+size_t queue_memory(Queue queue);
+
 // Function deallocates the memory previously used by the queue.
 void free_queue(Queue queue);
 
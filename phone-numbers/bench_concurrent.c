@@ -0,0 +1,174 @@
+/** @file
+ * A benchmark of phone number forwarding used by many threads
+ *
+ * The benchmark compares a structure created by @ref phfwdNewConcurrent with a structure
+ * created by @ref phfwdNew and guarded by one mutex. Each thread resolves random numbers
+ * with @ref phfwdGet and, with a given probability, adds or removes a forwarding instead.
+ * Results are printed as CSV lines:
+ * mode,threads,write_percent,ops,seconds,ops_per_sec
+ *
+ * Usage: bench_concurrent [rules] [operations per thread] [maximal number of threads]
+ *
+ * @author Emilia Dębicka <ed438406@students.mimuw.edu.pl>
+ * @copyright University of Warsaw
+ * @date 2022
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "phone_forward.h"
+#include "workload.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/**
+ * A macro that stores the maximal length of a generated number.
+ */
+#define MAX_NUMBER_LENGTH 12
+
+/**
+ * A macro that stores the maximal number of threads.
+ */
+#define MAX_THREADS 64
+
+/**
+ * The structure stores the parameters of one thread of the benchmark.
+ */
+typedef struct Worker {
+    /**@{*/
+    PhoneForward *pf; /**< The benchmarked structure. */
+    pthread_mutex_t *lock; /**< The mutex guarding @p pf or NULL in concurrent mode. */
+    uint64_t seed; /**< The state of the random generator of the thread. */
+    size_t operations; /**< The number of operations made by the thread. */
+    unsigned writePercent; /**< The percentage of operations that change @p pf. */
+    /**@}*/
+} Worker;
+
+/** Function generates a random number.
+ * Prefixes of the generated numbers repeat often, so forwardings apply to many of them.
+ * @param[in, out] seed - a pointer to the state of the generator;
+ * @param[in] minSize - the minimal length of the number, at most @ref MAX_NUMBER_LENGTH;
+ * @param[out] num - a pointer to the array of at least @ref MAX_NUMBER_LENGTH + 1 characters.
+ */
+static void randomNumber(uint64_t *seed, size_t minSize, char *num) {
+    WorkloadConfig config;
+    workloadDefaults(&config);
+    workloadNumber(&config, seed, minSize, MAX_NUMBER_LENGTH, num);
+}
+
+/** Function returns the current time.
+ * @return The time in seconds from an arbitrary moment.
+ */
+static double now(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+/** Function runs one thread of the benchmark.
+ * @param[in, out] arg - a pointer to the Worker structure.
+ * @return NULL.
+ */
+static void *work(void *arg) {
+    Worker *worker = arg;
+    char num1[MAX_NUMBER_LENGTH + 1], num2[MAX_NUMBER_LENGTH + 1];
+    for (size_t i = 0; i < worker->operations; i++) {
+        // Removed prefixes are long, so the number of forwardings stays roughly the same.
+        bool write = workloadRandom(&worker->seed) % 100 < worker->writePercent;
+        bool remove = write && workloadRandom(&worker->seed) % 4 == 0;
+        randomNumber(&worker->seed, remove ? MAX_NUMBER_LENGTH / 2 : 1, num1);
+        randomNumber(&worker->seed, 1, num2);
+
+        if (worker->lock != NULL) {
+            pthread_mutex_lock(worker->lock);
+        }
+        if (!write) {
+            phnumDelete(phfwdGet(worker->pf, num1));
+        } else if (remove) {
+            phfwdRemove(worker->pf, num1);
+        } else {
+            phfwdAdd(worker->pf, num1, num2);
+        }
+        if (worker->lock != NULL) {
+            pthread_mutex_unlock(worker->lock);
+        }
+    }
+    return NULL;
+}
+
+/** Function measures the throughput of one configuration.
+ * @param[in] concurrent - a boolean informing if the structure is in concurrent mode;
+ * @param[in] rules - the number of forwardings added before the measurement;
+ * @param[in] operations - the number of operations of each thread;
+ * @param[in] threads - the number of threads;
+ * @param[in] writePercent - the percentage of operations that change the structure.
+ * @return Value @p false if failed to create the structure or a thread. Otherwise @p true.
+ */
+static bool measure(bool concurrent, size_t rules, size_t operations, size_t threads, unsigned writePercent) {
+    PhoneForward *pf = concurrent ? phfwdNewConcurrent() : phfwdNew();
+    if (pf == NULL) {
+        return false;
+    }
+    uint64_t seed = 1;
+    char num1[MAX_NUMBER_LENGTH + 1], num2[MAX_NUMBER_LENGTH + 1];
+    for (size_t i = 0; i < rules; i++) {
+        randomNumber(&seed, 1, num1);
+        randomNumber(&seed, 1, num2);
+        phfwdAdd(pf, num1, num2);
+    }
+
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    Worker workers[MAX_THREADS];
+    pthread_t ids[MAX_THREADS];
+    size_t started = 0;
+    double start = now();
+    for (; started < threads; started++) {
+        Worker worker = {pf, concurrent ? NULL : &lock, started + 2, operations, writePercent};
+        workers[started] = worker;
+        if (pthread_create(&ids[started], NULL, work, &workers[started]) != 0) {
+            break;
+        }
+    }
+    for (size_t i = 0; i < started; i++) {
+        pthread_join(ids[i], NULL);
+    }
+    double seconds = now() - start;
+
+    if (started == threads) {
+        printf("%s,%zu,%u,%zu,%.6f,%.0f\n", concurrent ? "concurrent" : "mutex", threads, writePercent,
+               threads * operations, seconds, threads * operations / seconds);
+    }
+    phfwdDelete(pf);
+    pthread_mutex_destroy(&lock);
+    return started == threads;
+}
+
+/** The main function of the benchmark.
+ * @param[in] argc - the number of arguments;
+ * @param[in] argv - the arguments: the number of forwardings, the number of operations
+ * of each thread and the maximal number of threads.
+ * @return 0 if the benchmark succeeded, 1 otherwise.
+ */
+int main(int argc, char *argv[]) {
+    size_t rules = argc > 1 ? strtoul(argv[1], NULL, 10) : 100000;
+    size_t operations = argc > 2 ? strtoul(argv[2], NULL, 10) : 200000;
+    size_t maxThreads = argc > 3 ? strtoul(argv[3], NULL, 10) : 8;
+    if (maxThreads > MAX_THREADS) {
+        maxThreads = MAX_THREADS;
+    }
+    unsigned const writePercents[] = {0, 1, 10, 50};
+
+    printf("mode,threads,write_percent,ops,seconds,ops_per_sec\n");
+    for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+        for (size_t i = 0; i < sizeof(writePercents) / sizeof(writePercents[0]); i++) {
+            if (!measure(false, rules, operations, threads, writePercents[i])
+                || !measure(true, rules, operations, threads, writePercents[i])) {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,305 @@
+/** @file
+ * A benchmark of operations of phone number forwarding
+ *
+ * The benchmark generates forwardings and queries with @ref workloadNew, and measures
+ * @ref phfwdAdd, @ref phfwdGet, @ref phfwdReverse, @ref phfwdGetReverse, @ref phfwdRemove
+ * and @ref phfwdDelete separately. Each call is timed, so the latencies include one reading
+ * of the clock. Results are printed as CSV lines:
+ * operation,ops,seconds,ops_per_sec,p50_ns,p90_ns,p99_ns,max_ns,peak_rss_kb,allocations
+ *
+ * The peak resident memory is measured for the whole process after the operation. Allocations
+ * are counted when the program is linked with wrapped malloc, calloc and realloc
+ * (BENCH_COUNT_ALLOCATIONS), otherwise the column is -1.
+ *
+ * Usage: bench_operations [-r rules] [-q queries] [-m minimal length] [-M maximal length]
+ * [-g] [-f fan-out] [-t shared targets] [-s special digits] [-S seed]
+ * where -g chooses the geometric distribution of lengths, see @ref WorkloadConfig.
+ *
+ * @author Emilia Dębicka <ed438406@students.mimuw.edu.pl>
+ * @copyright University of Warsaw
+ * @date 2022
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "phone_forward.h"
+#include "workload.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * The number of allocations made by the program.
+ */
+static size_t allocations;
+
+#ifdef BENCH_COUNT_ALLOCATIONS
+
+/** Function allocates memory with the original malloc.
+ * @param[in] size - the number of bytes.
+ * @return A pointer to the memory or NULL.
+ */
+void *__real_malloc(size_t size);
+
+/** Function allocates memory with the original calloc.
+ * @param[in] count - the number of elements;
+ * @param[in] size - the size of an element.
+ * @return A pointer to the memory or NULL.
+ */
+void *__real_calloc(size_t count, size_t size);
+
+/** Function resizes memory with the original realloc.
+ * @param[in] pointer - a pointer to the memory or NULL;
+ * @param[in] size - the number of bytes.
+ * @return A pointer to the memory or NULL.
+ */
+void *__real_realloc(void *pointer, size_t size);
+
+/** Function counts a call of malloc.
+ * @param[in] size - the number of bytes.
+ * @return A pointer to the memory or NULL.
+ */
+void *__wrap_malloc(size_t size) {
+    allocations++;
+    return __real_malloc(size);
+}
+
+/** Function counts a call of calloc.
+ * @param[in] count - the number of elements;
+ * @param[in] size - the size of an element.
+ * @return A pointer to the memory or NULL.
+ */
+void *__wrap_calloc(size_t count, size_t size) {
+    allocations++;
+    return __real_calloc(count, size);
+}
+
+/** Function counts a call of realloc.
+ * @param[in] pointer - a pointer to the memory or NULL;
+ * @param[in] size - the number of bytes.
+ * @return A pointer to the memory or NULL.
+ */
+void *__wrap_realloc(void *pointer, size_t size) {
+    allocations++;
+    return __real_realloc(pointer, size);
+}
+
+#endif
+
+/**
+ * A function making the operation of a given index on a structure.
+ */
+typedef void (*Operation)(PhoneForward *pf, Workload const *workload, size_t i);
+
+/** Function adds a forwarding of the workload.
+ * @param[in, out] pf - a pointer to the structure;
+ * @param[in] workload - a pointer to the workload;
+ * @param[in] i - the index of the forwarding.
+ */
+static void addRule(PhoneForward *pf, Workload const *workload, size_t i) {
+    phfwdAdd(pf, workload->num1[i], workload->num2[i]);
+}
+
+/** Function removes the forwardings of a prefix of the workload.
+ * @param[in, out] pf - a pointer to the structure;
+ * @param[in] workload - a pointer to the workload;
+ * @param[in] i - the index of the forwarding.
+ */
+static void removeRule(PhoneForward *pf, Workload const *workload, size_t i) {
+    phfwdRemove(pf, workload->num1[i]);
+}
+
+/** Function calculates the forwarding of a query.
+ * @param[in] pf - a pointer to the structure;
+ * @param[in] workload - a pointer to the workload;
+ * @param[in] i - the index of the query.
+ */
+static void getQuery(PhoneForward *pf, Workload const *workload, size_t i) {
+    phnumDelete(phfwdGet(pf, workload->forwarded[i]));
+}
+
+/** Function calculates the numbers that can be forwarded to a query.
+ * @param[in] pf - a pointer to the structure;
+ * @param[in] workload - a pointer to the workload;
+ * @param[in] i - the index of the query.
+ */
+static void reverseQuery(PhoneForward *pf, Workload const *workload, size_t i) {
+    phnumDelete(phfwdReverse(pf, workload->targets[i]));
+}
+
+/** Function calculates the numbers forwarded to a query.
+ * @param[in] pf - a pointer to the structure;
+ * @param[in] workload - a pointer to the workload;
+ * @param[in] i - the index of the query.
+ */
+static void getReverseQuery(PhoneForward *pf, Workload const *workload, size_t i) {
+    phnumDelete(phfwdGetReverse(pf, workload->targets[i]));
+}
+
+/** Function returns the current time.
+ * @return The time in nanoseconds from an arbitrary moment.
+ */
+static uint64_t now(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t) time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+/** Function compares latencies.
+ * @param[in] a - a pointer to the first latency;
+ * @param[in] b - a pointer to the second latency.
+ * @return A negative integer, 0 or a positive integer if the first latency is smaller,
+ * equal or larger.
+ */
+static int compareLatencies(void const *a, void const *b) {
+    uint64_t x = *(uint64_t const *) a, y = *(uint64_t const *) b;
+    return (x > y) - (x < y);
+}
+
+/** Function prints the results of an operation.
+ * @param[in] name - a pointer to the name of the operation;
+ * @param[in, out] latencies - an array of latencies of calls, it is sorted;
+ * @param[in] count - the number of calls, at least 1;
+ * @param[in] total - the time of all calls in nanoseconds;
+ * @param[in] allocated - the number of allocations made by the calls.
+ */
+static void report(char const *name, uint64_t *latencies, size_t count, uint64_t total, size_t allocated) {
+    qsort(latencies, count, sizeof(uint64_t), compareLatencies);
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    double seconds = total / 1e9;
+#ifdef BENCH_COUNT_ALLOCATIONS
+    long long allocationsCount = allocated;
+#else
+    long long allocationsCount = -1;
+    (void) allocated;
+#endif
+    printf("%s,%zu,%.6f,%.0f,%llu,%llu,%llu,%llu,%ld,%lld\n", name, count, seconds,
+           seconds > 0 ? count / seconds : 0.0, (unsigned long long) latencies[count / 2],
+           (unsigned long long) latencies[count * 9 / 10], (unsigned long long) latencies[count * 99 / 100],
+           (unsigned long long) latencies[count - 1], usage.ru_maxrss, allocationsCount);
+}
+
+/** Function measures an operation.
+ * @param[in] name - a pointer to the name of the operation;
+ * @param[in, out] pf - a pointer to the structure;
+ * @param[in] workload - a pointer to the workload;
+ * @param[in] count - the number of calls;
+ * @param[in] operation - the operation.
+ * @return Value @p false if failed to allocate memory. Otherwise @p true.
+ */
+static bool measure(char const *name, PhoneForward *pf, Workload const *workload, size_t count,
+                    Operation operation) {
+    if (count == 0) {
+        return true;
+    }
+    uint64_t *latencies = malloc(count * sizeof(uint64_t));
+    if (latencies == NULL) {
+        return false;
+    }
+    size_t allocated = allocations;
+    uint64_t start = now(), previous = start;
+    for (size_t i = 0; i < count; i++) {
+        operation(pf, workload, i);
+        uint64_t current = now();
+        latencies[i] = current - previous;
+        previous = current;
+    }
+    allocated = allocations - allocated;
+    report(name, latencies, count, previous - start, allocated);
+    free(latencies);
+    return true;
+}
+
+/** Function measures deleting a structure.
+ * @param[in] pf - a pointer to the structure.
+ */
+static void measureDelete(PhoneForward *pf) {
+    size_t allocated = allocations;
+    uint64_t start = now();
+    phfwdDelete(pf);
+    uint64_t latency = now() - start;
+    report("delete", &latency, 1, latency, allocations - allocated);
+}
+
+/** Function reads the parameters of the workload.
+ * @param[in] argc - the number of arguments;
+ * @param[in] argv - the arguments;
+ * @param[out] config - a pointer to the parameters.
+ * @return Value @p false if the arguments are incorrect. Otherwise @p true.
+ */
+static bool parseArguments(int argc, char *argv[], WorkloadConfig *config) {
+    workloadDefaults(config);
+    int option;
+    while ((option = getopt(argc, argv, "r:q:m:M:gf:t:s:S:")) != -1) {
+        char *end = NULL;
+        if (option == 'r') {
+            config->rules = strtoull(optarg, &end, 10);
+        } else if (option == 'q') {
+            config->queries = strtoull(optarg, &end, 10);
+        } else if (option == 'm') {
+            config->minLength = strtoull(optarg, &end, 10);
+        } else if (option == 'M') {
+            config->maxLength = strtoull(optarg, &end, 10);
+        } else if (option == 'g') {
+            config->lengthDistribution = WORKLOAD_GEOMETRIC;
+            continue;
+        } else if (option == 'f') {
+            config->fanOut = strtoul(optarg, &end, 10);
+        } else if (option == 't') {
+            config->sharedTargets = strtod(optarg, &end);
+        } else if (option == 's') {
+            config->specialDigits = strtod(optarg, &end);
+        } else if (option == 'S') {
+            config->seed = strtoull(optarg, &end, 10);
+        } else {
+            return false;
+        }
+        if (end == optarg || *end != '\0') {
+            return false;
+        }
+    }
+    return optind == argc;
+}
+
+/** The main function of the benchmark.
+ * @param[in] argc - the number of arguments;
+ * @param[in] argv - the arguments described in the description of the file.
+ * @return 0 if the benchmark succeeded, 1 otherwise.
+ */
+int main(int argc, char *argv[]) {
+    WorkloadConfig config;
+    Workload *workload = NULL;
+    if (!parseArguments(argc, argv, &config) || (workload = workloadNew(&config)) == NULL) {
+        fprintf(stderr, "Usage: %s [-r rules] [-q queries] [-m minimal length] [-M maximal length] [-g] "
+                        "[-f fan-out 1-10] [-t shared targets 0-1] [-s special digits 0-1] [-S seed]\n", argv[0]);
+        return 1;
+    }
+
+    // Forwardings are removed from a second structure, so the first one is deleted full.
+    PhoneForward *pf = phfwdNew();
+    PhoneForward *removed = phfwdNew();
+    bool measured = pf != NULL && removed != NULL;
+    for (size_t i = 0; measured && i < workload->rules; i++) {
+        phfwdAdd(removed, workload->num1[i], workload->num2[i]);
+    }
+
+    printf("operation,ops,seconds,ops_per_sec,p50_ns,p90_ns,p99_ns,max_ns,peak_rss_kb,allocations\n");
+    measured = measured && measure("add", pf, workload, workload->rules, addRule)
+               && measure("get", pf, workload, workload->queries, getQuery)
+               && measure("reverse", pf, workload, workload->queries, reverseQuery)
+               && measure("get_reverse", pf, workload, workload->queries, getReverseQuery)
+               && measure("remove", removed, workload, workload->rules, removeRule);
+    if (measured) {
+        measureDelete(pf);
+    } else {
+        phfwdDelete(pf);
+    }
+    phfwdDelete(removed);
+    workloadDelete(workload);
+    return measured ? 0 : 1;
+}
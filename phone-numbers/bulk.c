@@ -0,0 +1,635 @@
+/** @file
+ * The main module of a class building the tries of phone number forwarding from many forwardings
+ *
+ * Numbers are sorted by a radix sort, and the subtrees of the roots are built in the
+ * depth-first order, in consecutive elements of the pools, by many threads.
+ *
+ * @author Emilia Dębicka <ed438406@students.mimuw.edu.pl>
+ * @copyright University of Warsaw
+ * @date 2022
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "bulk.h"
+#include "number.h"
+#include "phone_forward.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * A macro that stores the maximal number of threads used by @ref bulkBuild.
+ */
+#define BULK_THREADS 8
+
+/**
+ * A macro that stores the smallest number of forwardings added by @ref bulkBuild
+ * in many threads.
+ */
+#define BULK_PARALLEL_RULES 16384
+
+/**
+ * A macro that stores the inital size of the stack of nodes built by @ref bulkBuild.
+ */
+#define INITIAL_FRAMES_SIZE 64
+
+/**
+ * A macro that stores the inital size of the stack of ranges sorted by @ref bulkSort.
+ */
+#define INITIAL_RANGES_SIZE 64
+
+/**
+ * A macro that stores the largest range sorted by @ref bulkSort with insertion.
+ */
+#define RADIX_SORT_MIN 16
+
+/**
+ * The structure stores a node waiting to be built by @ref buildBulkTask. The node is
+ * the root of the trie of the numbers from @p begin to @p end, which have the same
+ * first @p depth digits.
+ */
+typedef struct BulkFrame {
+    /**@{*/
+    size_t begin; /**< The first number of the trie. */
+    size_t end; /**< The position after the last number of the trie. */
+    size_t depth; /**< The number of digits leading to the node. */
+    uint8_t kind; /**< The kind of the trie, from @ref FORWARD_NODE to @ref SOURCE_NODE. */
+    bool root; /**< A boolean informing if the node is the root of a trie, with an empty label. */
+    NodeId *slot; /**< The place where the index of the node is stored or NULL when counting. */
+    /**@}*/
+} BulkFrame;
+
+/**
+ * The structure stores a subtree of a root built by one thread of @ref bulkBuild.
+ * The nodes and arrays of the subtree are counted first, then they are built in consecutive
+ * elements of the pools.
+ */
+typedef struct BulkTask {
+    /**@{*/
+    BulkFrame first; /**< The root of the subtree. */
+    uint32_t nodes; /**< The number of nodes, then the index of the next built node. */
+    uint32_t smallArrays; /**< The number of arrays of @ref SMALL_CAPACITY children, then the next one. */
+    uint32_t digitArrays; /**< The number of arrays of @ref NUMBER_OF_DIGITS children, then the next one. */
+    BulkFrame *frames; /**< The stack of nodes waiting to be built. */
+    size_t framesSize; /**< The size of @p frames array. */
+    /**@}*/
+} BulkTask;
+
+/**
+ * The structure stores a range of numbers sorted by @ref bulkSort.
+ */
+typedef struct SortRange {
+    /**@{*/
+    size_t begin; /**< The first forwarding of the range. */
+    size_t end; /**< The position after the last forwarding of the range. */
+    size_t depth; /**< The number of first digits shared by the numbers of the range. */
+    /**@}*/
+} SortRange;
+
+/**
+ * The structure stores the state of @ref bulkBuild.
+ */
+typedef struct BulkBuilder {
+    /**@{*/
+    BulkTrie const *trie; /**< The built tries. */
+    BulkKey *rules; /**< Numbers @p num1 of added forwardings, sorted. */
+    BulkKey *reverse; /**< Numbers @p num2 of added forwardings, sorted by them and then by @p num1. */
+    BulkTask tasks[2 * NUMBER_OF_DIGITS]; /**< Subtrees of the roots of the trie and the reverse index. */
+    size_t tasksCount; /**< The number of subtrees. */
+    _Atomic size_t nextTask; /**< The next subtree that has not been taken by a thread. */
+    bool counting; /**< A boolean informing if the nodes are only counted. */
+    _Atomic bool failed; /**< A boolean informing if a thread failed to allocate memory. */
+    /**@}*/
+} BulkBuilder;
+
+void bulkInitKey(BulkKey *key, char const *num, size_t numSize, BulkRule *rule) {
+    key->prefix = 0;
+    for (size_t i = 0; i < numSize && i < LABEL_CAPACITY; i++) {
+        key->prefix |= (uint64_t) charToDigit(num[i]) << (60 - 4 * i);
+    }
+    key->size = numSize;
+    key->num = num;
+    key->rule = rule;
+}
+
+/** Function returns a digit of a key.
+ * @param[in] key - a pointer to the key;
+ * @param[in] i - the index of the digit, smaller than the size of the number.
+ * @return The digit, from 0 to 11.
+ */
+static inline int keyDigit(BulkKey const *key, size_t i) {
+    return i < LABEL_CAPACITY ? (int) (key->prefix >> (60 - 4 * i)) & 0xf : charToDigit(key->num[i]);
+}
+
+/** Function compares the numbers of keys in the order of digits.
+ * @param[in] a - a pointer to the first key;
+ * @param[in] b - a pointer to the second key;
+ * @param[in] depth - the number of first digits known to be equal.
+ * @return A negative integer if the number of @p a is lexicographically smaller,
+ * positive if it is larger, 0 if the numbers are equal.
+ */
+static int compareKeys(BulkKey const *a, BulkKey const *b, size_t depth) {
+    if (depth < LABEL_CAPACITY && a->prefix != b->prefix) {
+        return a->prefix < b->prefix ? -1 : 1;
+    }
+    size_t size = a->size < b->size ? a->size : b->size;
+    if (size > LABEL_CAPACITY) {
+        int result = numberCompare(a->num + LABEL_CAPACITY, size - LABEL_CAPACITY, b->num + LABEL_CAPACITY,
+                                   size - LABEL_CAPACITY);
+        if (result != 0) {
+            return result;
+        }
+    }
+    return (a->size > b->size) - (a->size < b->size);
+}
+
+int bulkCompare(BulkKey const *a, BulkKey const *b) {
+    return compareKeys(a, b, 0);
+}
+
+bool bulkSort(BulkKey *keys, size_t count) {
+    BulkKey *buffer = malloc(count * sizeof(BulkKey));
+    SortRange *ranges = malloc(INITIAL_RANGES_SIZE * sizeof(SortRange));
+    size_t rangesCount = 0, rangesSize = INITIAL_RANGES_SIZE;
+    bool sorted = buffer != NULL && ranges != NULL;
+    if (sorted) {
+        SortRange all = {0, count, 0};
+        ranges[rangesCount++] = all;
+    }
+
+    while (sorted && rangesCount > 0) {
+        SortRange range = ranges[--rangesCount];
+        if (range.end - range.begin <= RADIX_SORT_MIN) {
+            for (size_t i = range.begin + 1; i < range.end; i++) {
+                BulkKey key = keys[i];
+                size_t j = i;
+                while (j > range.begin && compareKeys(&keys[j - 1], &key, range.depth) > 0) {
+                    keys[j] = keys[j - 1];
+                    j--;
+                }
+                keys[j] = key;
+            }
+            continue;
+        }
+
+        // Bucket 0 stores numbers that end before the digit, bucket d + 1 the digit d.
+        size_t starts[NUMBER_OF_DIGITS + 2] = {0};
+        for (size_t i = range.begin; i < range.end; i++) {
+            starts[(keys[i].size > range.depth ? keyDigit(&keys[i], range.depth) + 1 : 0) + 1]++;
+        }
+        starts[0] = range.begin;
+        for (int b = 1; b <= NUMBER_OF_DIGITS + 1; b++) {
+            starts[b] += starts[b - 1];
+        }
+        size_t positions[NUMBER_OF_DIGITS + 1];
+        memcpy(positions, starts, sizeof(positions));
+        for (size_t i = range.begin; i < range.end; i++) {
+            buffer[positions[keys[i].size > range.depth ? keyDigit(&keys[i], range.depth) + 1 : 0]++] = keys[i];
+        }
+        memcpy(keys + range.begin, buffer + range.begin, (range.end - range.begin) * sizeof(BulkKey));
+
+        for (int b = NUMBER_OF_DIGITS; b >= 1 && sorted; b--) {
+            if (starts[b + 1] - starts[b] < 2) {
+                continue;
+            }
+            if (rangesCount == rangesSize) {
+                SortRange *newRanges = realloc(ranges, 2 * rangesSize * sizeof(SortRange));
+                if (newRanges == NULL) {
+                    sorted = false;
+                    break;
+                }
+                ranges = newRanges;
+                rangesSize *= 2;
+            }
+            SortRange bucket = {starts[b], starts[b + 1], range.depth + 1};
+            ranges[rangesCount++] = bucket;
+        }
+    }
+    free(buffer);
+    free(ranges);
+    return sorted;
+}
+
+/** Function returns the number of digits of a number of a trie built by @ref bulkBuild.
+ * @param[in] builder - a pointer to the state of @ref bulkBuild;
+ * @param[in] kind - the kind of the trie, from @ref FORWARD_NODE to @ref SOURCE_NODE;
+ * @param[in] i - the position of the number.
+ * @return The number of digits.
+ */
+static inline size_t bulkSize(BulkBuilder const *builder, uint8_t kind, size_t i) {
+    if (kind == SOURCE_NODE) {
+        return builder->reverse[i].rule->num1Size;
+    }
+    return kind == FORWARD_NODE ? builder->rules[i].size : builder->reverse[i].size;
+}
+
+/** Function returns a digit of a number of a trie built by @ref bulkBuild.
+ * Tries of numbers forwarded to one number are small, so their numbers are read directly.
+ * @param[in] builder - a pointer to the state of @ref bulkBuild;
+ * @param[in] kind - the kind of the trie, from @ref FORWARD_NODE to @ref SOURCE_NODE;
+ * @param[in] i - the position of the number;
+ * @param[in] depth - the index of the digit, smaller than the size of the number.
+ * @return The digit, from 0 to 11.
+ */
+static inline int bulkDigit(BulkBuilder const *builder, uint8_t kind, size_t i, size_t depth) {
+    if (kind == SOURCE_NODE) {
+        return charToDigit(builder->reverse[i].rule->num1[depth]);
+    }
+    return keyDigit(kind == FORWARD_NODE ? &builder->rules[i] : &builder->reverse[i], depth);
+}
+
+/** Function divides sorted numbers into groups with the same digit at a given position.
+ * @param[in] builder - a pointer to the state of @ref bulkBuild;
+ * @param[in] kind - the kind of the trie, from @ref FORWARD_NODE to @ref SOURCE_NODE;
+ * @param[in] begin - the position of the first number;
+ * @param[in] end - the position after the last number, all numbers have more than @p depth digits;
+ * @param[in] depth - the position of the compared digit;
+ * @param[out] starts - a pointer to the array of at least @ref NUMBER_OF_DIGITS + 1 elements,
+ * which stores the positions of the first numbers of the groups and @p end;
+ * @param[out] digits - a pointer to the array of at least @ref NUMBER_OF_DIGITS elements,
+ * which stores the digits of the groups.
+ * @return The number of groups.
+ */
+static int findBulkGroups(BulkBuilder const *builder, uint8_t kind, size_t begin, size_t end, size_t depth,
+                          size_t *starts, uint8_t *digits) {
+    int count = 0;
+    while (begin < end) {
+        int digit = bulkDigit(builder, kind, begin, depth);
+        // The group ends before the first number with a larger digit, often it is the last group.
+        size_t low = begin + 1, high = end;
+        if (bulkDigit(builder, kind, end - 1, depth) == digit) {
+            low = end;
+        }
+        while (low < high) {
+            size_t middle = low + (high - low) / 2;
+            if (bulkDigit(builder, kind, middle, depth) <= digit) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        starts[count] = begin;
+        digits[count++] = digit;
+        begin = low;
+    }
+    starts[count] = end;
+    return count;
+}
+
+/** Function returns the capacity of a node with a given number of children.
+ * @param[in] count - the number of children.
+ * @return The smallest capacity used for @p count children.
+ */
+static inline uint8_t childrenCapacity(int count) {
+    return count <= 1 ? count : count <= SMALL_CAPACITY ? SMALL_CAPACITY : NUMBER_OF_DIGITS;
+}
+
+/** Function returns the pool of arrays of children of a given capacity.
+ * @param[in] trie - a pointer to the built tries;
+ * @param[in] capacity - @ref SMALL_CAPACITY or @ref NUMBER_OF_DIGITS.
+ * @return A pointer to the pool.
+ */
+static inline Pool *arrayPool(BulkTrie const *trie, uint8_t capacity) {
+    return capacity == NUMBER_OF_DIGITS ? trie->digitArrays : trie->smallArrays;
+}
+
+/** Function adds a node to the stack of a subtree built by @ref bulkBuild.
+ * @param[in, out] task - a pointer to the subtree;
+ * @param[in, out] count - a pointer to the number of nodes on the stack;
+ * @param[in] frame - the added node.
+ * @return Value @p false if failed to allocate memory. Otherwise @p true.
+ */
+static bool pushBulkFrame(BulkTask *task, size_t *count, BulkFrame frame) {
+    if (*count == task->framesSize) {
+        size_t framesSize = task->framesSize == 0 ? INITIAL_FRAMES_SIZE : 2 * task->framesSize;
+        BulkFrame *frames = realloc(task->frames, framesSize * sizeof(BulkFrame));
+        if (frames == NULL) {
+            return false;
+        }
+        task->frames = frames;
+        task->framesSize = framesSize;
+    }
+    task->frames[(*count)++] = frame;
+    return true;
+}
+
+/** Function counts or builds a subtree of a root.
+ * Nodes are built in the depth-first order, each one has the longest label shared by
+ * all its numbers, but at most @ref LABEL_CAPACITY digits. When counting, function
+ * counts the nodes and arrays of the subtree and the stack grows to the size needed
+ * by building, so building can not fail.
+ * @param[in, out] builder - a pointer to the state of @ref bulkBuild;
+ * @param[in, out] task - a pointer to the subtree.
+ * @return Value @p false if failed to allocate memory. Otherwise @p true.
+ */
+static bool buildBulkTask(BulkBuilder *builder, BulkTask *task) {
+    BulkTrie const *trie = builder->trie;
+    size_t framesCount = 0;
+    if (!pushBulkFrame(task, &framesCount, task->first)) {
+        return false;
+    }
+    while (framesCount > 0) {
+        BulkFrame frame = task->frames[--framesCount];
+        size_t firstSize = bulkSize(builder, frame.kind, frame.begin);
+        size_t lastSize = bulkSize(builder, frame.kind, frame.end - 1);
+        // Numbers are sorted, so the first and the last one share the shortest prefix.
+        size_t end = frame.depth;
+        if (!frame.root) {
+            size_t limit = firstSize < lastSize ? firstSize : lastSize;
+            if (limit > frame.depth + LABEL_CAPACITY) {
+                limit = frame.depth + LABEL_CAPACITY;
+            }
+            while (end < limit
+                   && bulkDigit(builder, frame.kind, frame.begin, end)
+                          == bulkDigit(builder, frame.kind, frame.end - 1, end)) {
+                end++;
+            }
+        }
+
+        NodeId id = task->nodes++;
+        Node *node = NULL;
+        if (!builder->counting) {
+            node = poolGet(trie->nodes, id);
+            node->next = POOL_NONE;
+            node->forward = POOL_NONE;
+            node->label = 0;
+            node->labelLength = end - frame.depth;
+            for (size_t i = frame.depth; i < end; i++) {
+                node->label |= (uint64_t) bulkDigit(builder, frame.kind, frame.begin, i) << (60 - 4 * (i - frame.depth));
+            }
+            node->shared = trie->shared;
+            *frame.slot = id;
+        }
+
+        size_t begin = frame.begin;
+        BulkFrame sources = {0, 0, 0, SOURCE_NODE, true, NULL};
+        if (firstSize == end && frame.kind == REVERSE_NODE) {
+            // Numbers forwarded to the number ending in the node form its own trie.
+            sources.begin = begin;
+            while (begin < frame.end && builder->reverse[begin].size == end) {
+                begin++;
+            }
+            sources.end = begin;
+            sources.slot = node != NULL ? &node->forward : NULL;
+        } else if (firstSize == end) {
+            if (node != NULL) {
+                node->forward = frame.kind == FORWARD_NODE ? builder->rules[begin].rule->forward : SOURCE_MARK;
+            }
+            begin++;
+        }
+
+        size_t starts[NUMBER_OF_DIGITS + 1];
+        uint8_t digits[NUMBER_OF_DIGITS];
+        int count = findBulkGroups(builder, frame.kind, begin, frame.end, end, starts, digits);
+        uint8_t capacity = childrenCapacity(count);
+        NodeId *children = NULL;
+        if (capacity > 1) {
+            uint32_t *next = capacity == NUMBER_OF_DIGITS ? &task->digitArrays : &task->smallArrays;
+            uint32_t array = (*next)++;
+            if (node != NULL) {
+                node->next = array;
+                children = poolGet(arrayPool(trie, capacity), array);
+                for (int i = 0; i < capacity; i++) {
+                    children[i] = POOL_NONE;
+                }
+            }
+        }
+        if (node != NULL) {
+            node->capacity = capacity;
+            node->numberOfNextDigits = count;
+        }
+
+        // Children are taken from the stack in the order of digits.
+        for (int i = count - 1; i >= 0; i--) {
+            BulkFrame child = {starts[i], starts[i + 1], end, frame.kind, false, NULL};
+            if (node != NULL && capacity == 1) {
+                node->keys[0] = digits[i];
+                child.slot = &node->next;
+            } else if (node != NULL && capacity == SMALL_CAPACITY) {
+                node->keys[i] = digits[i];
+                child.slot = &children[i];
+            } else if (node != NULL) {
+                child.slot = &children[digits[i]];
+            }
+            if (!pushBulkFrame(task, &framesCount, child)) {
+                return false;
+            }
+        }
+        if (sources.end > sources.begin && !pushBulkFrame(task, &framesCount, sources)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/** Function counts or builds the subtrees taken from the state of @ref bulkBuild.
+ * @param[in, out] arg - a pointer to the state of @ref bulkBuild.
+ * @return NULL.
+ */
+static void *runBulkTasks(void *arg) {
+    BulkBuilder *builder = arg;
+    size_t i;
+    while ((i = atomic_fetch_add(&builder->nextTask, 1)) < builder->tasksCount) {
+        if (!buildBulkTask(builder, &builder->tasks[i])) {
+            atomic_store(&builder->failed, true);
+        }
+    }
+    return NULL;
+}
+
+/** Function counts or builds all subtrees in many threads.
+ * Subtrees of different roots and first digits are disjoint, so they are built in parallel.
+ * If a thread can not be started, its subtrees are built by the others.
+ * @param[in, out] builder - a pointer to the state of @ref bulkBuild;
+ * @param[in] threads - the number of threads, at most @ref BULK_THREADS.
+ * @return Value @p false if failed to allocate memory. Otherwise @p true.
+ */
+static bool runBulkThreads(BulkBuilder *builder, size_t threads) {
+    pthread_t ids[BULK_THREADS];
+    size_t started = 0;
+    atomic_store(&builder->nextTask, 0);
+    while (started + 1 < threads && pthread_create(&ids[started], NULL, runBulkTasks, builder) == 0) {
+        started++;
+    }
+    runBulkTasks(builder);
+    for (size_t i = 0; i < started; i++) {
+        pthread_join(ids[i], NULL);
+    }
+    return !atomic_load(&builder->failed);
+}
+
+/** Function divides the numbers of a trie into subtrees of its root.
+ * @param[in, out] builder - a pointer to the state of @ref bulkBuild;
+ * @param[in] kind - @ref FORWARD_NODE or @ref REVERSE_NODE;
+ * @param[in] count - the number of numbers.
+ */
+static void planBulkRoot(BulkBuilder *builder, uint8_t kind, size_t count) {
+    size_t starts[NUMBER_OF_DIGITS + 1];
+    uint8_t digits[NUMBER_OF_DIGITS];
+    int groups = findBulkGroups(builder, kind, 0, count, 0, starts, digits);
+    for (int i = 0; i < groups; i++) {
+        BulkTask *task = &builder->tasks[builder->tasksCount++];
+        BulkFrame first = {starts[i], starts[i + 1], 0, kind, false, NULL};
+        task->first = first;
+        task->nodes = 0;
+        task->smallArrays = 0;
+        task->digitArrays = 0;
+        task->frames = NULL;
+        task->framesSize = 0;
+    }
+}
+
+/** Function allocates the counted nodes and arrays of all subtrees.
+ * @param[in, out] builder - a pointer to the state of @ref bulkBuild.
+ * @return Value @p false if failed to allocate memory. Otherwise @p true.
+ */
+static bool reserveBulk(BulkBuilder *builder) {
+    BulkTrie const *trie = builder->trie;
+    for (size_t i = 0; i < builder->tasksCount; i++) {
+        BulkTask *task = &builder->tasks[i];
+        task->nodes = poolAllocRange(trie->nodes, task->nodes);
+        if (task->nodes == POOL_NONE) {
+            return false;
+        }
+        if (task->smallArrays > 0) {
+            task->smallArrays = poolAllocRange(arrayPool(trie, SMALL_CAPACITY), task->smallArrays);
+            if (task->smallArrays == POOL_NONE) {
+                return false;
+            }
+        }
+        if (task->digitArrays > 0) {
+            task->digitArrays = poolAllocRange(arrayPool(trie, NUMBER_OF_DIGITS), task->digitArrays);
+            if (task->digitArrays == POOL_NONE) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/** Function connects the subtrees to the empty roots.
+ * Function sets the places where the subtrees store their first nodes.
+ * @param[in, out] builder - a pointer to the state of @ref bulkBuild.
+ * @return Value @p false if failed to allocate memory, then the roots stay empty.
+ * Otherwise @p true.
+ */
+static bool linkBulkRoots(BulkBuilder *builder) {
+    BulkTrie const *trie = builder->trie;
+    NodeId const roots[2] = {trie->root, trie->reverseRoot};
+    int counts[2] = {0, 0};
+    for (size_t i = 0; i < builder->tasksCount; i++) {
+        counts[builder->tasks[i].first.kind == REVERSE_NODE]++;
+    }
+    uint32_t arrays[2] = {POOL_NONE, POOL_NONE};
+    for (int k = 0; k < 2; k++) {
+        uint8_t capacity = childrenCapacity(counts[k]);
+        if (capacity > 1) {
+            arrays[k] = poolAlloc(arrayPool(trie, capacity));
+            if (arrays[k] == POOL_NONE) {
+                if (k == 1 && arrays[0] != POOL_NONE) {
+                    poolFree(arrayPool(trie, childrenCapacity(counts[0])), arrays[0]);
+                }
+                return false;
+            }
+        }
+    }
+
+    size_t task = 0;
+    for (int k = 0; k < 2; k++) {
+        Node *node = poolGet(trie->nodes, roots[k]);
+        node->capacity = childrenCapacity(counts[k]);
+        node->numberOfNextDigits = counts[k];
+        node->next = arrays[k];
+        NodeId *children = node->capacity > 1 ? poolGet(arrayPool(trie, node->capacity), node->next) : NULL;
+        for (int i = 0; i < node->capacity && children != NULL; i++) {
+            children[i] = POOL_NONE;
+        }
+        for (int i = 0; i < counts[k]; i++, task++) {
+            BulkTask *bulkTask = &builder->tasks[task];
+            int digit = bulkDigit(builder, bulkTask->first.kind, bulkTask->first.begin, 0);
+            if (node->capacity == 1) {
+                node->keys[0] = digit;
+                bulkTask->first.slot = &node->next;
+            } else if (node->capacity == SMALL_CAPACITY) {
+                node->keys[i] = digit;
+                bulkTask->first.slot = &children[i];
+            } else {
+                bulkTask->first.slot = &children[digit];
+            }
+        }
+    }
+    return true;
+}
+
+bool bulkBuild(BulkTrie const *trie, BulkKey *keys, size_t count, BulkSize *size) {
+    BulkBuilder *builder = malloc(sizeof(BulkBuilder));
+    BulkKey *reverse = builder != NULL ? malloc(count * sizeof(BulkKey)) : NULL;
+    bool built = reverse != NULL;
+
+    if (built) {
+        // Keys are sorted by num1, so after a stable sort by num2 they are sorted by both.
+        bool sorted = true;
+        for (size_t i = 0; i < count; i++) {
+            BulkRule *rule = keys[i].rule;
+            bulkInitKey(&reverse[i], rule->num2, rule->num2Size, rule);
+            sorted = sorted && (i == 0 || compareKeys(&reverse[i - 1], &reverse[i], 0) <= 0);
+        }
+        built = sorted || bulkSort(reverse, count);
+    }
+    if (built) {
+        builder->trie = trie;
+        builder->rules = keys;
+        builder->reverse = reverse;
+        builder->tasksCount = 0;
+        atomic_init(&builder->nextTask, 0);
+        atomic_init(&builder->failed, false);
+        planBulkRoot(builder, FORWARD_NODE, count);
+        planBulkRoot(builder, REVERSE_NODE, count);
+
+        size_t threads = 1;
+        if (count >= BULK_PARALLEL_RULES) {
+            long processors = sysconf(_SC_NPROCESSORS_ONLN);
+            threads = processors < 1 ? 1 : processors > BULK_THREADS ? BULK_THREADS : (size_t) processors;
+        }
+        builder->counting = true;
+        built = runBulkThreads(builder, threads);
+        // The counts of the subtrees are replaced by indices of their first elements when they are allocated.
+        size->nodes = 0;
+        size->bytes = 0;
+        size->allNodes = 0;
+        size->allBytes = 0;
+        for (size_t i = 0; built && i < builder->tasksCount; i++) {
+            BulkTask const *task = &builder->tasks[i];
+            size_t bytes = task->nodes * sizeof(Node) + task->smallArrays * SMALL_CAPACITY * sizeof(NodeId)
+                           + task->digitArrays * NUMBER_OF_DIGITS * sizeof(NodeId);
+            if (task->first.kind == FORWARD_NODE) {
+                size->nodes += task->nodes;
+                size->bytes += bytes;
+            }
+            size->allNodes += task->nodes;
+            size->allBytes += bytes;
+        }
+        built = built && reserveBulk(builder) && linkBulkRoots(builder);
+        if (built) {
+            builder->counting = false;
+            runBulkThreads(builder, threads);
+            // The roots had no children, so their arrays of children are new.
+            Node const *root = poolGet(trie->nodes, trie->root);
+            Node const *reverseRoot = poolGet(trie->nodes, trie->reverseRoot);
+            size_t rootArray = root->capacity > 1 ? root->capacity * sizeof(NodeId) : 0;
+            size_t reverseArray = reverseRoot->capacity > 1 ? reverseRoot->capacity * sizeof(NodeId) : 0;
+            size->bytes += rootArray;
+            size->allBytes += rootArray + reverseArray;
+        }
+        for (size_t i = 0; i < builder->tasksCount; i++) {
+            free(builder->tasks[i].frames);
+        }
+    }
+
+    free(reverse);
+    free(builder);
+    return built;
+}
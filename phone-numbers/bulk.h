@@ -0,0 +1,111 @@
+/** @file
+ * An interface for a class building the tries of phone number forwarding from many forwardings
+ *
+ * @author Emilia Dębicka <ed438406@students.mimuw.edu.pl>
+ * @copyright University of Warsaw
+ * @date 2022
+ */
+
+#ifndef __BULK_H__
+#define __BULK_H__
+
+#include "node.h"
+#include "pool.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * The structure stores a forwarding added by @ref phfwdAddBulk.
+ */
+typedef struct BulkRule {
+    /**@{*/
+    char const *num1; /**< The prefix of forwarded numbers. */
+    char const *num2; /**< The forwarding. */
+    size_t num1Size; /**< The number of digits of @p num1. */
+    size_t num2Size; /**< The number of digits of @p num2. */
+    uint32_t forward; /**< The index of the Target storing @p num2. */
+    /**@}*/
+} BulkRule;
+
+/**
+ * The structure stores a number of a forwarding sorted by @ref bulkSort. The first
+ * digits are copied, so sorting and building mostly do not read the number.
+ */
+typedef struct BulkKey {
+    /**@{*/
+    uint64_t prefix; /**< The first @ref LABEL_CAPACITY digits of @p num, stored like a label. */
+    size_t size; /**< The number of digits of @p num. */
+    char const *num; /**< The number. */
+    BulkRule *rule; /**< The forwarding. */
+    /**@}*/
+} BulkKey;
+
+/**
+ * The structure stores the tries built by @ref bulkBuild.
+ */
+typedef struct BulkTrie {
+    /**@{*/
+    Pool *nodes; /**< The pool of nodes. */
+    Pool *smallArrays; /**< The pool of arrays of @ref SMALL_CAPACITY children. */
+    Pool *digitArrays; /**< The pool of arrays of @ref NUMBER_OF_DIGITS children. */
+    NodeId root; /**< The root of the forwarding trie, with no children. */
+    NodeId reverseRoot; /**< The root of the reverse index, with no children. */
+    bool shared; /**< The value of @p shared of the built nodes. */
+    /**@}*/
+} BulkTrie;
+
+/**
+ * The structure stores the sizes of the parts added by @ref bulkBuild.
+ */
+typedef struct BulkSize {
+    /**@{*/
+    size_t nodes; /**< The number of nodes of the forwarding trie. */
+    size_t bytes; /**< Bytes of the nodes of the forwarding trie and of its arrays of children. */
+    size_t allNodes; /**< The number of nodes of both tries. */
+    size_t allBytes; /**< Bytes of the nodes of both tries and of their arrays of children. */
+    /**@}*/
+} BulkSize;
+
+/** Function creates the key of a number.
+ * @param[out] key - a pointer to the key;
+ * @param[in] num - a pointer to the number;
+ * @param[in] numSize - the number of digits of @p num;
+ * @param[in] rule - a pointer to the forwarding.
+ */
+void bulkInitKey(BulkKey *key, char const *num, size_t numSize, BulkRule *rule);
+
+/** Function compares the numbers of keys in the order of digits.
+ * @param[in] a - a pointer to the first key;
+ * @param[in] b - a pointer to the second key.
+ * @return A negative integer if the number of @p a is lexicographically smaller,
+ * positive if it is larger, 0 if the numbers are equal.
+ */
+int bulkCompare(BulkKey const *a, BulkKey const *b);
+
+/** Function sorts keys by their numbers.
+ * It is a stable radix sort starting from the first digit, so keys with equal numbers
+ * stay in their order. Short ranges are sorted by insertion.
+ * @param[in, out] keys - a pointer to the array of keys;
+ * @param[in] count - the number of keys.
+ * @return Value @p false if failed to allocate memory, then @p keys is not sorted.
+ * Otherwise @p true.
+ */
+bool bulkSort(BulkKey *keys, size_t count);
+
+/** Function builds the forwarding trie and the reverse index under empty roots.
+ * The subtrees of the roots are counted, their nodes are allocated in consecutive elements
+ * of the pools, and then they are built in the depth-first order, in many threads
+ * if there are many forwardings.
+ * @param[in] trie - a pointer to the pools and the roots;
+ * @param[in] keys - a pointer to the sorted keys of different @p num1 of the forwardings,
+ * whose targets are set;
+ * @param[in] count - the number of forwardings, at least 1;
+ * @param[out] size - a pointer to the sizes of the added nodes and arrays, including
+ * the arrays of children of the roots.
+ * @return Value @p false if failed to allocate memory, then the roots stay empty.
+ * Otherwise @p true.
+ */
+bool bulkBuild(BulkTrie const *trie, BulkKey *keys, size_t count, BulkSize *size);
+
+#endif /* __BULK_H__ */
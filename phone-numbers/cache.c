@@ -0,0 +1,255 @@
+/** @file
+ * Implementation of a class implementing a bounded cache of forwarded numbers
+ *
+ * @author Emilia Dębicka <ed438406@students.mimuw.edu.pl>
+ * @copyright University of Warsaw
+ * @date 2022
+ */
+
+#include "cache.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * A macro that stores the number of generations added at once when the array is too small.
+ */
+#define CACHE_GENERATIONS_STEP 1024
+
+/** Function calculates the hash of a result of a number.
+ * @param[in] kind - the kind of the result;
+ * @param[in] key - a pointer to the digits of the number;
+ * @param[in] keyLength - the number of digits of @p key.
+ * @return The hash of the number.
+ */
+static uint32_t hashKey(uint8_t kind, char const *key, size_t keyLength) {
+    uint32_t hash = (2166136261u ^ kind) * 16777619u;
+    for (size_t i = 0; i < keyLength; i++) {
+        hash = (hash ^ (uint8_t) key[i]) * 16777619u;
+    }
+    return hash;
+}
+
+bool cacheInit(ResultCache *cache, size_t capacity) {
+    if (capacity == 0 || capacity >= UINT32_MAX) {
+        return false;
+    }
+    size_t bucketsSize = 1;
+    while (bucketsSize < capacity) {
+        bucketsSize *= 2;
+    }
+    cache->entries = calloc(capacity + 1, sizeof(CacheEntry));
+    cache->buckets = malloc(bucketsSize * sizeof(uint32_t));
+    if (cache->entries == NULL || cache->buckets == NULL) {
+        free(cache->entries);
+        free(cache->buckets);
+        return false;
+    }
+    cache->bucketsSize = bucketsSize;
+    cache->capacity = capacity;
+    cache->generations = NULL;
+    cache->generationsSize = 0;
+    cache->stamp = 0;
+    cache->hits = 0;
+    cache->misses = 0;
+    cache->evictions = 0;
+    cache->invalidations = 0;
+    cacheClear(cache);
+    return true;
+}
+
+void cacheDestroy(ResultCache *cache) {
+    for (size_t i = 0; i <= cache->capacity; i++) {
+        free(cache->entries[i].block);
+    }
+    free(cache->entries);
+    free(cache->buckets);
+    free(cache->generations);
+}
+
+void cacheClear(ResultCache *cache) {
+    memset(cache->buckets, 0, cache->bucketsSize * sizeof(uint32_t));
+    cache->count = 0;
+    cache->newest = CACHE_NONE;
+    cache->oldest = CACHE_NONE;
+}
+
+void cacheAdvance(ResultCache *cache) {
+    if (cache->stamp == UINT32_MAX) {
+        // Old stamps could look newer than the next ones, so nothing stored earlier is kept.
+        cacheClear(cache);
+        memset(cache->generations, 0, cache->generationsSize * sizeof(uint32_t));
+        cache->stamp = 0;
+    }
+    cache->stamp++;
+}
+
+bool cacheTouch(ResultCache *cache, uint32_t id) {
+    if (id >= cache->generationsSize) {
+        size_t generationsSize = (size_t) id + CACHE_GENERATIONS_STEP;
+        uint32_t *generations = realloc(cache->generations, generationsSize * sizeof(uint32_t));
+        if (generations == NULL) {
+            return false;
+        }
+        memset(generations + cache->generationsSize, 0,
+               (generationsSize - cache->generationsSize) * sizeof(uint32_t));
+        cache->generations = generations;
+        cache->generationsSize = generationsSize;
+    }
+    cache->generations[id] = cache->stamp;
+    return true;
+}
+
+/** Function removes an entry from the list ordered by the time of use.
+ * @param[in, out] cache - a pointer to the cache;
+ * @param[in] index - the index of the entry.
+ */
+static void unlinkEntry(ResultCache *cache, uint32_t index) {
+    CacheEntry *entry = &cache->entries[index];
+    if (entry->newer != CACHE_NONE) {
+        cache->entries[entry->newer].older = entry->older;
+    } else {
+        cache->newest = entry->older;
+    }
+    if (entry->older != CACHE_NONE) {
+        cache->entries[entry->older].newer = entry->newer;
+    } else {
+        cache->oldest = entry->newer;
+    }
+}
+
+/** Function makes an entry the most recently used one.
+ * @param[in, out] cache - a pointer to the cache;
+ * @param[in] index - the index of the entry, which is not in the list.
+ */
+static void linkNewest(ResultCache *cache, uint32_t index) {
+    CacheEntry *entry = &cache->entries[index];
+    entry->newer = CACHE_NONE;
+    entry->older = cache->newest;
+    if (cache->newest != CACHE_NONE) {
+        cache->entries[cache->newest].newer = index;
+    } else {
+        cache->oldest = index;
+    }
+    cache->newest = index;
+}
+
+/** Function removes an entry from the cache.
+ * The last entry of the array is moved to its place, so the entries stay
+ * at indices from 1 to @p count. The block of the removed entry goes to the freed place.
+ * @param[in, out] cache - a pointer to the cache;
+ * @param[in] index - the index of the entry.
+ */
+static void removeEntry(ResultCache *cache, uint32_t index) {
+    uint32_t *slot = &cache->buckets[cache->entries[index].hash & (cache->bucketsSize - 1)];
+    while (*slot != index) {
+        slot = &cache->entries[*slot].bucketNext;
+    }
+    *slot = cache->entries[index].bucketNext;
+    unlinkEntry(cache, index);
+
+    uint32_t last = cache->count--;
+    if (last == index) {
+        return;
+    }
+    CacheEntry *moved = &cache->entries[last];
+    slot = &cache->buckets[moved->hash & (cache->bucketsSize - 1)];
+    while (*slot != last) {
+        slot = &cache->entries[*slot].bucketNext;
+    }
+    *slot = index;
+    if (moved->newer != CACHE_NONE) {
+        cache->entries[moved->newer].older = index;
+    } else {
+        cache->newest = index;
+    }
+    if (moved->older != CACHE_NONE) {
+        cache->entries[moved->older].newer = index;
+    } else {
+        cache->oldest = index;
+    }
+    uint32_t *block = cache->entries[index].block;
+    uint32_t blockSize = cache->entries[index].blockSize;
+    cache->entries[index] = *moved;
+    moved->block = block;
+    moved->blockSize = blockSize;
+}
+
+/** Function checks if none of the elements of the path of an entry has changed.
+ * @param[in] cache - a pointer to the cache;
+ * @param[in] entry - a pointer to the entry.
+ * @return Value @p true if the result is valid. Otherwise @p false.
+ */
+static bool isValid(ResultCache const *cache, CacheEntry const *entry) {
+    for (size_t i = 0; i < entry->pathSize; i++) {
+        uint32_t id = entry->block[i];
+        if (id < cache->generationsSize && cache->generations[id] > entry->stamp) {
+            return false;
+        }
+    }
+    return true;
+}
+
+CacheEntry const *cacheFind(ResultCache *cache, uint8_t kind, char const *key, size_t keyLength) {
+    if (keyLength <= CACHE_NUMBER_LENGTH) {
+        uint32_t hash = hashKey(kind, key, keyLength);
+        uint32_t index = cache->buckets[hash & (cache->bucketsSize - 1)];
+        while (index != CACHE_NONE) {
+            CacheEntry *entry = &cache->entries[index];
+            if (entry->hash == hash && entry->kind == kind && entry->keyLength == keyLength
+                && memcmp(cacheKey(entry), key, keyLength) == 0) {
+                if (!isValid(cache, entry)) {
+                    removeEntry(cache, index);
+                    cache->invalidations++;
+                    break;
+                }
+                unlinkEntry(cache, index);
+                linkNewest(cache, index);
+                cache->hits++;
+                return entry;
+            }
+            index = entry->bucketNext;
+        }
+    }
+    cache->misses++;
+    return NULL;
+}
+
+CacheEntry *cacheInsert(ResultCache *cache, uint8_t kind, char const *key, size_t keyLength, char const *value,
+                        size_t valueLength, uint32_t const *path, size_t pathSize) {
+    if (keyLength > CACHE_NUMBER_LENGTH || valueLength > CACHE_NUMBER_LENGTH || pathSize > CACHE_PATH_SIZE) {
+        return NULL;
+    }
+    if (cache->count == cache->capacity) {
+        removeEntry(cache, cache->oldest);
+        cache->evictions++;
+    }
+
+    CacheEntry *entry = &cache->entries[cache->count + 1];
+    size_t blockSize = pathSize * sizeof(uint32_t) + keyLength + valueLength;
+    if (blockSize > entry->blockSize) {
+        uint32_t *block = realloc(entry->block, blockSize);
+        if (block == NULL) {
+            return NULL;
+        }
+        entry->block = block;
+        entry->blockSize = blockSize;
+    }
+
+    uint32_t index = ++cache->count;
+    entry->hash = hashKey(kind, key, keyLength);
+    entry->stamp = cache->stamp;
+    entry->data = 0;
+    entry->pathSize = pathSize;
+    entry->kind = kind;
+    entry->keyLength = keyLength;
+    entry->valueLength = valueLength;
+    memcpy(entry->block, path, pathSize * sizeof(uint32_t));
+    char *digits = (char *) (entry->block + pathSize);
+    memcpy(digits, key, keyLength);
+    memcpy(digits + keyLength, value, valueLength);
+    uint32_t *bucket = &cache->buckets[entry->hash & (cache->bucketsSize - 1)];
+    entry->bucketNext = *bucket;
+    *bucket = index;
+    linkNewest(cache, index);
+    return entry;
+}
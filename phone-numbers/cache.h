@@ -0,0 +1,162 @@
+/** @file
+ * An interface for a class implementing a bounded cache of forwarded numbers
+ *
+ * @author Emilia Dębicka <ed438406@students.mimuw.edu.pl>
+ * @copyright University of Warsaw
+ * @date 2022
+ */
+
+#ifndef __CACHE_H__
+#define __CACHE_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A macro that stores the maximal number of digits of a cached number and of its result.
+ */
+#define CACHE_NUMBER_LENGTH UINT8_MAX
+
+/**
+ * A macro that stores the maximal number of elements on which a cached result depends.
+ */
+#define CACHE_PATH_SIZE 64
+
+/**
+ * A macro that stores the index that does not describe any entry.
+ */
+#define CACHE_NONE 0
+
+/**
+ * This is a structure of an entry of the cache. The result of a number stays valid
+ * as long as none of the elements of its path is touched by @ref cacheTouch.
+ * A number can have results of different kinds, which are separate entries.
+ * The path, the number and the result are stored one after another in @p block, which
+ * belongs to the place of the entry in the array, so it is reused by next entries.
+ */
+typedef struct CacheEntry {
+    /**@{*/
+    uint32_t hash; /**< The hash of @p key. */
+    uint32_t bucketNext; /**< The next entry of the same bucket or @ref CACHE_NONE. */
+    uint32_t newer; /**< The entry used later or @ref CACHE_NONE. */
+    uint32_t older; /**< The entry used earlier or @ref CACHE_NONE. */
+    uint32_t stamp; /**< The stamp of the cache when the result was stored. */
+    uint32_t data; /**< A number stored with the result by the user of the cache, initially 0. */
+    uint32_t *block; /**< Indices of elements on which the result depends, then digits of the number
+                          and of the result, not ended with '\0', or NULL. */
+    uint32_t blockSize; /**< The size of @p block in bytes. */
+    uint8_t pathSize; /**< The number of elements on which the result depends. */
+    uint8_t kind; /**< The kind of the result, chosen by the user of the cache. */
+    uint8_t keyLength; /**< The number of digits of the number. */
+    uint8_t valueLength; /**< The number of digits of the result. */
+    /**@}*/
+} CacheEntry;
+
+/** Function returns the digits of the number of an entry.
+ * @param[in] entry - a pointer to the entry.
+ * @return A pointer to @p keyLength digits.
+ */
+static inline char const *cacheKey(CacheEntry const *entry) {
+    return (char const *) (entry->block + entry->pathSize);
+}
+
+/** Function returns the digits of the result of an entry.
+ * @param[in] entry - a pointer to the entry.
+ * @return A pointer to @p valueLength digits.
+ */
+static inline char const *cacheValue(CacheEntry const *entry) {
+    return cacheKey(entry) + entry->keyLength;
+}
+
+/**
+ * This is a structure of a cache of results of numbers, which removes the least recently
+ * used entry when it is full. Entries are stored in one array, numbered from 1, in a hash
+ * table of lists and in a list ordered by the time of use. A change of an element is
+ * marked by writing the current stamp to @p generations, so only the results that depend
+ * on changed elements become invalid.
+ */
+typedef struct ResultCache {
+    /**@{*/
+    CacheEntry *entries; /**< An array of @p capacity + 1 entries, the first one is not used. Blocks
+                              of places after @p count are kept for next entries. */
+    uint32_t *buckets; /**< A hash table of entries, a bucket is a list linked by @p bucketNext. */
+    size_t bucketsSize; /**< The number of buckets, a power of 2. */
+    uint32_t capacity; /**< The maximal number of entries. */
+    uint32_t count; /**< The number of entries. */
+    uint32_t newest; /**< The most recently used entry or @ref CACHE_NONE. */
+    uint32_t oldest; /**< The least recently used entry or @ref CACHE_NONE. */
+    uint32_t *generations; /**< Stamps of the last changes of elements by their indices. */
+    size_t generationsSize; /**< The number of elements of @p generations. */
+    uint32_t stamp; /**< The stamp of the current change, increased by @ref cacheAdvance. */
+    size_t hits; /**< The number of valid results found. */
+    size_t misses; /**< The number of numbers without a valid result. */
+    size_t evictions; /**< The number of entries removed to make space for new ones. */
+    size_t invalidations; /**< The number of results found invalid, they are also misses. */
+    /**@}*/
+} ResultCache;
+
+/** Function initializes a cache.
+ * @param[out] cache - a pointer to the cache;
+ * @param[in] capacity - the maximal number of entries, at least 1.
+ * @return Value @p false if @p capacity is incorrect or failed to allocate memory.
+ * Otherwise @p true.
+ */
+bool cacheInit(ResultCache *cache, size_t capacity);
+
+/** Function frees the memory of a cache.
+ * @param[in, out] cache - a pointer to the cache.
+ */
+void cacheDestroy(ResultCache *cache);
+
+/** Function removes all entries of a cache.
+ * The counters and the blocks of entries are not changed.
+ * @param[in, out] cache - a pointer to the cache.
+ */
+void cacheClear(ResultCache *cache);
+
+/** Function starts a change of the elements.
+ * Function increases the stamp, so results stored earlier become invalid if any element
+ * of their paths is touched.
+ * @param[in, out] cache - a pointer to the cache.
+ */
+void cacheAdvance(ResultCache *cache);
+
+/** Function marks that an element has been changed.
+ * @param[in, out] cache - a pointer to the cache;
+ * @param[in] id - the index of the element.
+ * @return Value @p false if failed to allocate memory, then the cache should be cleared.
+ * Otherwise @p true.
+ */
+bool cacheTouch(ResultCache *cache, uint32_t id);
+
+/** Function finds the valid result of a number.
+ * A found entry becomes the most recently used one, an invalid one is removed.
+ * @param[in, out] cache - a pointer to the cache;
+ * @param[in] kind - the kind of the result;
+ * @param[in] key - a pointer to the digits of the number;
+ * @param[in] keyLength - the number of digits of @p key.
+ * @return A pointer to the entry, valid until the next change of the cache,
+ * or NULL if there is no valid result.
+ */
+CacheEntry const *cacheFind(ResultCache *cache, uint8_t kind, char const *key, size_t keyLength);
+
+/** Function stores the result of a number.
+ * If the cache is full, the least recently used entry is removed. Numbers and results
+ * longer than @ref CACHE_NUMBER_LENGTH and paths longer than @ref CACHE_PATH_SIZE
+ * are not stored.
+ * @param[in, out] cache - a pointer to the cache;
+ * @param[in] kind - the kind of the result;
+ * @param[in] key - a pointer to the digits of the number, which has no result of @p kind in the cache;
+ * @param[in] keyLength - the number of digits of @p key;
+ * @param[in] value - a pointer to the digits of the result;
+ * @param[in] valueLength - the number of digits of @p value;
+ * @param[in] path - an array of indices of elements on which the result depends;
+ * @param[in] pathSize - the number of elements of @p path.
+ * @return A pointer to the stored entry, valid until the next change of the cache,
+ * or NULL if the result is not stored or failed to allocate memory.
+ */
+CacheEntry *cacheInsert(ResultCache *cache, uint8_t kind, char const *key, size_t keyLength, char const *value,
+                        size_t valueLength, uint32_t const *path, size_t pathSize);
+
+#endif /* __CACHE_H__ */
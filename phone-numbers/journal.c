@@ -0,0 +1,382 @@
+/** @file
+ * The main module of a class storing changes of phone number forwarding in a file
+ *
+ * A journal starts with @ref JOURNAL_HEADER_SIZE bytes: @ref JOURNAL_MAGIC and the version of
+ * the format. Each record stores its type, the numbers of digits of both numbers written
+ * in 7-bit groups, the digits packed by @ref packNumber and the FNV-1a hash of all these bytes.
+ *
+ * @author Emilia Dębicka <ed438406@students.mimuw.edu.pl>
+ * @copyright University of Warsaw
+ * @date 2022
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "journal.h"
+#include "packed.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * A macro that stores the first bytes of a journal.
+ */
+#define JOURNAL_MAGIC "PHJRNL\0\0"
+
+/**
+ * A macro that stores the version of the format of a journal.
+ */
+#define JOURNAL_VERSION 1
+
+/**
+ * A macro that stores the size of the header of a journal.
+ */
+#define JOURNAL_HEADER_SIZE 16
+
+/**
+ * A macro that stores the maximal number of bytes of a number written in 7-bit groups.
+ */
+#define MAX_SIZE_BYTES 10
+
+/**
+ * A macro that stores the number of bytes of the hash of a record.
+ */
+#define HASH_BYTES 4
+
+/**
+ * A macro that stores the inital size of the buffer of records.
+ */
+#define INITIAL_BUFFER_SIZE 256
+
+/**
+ * A macro that stores the number of collected bytes that are written to the file
+ * even if they are not synchronized yet.
+ */
+#define FLUSH_SIZE (64 * 1024)
+
+/** Function calculates the hash of a record.
+ * @param[in] data - a pointer to the bytes of the record;
+ * @param[in] size - the number of bytes.
+ * @return The FNV-1a hash of the bytes.
+ */
+static uint32_t hashRecord(uint8_t const *data, size_t size) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/** Function writes a number in 7-bit groups, from the lowest one.
+ * @param[in] value - the written number;
+ * @param[out] data - a pointer to the array of at least @ref MAX_SIZE_BYTES bytes.
+ * @return The number of written bytes.
+ */
+static size_t putSize(size_t value, uint8_t *data) {
+    size_t size = 0;
+    while (value >= 0x80) {
+        data[size++] = (uint8_t) (value | 0x80);
+        value >>= 7;
+    }
+    data[size++] = (uint8_t) value;
+    return size;
+}
+
+/** Function reads a number written by @ref putSize.
+ * @param[in] data - a pointer to the read bytes;
+ * @param[in] end - the number of bytes that can be read;
+ * @param[in, out] position - a pointer to the position of the number, it is set after it;
+ * @param[out] value - a pointer to the read number.
+ * @return Value @p false if the number is incomplete or too long. Otherwise @p true.
+ */
+static bool getSize(uint8_t const *data, size_t end, size_t *position, size_t *value) {
+    *value = 0;
+    for (size_t i = 0; i < MAX_SIZE_BYTES && *position < end; i++) {
+        uint8_t byte = data[(*position)++];
+        *value |= (size_t) (byte & 0x7f) << (7 * i);
+        if (byte < 0x80) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/** Function writes bytes to a file.
+ * @param[in] file - the descriptor of the file;
+ * @param[in] data - a pointer to the bytes;
+ * @param[in] size - the number of bytes.
+ * @return Value @p false if the bytes could not be written. Otherwise @p true.
+ */
+static bool writeAll(int file, uint8_t const *data, size_t size) {
+    while (size > 0) {
+        ssize_t written = write(file, data, size);
+        if (written < 0 && errno != EINTR) {
+            return false;
+        }
+        if (written > 0) {
+            data += written;
+            size -= written;
+        }
+    }
+    return true;
+}
+
+/** Function writes the collected records to the file.
+ * @param[in, out] journal - a pointer to the journal.
+ * @return Value @p false if the records could not be written. Otherwise @p true.
+ */
+static bool flush(Journal *journal) {
+    if (!journal->failed && !writeAll(journal->file, journal->buffer, journal->bufferCount)) {
+        journal->failed = true;
+    }
+    journal->bufferCount = 0;
+    return !journal->failed;
+}
+
+/** Function reads the records of a journal stored in memory.
+ * @param[in] data - a pointer to the contents of the journal;
+ * @param[in] size - the size of the journal, at least @ref JOURNAL_HEADER_SIZE;
+ * @param[in] apply - a function applying a record or NULL if records are only checked;
+ * @param[in, out] userData - a pointer given to @p apply;
+ * @param[out] end - a pointer to the position after the last correct record.
+ * @return Value @p false if @p apply has returned @p false or failed to allocate memory.
+ * Otherwise @p true.
+ */
+static bool readRecords(uint8_t const *data, size_t size, JournalApply apply, void *userData, size_t *end) {
+    char *digits = NULL;
+    size_t digitsSize = 0;
+    bool read = true;
+    size_t position = JOURNAL_HEADER_SIZE;
+    *end = position;
+    while (read && position < size) {
+        size_t num1Size, num2Size;
+        uint8_t type = data[position++];
+        if ((type != JOURNAL_ADD && type != JOURNAL_REMOVE) || !getSize(data, size, &position, &num1Size)
+            || !getSize(data, size, &position, &num2Size) || num1Size == 0
+            || (type == JOURNAL_ADD) != (num2Size > 0)) {
+            break;
+        }
+        // Sizes are checked before any allocation, so a damaged record can not ask for too much.
+        if (num1Size > size || num2Size > size) {
+            break;
+        }
+        size_t packed1 = packedSize(num1Size), packed2 = packedSize(num2Size);
+        if (size - position < packed1 + packed2 + HASH_BYTES) {
+            break;
+        }
+        size_t hashPosition = position + packed1 + packed2;
+        uint32_t hash = (uint32_t) data[hashPosition] | (uint32_t) data[hashPosition + 1] << 8
+                        | (uint32_t) data[hashPosition + 2] << 16 | (uint32_t) data[hashPosition + 3] << 24;
+        if (hash != hashRecord(data + *end, hashPosition - *end)) {
+            break;
+        }
+
+        if (apply != NULL) {
+            if (num1Size + num2Size > digitsSize) {
+                free(digits);
+                digitsSize = 2 * (num1Size + num2Size);
+                digits = malloc(digitsSize * sizeof(char));
+                if (digits == NULL) {
+                    read = false;
+                    break;
+                }
+            }
+            unpackNumber(data + position, num1Size, digits);
+            unpackNumber(data + position + packed1, num2Size, digits + num1Size);
+            JournalRecord record = {type, digits, num1Size, digits + num1Size, num2Size};
+            read = apply(userData, &record);
+        }
+        position = hashPosition + HASH_BYTES;
+        *end = position;
+    }
+    free(digits);
+    return read;
+}
+
+/** Function checks the header of a journal.
+ * @param[in] data - a pointer to the contents of the journal;
+ * @param[in] size - the size of the journal.
+ * @return Value @p true if the file is a journal in this format. Otherwise @p false.
+ */
+static bool checkHeader(uint8_t const *data, size_t size) {
+    return size >= JOURNAL_HEADER_SIZE && memcmp(data, JOURNAL_MAGIC, 8) == 0 && data[8] == JOURNAL_VERSION
+           && data[9] == 0 && data[10] == 0 && data[11] == 0;
+}
+
+/** Function maps a journal to memory.
+ * @param[in] file - the descriptor of the file;
+ * @param[out] size - a pointer to the size of the file.
+ * @return A pointer to the contents of the file or NULL if it can not be read or is not a journal.
+ */
+static uint8_t *mapJournal(int file, size_t *size) {
+    struct stat status;
+    if (fstat(file, &status) != 0 || status.st_size < JOURNAL_HEADER_SIZE) {
+        return NULL;
+    }
+    *size = status.st_size;
+    uint8_t *data = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, file, 0);
+    if (data == MAP_FAILED) {
+        return NULL;
+    }
+    if (!checkHeader(data, *size)) {
+        munmap(data, *size);
+        return NULL;
+    }
+    return data;
+}
+
+Journal *journalOpen(char const *path, size_t syncBatch) {
+    Journal *journal = malloc(sizeof(Journal));
+    if (journal == NULL) {
+        return NULL;
+    }
+    journal->file = open(path, O_RDWR | O_CREAT, 0644);
+    journal->buffer = NULL;
+    journal->bufferCount = 0;
+    journal->bufferSize = 0;
+    journal->pendingCount = 0;
+    journal->syncBatch = syncBatch;
+    journal->failed = false;
+    if (journal->file < 0) {
+        free(journal);
+        return NULL;
+    }
+
+    bool opened;
+    struct stat status;
+    if (fstat(journal->file, &status) == 0 && status.st_size == 0) {
+        uint8_t header[JOURNAL_HEADER_SIZE] = {0};
+        memcpy(header, JOURNAL_MAGIC, 8);
+        header[8] = JOURNAL_VERSION;
+        opened = writeAll(journal->file, header, JOURNAL_HEADER_SIZE) && fdatasync(journal->file) == 0;
+    } else {
+        // New records have to follow the last correct one, so a damaged end is cut off.
+        size_t size, end;
+        uint8_t *data = mapJournal(journal->file, &size);
+        opened = data != NULL;
+        if (opened) {
+            readRecords(data, size, NULL, NULL, &end);
+            munmap(data, size);
+            opened = (end == size || ftruncate(journal->file, end) == 0)
+                     && lseek(journal->file, end, SEEK_SET) == (off_t) end;
+        }
+    }
+    if (!opened) {
+        close(journal->file);
+        free(journal);
+        return NULL;
+    }
+    return journal;
+}
+
+bool journalAppend(Journal *journal, int type, char const *num1, size_t num1Size, char const *num2,
+                   size_t num2Size) {
+    if (journal->failed) {
+        return false;
+    }
+    size_t recordSize = 1 + 2 * MAX_SIZE_BYTES + packedSize(num1Size) + packedSize(num2Size) + HASH_BYTES;
+    if (journal->bufferCount + recordSize > journal->bufferSize) {
+        size_t bufferSize = journal->bufferSize == 0 ? INITIAL_BUFFER_SIZE : 2 * journal->bufferSize;
+        if (bufferSize < journal->bufferCount + recordSize) {
+            bufferSize = journal->bufferCount + recordSize;
+        }
+        uint8_t *buffer = realloc(journal->buffer, bufferSize);
+        if (buffer == NULL) {
+            journal->failed = true;
+            return false;
+        }
+        journal->buffer = buffer;
+        journal->bufferSize = bufferSize;
+    }
+
+    uint8_t *record = journal->buffer + journal->bufferCount;
+    size_t size = 0;
+    record[size++] = (uint8_t) type;
+    size += putSize(num1Size, record + size);
+    size += putSize(num2Size, record + size);
+    packNumber(num1, num1Size, record + size);
+    size += packedSize(num1Size);
+    packNumber(num2, num2Size, record + size);
+    size += packedSize(num2Size);
+    uint32_t hash = hashRecord(record, size);
+    for (int i = 0; i < HASH_BYTES; i++) {
+        record[size++] = (uint8_t) (hash >> (8 * i));
+    }
+    journal->bufferCount += size;
+    journal->pendingCount++;
+
+    if (journal->syncBatch > 0 && journal->pendingCount >= journal->syncBatch) {
+        return journalSync(journal);
+    }
+    if (journal->bufferCount >= FLUSH_SIZE) {
+        return flush(journal);
+    }
+    return true;
+}
+
+bool journalSync(Journal *journal) {
+    if (flush(journal) && journal->pendingCount > 0 && fdatasync(journal->file) != 0) {
+        journal->failed = true;
+    }
+    journal->pendingCount = 0;
+    return !journal->failed;
+}
+
+bool journalReset(Journal *journal) {
+    journal->bufferCount = 0;
+    journal->pendingCount = 0;
+    // The journal is correct again after cutting off all records, even the damaged ones.
+    journal->failed = ftruncate(journal->file, JOURNAL_HEADER_SIZE) != 0
+                      || lseek(journal->file, JOURNAL_HEADER_SIZE, SEEK_SET) != JOURNAL_HEADER_SIZE
+                      || fdatasync(journal->file) != 0;
+    return !journal->failed;
+}
+
+bool journalClose(Journal *journal) {
+    if (journal == NULL) {
+        return true;
+    }
+    bool synced = journalSync(journal);
+    if (close(journal->file) != 0) {
+        synced = false;
+    }
+    free(journal->buffer);
+    free(journal);
+    return synced;
+}
+
+bool journalReplay(char const *path, JournalApply apply, void *data) {
+    int file = open(path, O_RDONLY);
+    if (file < 0) {
+        return false;
+    }
+    size_t size, end;
+    uint8_t *contents = mapJournal(file, &size);
+    close(file);
+    if (contents == NULL) {
+        return false;
+    }
+    bool replayed = readRecords(contents, size, apply, data, &end);
+    munmap(contents, size);
+    return replayed;
+}
+
+bool journalSyncDirectory(char const *path) {
+    // Function dirname can change its argument.
+    char *name = strdup(path);
+    if (name == NULL) {
+        return false;
+    }
+    int directory = open(dirname(name), O_RDONLY | O_DIRECTORY);
+    free(name);
+    if (directory < 0) {
+        return false;
+    }
+    bool synced = fsync(directory) == 0;
+    return close(directory) == 0 && synced;
+}
@@ -0,0 +1,128 @@
+/** @file
+ * An interface for a class storing changes of phone number forwarding in a file
+ *
+ * @author Emilia Dębicka <ed438406@students.mimuw.edu.pl>
+ * @copyright University of Warsaw
+ * @date 2022
+ */
+
+#ifndef __JOURNAL_H__
+#define __JOURNAL_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A macro that describes a record of an added forwarding.
+ */
+#define JOURNAL_ADD 1
+
+/**
+ * A macro that describes a record of removed forwardings.
+ */
+#define JOURNAL_REMOVE 2
+
+/**
+ * This is a structure of a journal, a file to which records of changes are appended.
+ * Records are collected in a buffer and written to the disk in groups of @p syncBatch,
+ * so one synchronization with the disk is shared by many changes.
+ */
+typedef struct Journal {
+    /**@{*/
+    int file; /**< The descriptor of the file. */
+    uint8_t *buffer; /**< Records that have not been written to the file yet. */
+    size_t bufferCount; /**< The number of bytes in @p buffer. */
+    size_t bufferSize; /**< The size of @p buffer array. */
+    size_t pendingCount; /**< The number of records that have not been synchronized with the disk. */
+    size_t syncBatch; /**< The number of records synchronized at once, 0 if only on demand. */
+    bool failed; /**< A boolean informing if a record could not be written. */
+    /**@}*/
+} Journal;
+
+/**
+ * The structure stores a record read from a journal.
+ */
+typedef struct JournalRecord {
+    /**@{*/
+    int type; /**< @ref JOURNAL_ADD or @ref JOURNAL_REMOVE. */
+    char const *num1; /**< The digits of the prefix of changed numbers. */
+    size_t num1Size; /**< The number of digits of @p num1. */
+    char const *num2; /**< The digits of the forwarding of an added record. */
+    size_t num2Size; /**< The number of digits of @p num2, 0 for a removed record. */
+    /**@}*/
+} JournalRecord;
+
+/**
+ * A function applying a record read from a journal. It gets a pointer given to
+ * @ref journalReplay and the record, and returns @p false if the reading should stop.
+ */
+typedef bool (*JournalApply)(void *data, JournalRecord const *record);
+
+/** Function opens a journal.
+ * Function creates the file if it does not exist. Otherwise new records are appended
+ * after the records of the file, and an incomplete record at its end, left by an interrupted
+ * write, is removed.
+ * @param[in] path - the name of the file;
+ * @param[in] syncBatch - the number of records synchronized with the disk at once,
+ * 0 if records are synchronized only by @ref journalSync.
+ * @return A pointer to the journal or NULL if the file is not a journal, can not be opened
+ * or failed to allocate memory.
+ */
+Journal *journalOpen(char const *path, size_t syncBatch);
+
+/** Function appends a record to a journal.
+ * The record is synchronized with the disk when @p syncBatch records are collected.
+ * @param[in, out] journal - a pointer to the journal;
+ * @param[in] type - @ref JOURNAL_ADD or @ref JOURNAL_REMOVE;
+ * @param[in] num1 - a pointer to the digits of the prefix of changed numbers;
+ * @param[in] num1Size - the number of digits of @p num1, at least 1;
+ * @param[in] num2 - a pointer to the digits of the forwarding, not used for @ref JOURNAL_REMOVE;
+ * @param[in] num2Size - the number of digits of @p num2, 0 for @ref JOURNAL_REMOVE.
+ * @return Value @p false if the record could not be written. Then next records are not
+ * appended until @ref journalReset. Otherwise @p true.
+ */
+bool journalAppend(Journal *journal, int type, char const *num1, size_t num1Size, char const *num2,
+                   size_t num2Size);
+
+/** Function synchronizes a journal with the disk.
+ * Function writes the collected records and waits until they are stored on the disk.
+ * @param[in, out] journal - a pointer to the journal.
+ * @return Value @p false if any record could not be written. Otherwise @p true.
+ */
+bool journalSync(Journal *journal);
+
+/** Function removes all records of a journal.
+ * @param[in, out] journal - a pointer to the journal.
+ * @return Value @p false if the file could not be changed. Otherwise @p true.
+ */
+bool journalReset(Journal *journal);
+
+/** Function closes a journal.
+ * Function synchronizes the journal with the disk and frees it.
+ * @param[in, out] journal - a pointer to the journal or NULL.
+ * @return Value @p false if any record could not be written. Otherwise @p true.
+ */
+bool journalClose(Journal *journal);
+
+/** Function reads the records of a journal.
+ * Function calls @p apply for the records in the order they were appended. Reading stops
+ * at an incomplete or damaged record, which can be left by an interrupted write.
+ * @param[in] path - the name of the file;
+ * @param[in] apply - a function applying a record;
+ * @param[in, out] data - a pointer given to @p apply.
+ * @return Value @p false if the file is not a journal, can not be read, @p apply has
+ * returned @p false or failed to allocate memory. Otherwise @p true.
+ */
+bool journalReplay(char const *path, JournalApply apply, void *data);
+
+/** Function stores the entries of the directory of a file on the disk.
+ * Function waits until the changes of names in the directory, for example made by
+ * @p rename, are stored on the disk.
+ * @param[in] path - the name of a file in the directory.
+ * @return Value @p false if the directory can not be opened or synchronized or failed
+ * to allocate memory. Otherwise @p true.
+ */
+bool journalSyncDirectory(char const *path);
+
+#endif /* __JOURNAL_H__ */
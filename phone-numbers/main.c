@@ -0,0 +1,610 @@
+/** @file
+ * A program executing commands of phone number forwarding
+ *
+ * The program reads commands from the standard input and writes their results
+ * to the standard output. Commands are separated by any white characters,
+ * and a number can be followed by an operator without them:
+ * - `NEW id` creates a structure named @p id, if it does not exist, and makes it the current one;
+ * - `DEL id` deletes the structure named @p id;
+ * - `num1 > num2` adds a forwarding to the current structure, see @ref phfwdAdd;
+ * - `DEL num` removes forwardings from the current structure, see @ref phfwdRemove;
+ * - `num ?` writes the forwarding of @p num, see @ref phfwdGet;
+ * - `? num` writes the numbers forwarded to @p num one per line, see @ref phfwdReverse.
+ *
+ * An identifier consists of letters and decimal digits and starts with a letter,
+ * it can not be `NEW` or `DEL`. After an incorrect command the program writes `ERROR n`
+ * to the standard error, where @p n is the position of the first character that does not
+ * fit, counted from 1. If the input ends in the middle of a command, it writes `ERROR EOF`.
+ * If a command can not be executed, it writes `ERROR op n`, where @p op is `NEW`, `DEL`,
+ * `>` or `?` and @p n is its position. Then the program ends with code 1.
+ *
+ * The input is read in large blocks and parsed in place, and the results are collected
+ * in a large buffer, so a command costs no call of the standard library.
+ *
+ * @author Emilia Dębicka <ed438406@students.mimuw.edu.pl>
+ * @copyright University of Warsaw
+ * @date 2022
+ */
+
+#include "phone_forward.h"
+#include "reader.h"
+#include "writer.h"
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * A macro that stores the initial size of the input buffer.
+ */
+#define INPUT_BUFFER_SIZE (1 << 20)
+
+/**
+ * A macro that stores the size of the output buffer.
+ */
+#define OUTPUT_BUFFER_SIZE (1 << 20)
+
+/**
+ * A macro that stores the inital size of the array of structures.
+ */
+#define INITIAL_TABLES_SIZE 4
+
+/**
+ * A macro that marks a white character.
+ */
+#define CLASS_SPACE 1
+
+/**
+ * A macro that marks a character of a number.
+ */
+#define CLASS_NUMBER 2
+
+/**
+ * A macro that marks a character of an identifier.
+ */
+#define CLASS_NAME 4
+
+/**
+ * A macro that marks a character starting an identifier.
+ */
+#define CLASS_LETTER 8
+
+/**
+ * A macro that describes a number.
+ */
+#define TOKEN_NUMBER 1
+
+/**
+ * A macro that describes an identifier or a keyword.
+ */
+#define TOKEN_NAME 2
+
+/**
+ * A macro that describes the operator '>'.
+ */
+#define TOKEN_FORWARD 3
+
+/**
+ * A macro that describes the operator '?'.
+ */
+#define TOKEN_QUERY 4
+
+/**
+ * A macro that describes a character that does not start any token.
+ */
+#define TOKEN_OTHER 5
+
+/**
+ * A macro that describes the end of read bytes.
+ */
+#define TOKEN_END 6
+
+/**
+ * A macro that describes the command `NEW id`.
+ */
+#define COMMAND_NEW 1
+
+/**
+ * A macro that describes the command `DEL id`.
+ */
+#define COMMAND_DELETE 2
+
+/**
+ * A macro that describes the command `num1 > num2`.
+ */
+#define COMMAND_ADD 3
+
+/**
+ * A macro that describes the command `DEL num`.
+ */
+#define COMMAND_REMOVE 4
+
+/**
+ * A macro that describes the command `num ?`.
+ */
+#define COMMAND_GET 5
+
+/**
+ * A macro that describes the command `? num`.
+ */
+#define COMMAND_REVERSE 6
+
+/**
+ * A macro that informs that a command has been parsed.
+ */
+#define PARSE_COMMAND 1
+
+/**
+ * A macro that informs that more bytes have to be read to parse a command.
+ */
+#define PARSE_MORE 2
+
+/**
+ * A macro that informs that the input has ended after the last command.
+ */
+#define PARSE_END 3
+
+/**
+ * A macro that informs that the input has ended in the middle of a command.
+ */
+#define PARSE_EOF 4
+
+/**
+ * A macro that informs that a command is incorrect.
+ */
+#define PARSE_ERROR 5
+
+/**
+ * The structure stores a token of the input.
+ */
+typedef struct Token {
+    /**@{*/
+    int type; /**< The type of the token, from @ref TOKEN_NUMBER to @ref TOKEN_END. */
+    char *begin; /**< A pointer to the first character of the token. */
+    size_t size; /**< The number of characters of the token. */
+    /**@}*/
+} Token;
+
+/**
+ * The structure stores a parsed command. Its numbers and identifiers point to the input buffer.
+ */
+typedef struct Command {
+    /**@{*/
+    int type; /**< The type of the command, from @ref COMMAND_NEW to @ref COMMAND_REVERSE. */
+    Token operator; /**< The keyword or the operator of the command. */
+    Token first; /**< The first number or the identifier of the command. */
+    Token second; /**< The number to which @p first is forwarded by @ref COMMAND_ADD. */
+    char *end; /**< A pointer after the last character of the command. */
+    /**@}*/
+} Command;
+
+/**
+ * The structure stores a named structure of phone number forwarding.
+ */
+typedef struct Table {
+    /**@{*/
+    char *name; /**< The identifier of the structure. */
+    size_t nameSize; /**< The number of characters of @p name. */
+    PhoneForward *pf; /**< The structure. */
+    /**@}*/
+} Table;
+
+/**
+ * The structure stores the state of the program.
+ */
+typedef struct Processor {
+    /**@{*/
+    Reader reader; /**< The standard input. */
+    Writer writer; /**< The standard output. */
+    Table *tables; /**< Created structures. */
+    size_t tablesCount; /**< The number of structures in @p tables. */
+    size_t tablesSize; /**< The size of @p tables array. */
+    PhoneForward *current; /**< The current structure or NULL if there is none. */
+    /**@}*/
+} Processor;
+
+/**
+ * Classes of characters, a sum of @ref CLASS_SPACE, @ref CLASS_NUMBER, @ref CLASS_NAME
+ * and @ref CLASS_LETTER.
+ */
+static uint8_t classes[256];
+
+/** Function fills the classes of characters.
+ */
+static void initClasses(void) {
+    char const *spaces = " \t\n\v\f\r";
+    for (size_t i = 0; spaces[i] != '\0'; i++) {
+        classes[(unsigned char) spaces[i]] = CLASS_SPACE;
+    }
+    for (int c = '0'; c <= '9'; c++) {
+        classes[c] = CLASS_NUMBER | CLASS_NAME;
+    }
+    classes['*'] = CLASS_NUMBER;
+    classes['#'] = CLASS_NUMBER;
+    for (int c = 'a'; c <= 'z'; c++) {
+        classes[c] = CLASS_NAME | CLASS_LETTER;
+        classes[c - 'a' + 'A'] = CLASS_NAME | CLASS_LETTER;
+    }
+}
+
+/** Function returns the class of a character.
+ * @param[in] c - a pointer to the character.
+ * @return A sum of flags of the class.
+ */
+static inline int classOf(char const *c) {
+    return classes[(unsigned char) *c];
+}
+
+/** Function reads the next token.
+ * A token that ends with the read bytes, while the input has not ended, can be longer,
+ * so it is not returned.
+ * @param[in] reader - a pointer to the reader of the input;
+ * @param[in] position - a pointer to the first character after the previous token;
+ * @param[out] token - a pointer to the token, its type is @ref TOKEN_END if no token
+ * has been read.
+ */
+static void nextToken(Reader const *reader, char *position, Token *token) {
+    char *end = reader->buffer + reader->end;
+    // The byte at the end is '\0', so it stops every loop.
+    while (classOf(position) == CLASS_SPACE) {
+        position++;
+    }
+    char *last = position;
+    if (position == end) {
+        token->type = TOKEN_END;
+    } else if (classOf(position) & CLASS_NUMBER) {
+        token->type = TOKEN_NUMBER;
+        while (classOf(last) & CLASS_NUMBER) {
+            last++;
+        }
+    } else if (classOf(position) & CLASS_LETTER) {
+        token->type = TOKEN_NAME;
+        while (classOf(last) & CLASS_NAME) {
+            last++;
+        }
+    } else {
+        token->type = *position == '>' ? TOKEN_FORWARD : *position == '?' ? TOKEN_QUERY : TOKEN_OTHER;
+        last++;
+    }
+    if (last == end && !reader->ended) {
+        token->type = TOKEN_END;
+    }
+    token->begin = position;
+    token->size = last - position;
+}
+
+/** Function checks if a token is a keyword.
+ * @param[in] token - a pointer to the token;
+ * @param[in] keyword - a pointer to the keyword.
+ * @return Value @p true if the token is the keyword. Otherwise @p false.
+ */
+static bool isKeyword(Token const *token, char const *keyword) {
+    return token->type == TOKEN_NAME && token->size == strlen(keyword)
+           && memcmp(token->begin, keyword, token->size) == 0;
+}
+
+/** Function checks if a token is an identifier.
+ * @param[in] token - a pointer to the token.
+ * @return Value @p true if the token is an identifier. Otherwise @p false.
+ */
+static bool isIdentifier(Token const *token) {
+    return token->type == TOKEN_NAME && !isKeyword(token, "NEW") && !isKeyword(token, "DEL");
+}
+
+/** Function reads the next token of a command that has been started.
+ * @param[in] reader - a pointer to the reader of the input;
+ * @param[in] previous - a pointer to the previous token of the command;
+ * @param[out] token - a pointer to the token;
+ * @param[in] expected - the expected type of the token.
+ * @return @ref PARSE_COMMAND if the token has the expected type, @ref PARSE_MORE or
+ * @ref PARSE_EOF if it has not been read, @ref PARSE_ERROR if it has another type.
+ */
+static int nextCommandToken(Reader const *reader, Token const *previous, Token *token, int expected) {
+    nextToken(reader, previous->begin + previous->size, token);
+    if (token->type == TOKEN_END) {
+        return reader->ended ? PARSE_EOF : PARSE_MORE;
+    }
+    return token->type == expected ? PARSE_COMMAND : PARSE_ERROR;
+}
+
+/** Function parses the next command.
+ * White characters preceding the command are skipped.
+ * @param[in, out] reader - a pointer to the reader of the input;
+ * @param[out] command - a pointer to the command;
+ * @param[out] error - a pointer to the first character that does not fit, it is set
+ * if @ref PARSE_ERROR is returned.
+ * @return @ref PARSE_COMMAND if a command has been parsed, @ref PARSE_MORE if more bytes
+ * have to be read, @ref PARSE_END if the input has ended, @ref PARSE_EOF if the input has ended
+ * in the middle of a command or @ref PARSE_ERROR if the command is incorrect.
+ */
+static int parseCommand(Reader *reader, Command *command, char **error) {
+    Token *operator = &command->operator;
+    nextToken(reader, reader->buffer + reader->begin, operator);
+    reader->begin = operator->begin - reader->buffer;
+    if (operator->type == TOKEN_END) {
+        return reader->ended && reader->begin == reader->end ? PARSE_END : PARSE_MORE;
+    }
+
+    int parsed = PARSE_ERROR;
+    Token *last = &command->first;
+    if (isKeyword(operator, "NEW")) {
+        command->type = COMMAND_NEW;
+        parsed = nextCommandToken(reader, operator, &command->first, TOKEN_NAME);
+        if (parsed == PARSE_COMMAND && !isIdentifier(&command->first)) {
+            parsed = PARSE_ERROR;
+        }
+    } else if (isKeyword(operator, "DEL")) {
+        parsed = nextCommandToken(reader, operator, &command->first, TOKEN_NAME);
+        command->type = COMMAND_DELETE;
+        if (parsed == PARSE_ERROR && command->first.type == TOKEN_NUMBER) {
+            parsed = PARSE_COMMAND;
+            command->type = COMMAND_REMOVE;
+        } else if (parsed == PARSE_COMMAND && !isIdentifier(&command->first)) {
+            parsed = PARSE_ERROR;
+        }
+    } else if (operator->type == TOKEN_QUERY) {
+        command->type = COMMAND_REVERSE;
+        parsed = nextCommandToken(reader, operator, &command->first, TOKEN_NUMBER);
+    } else if (operator->type == TOKEN_NUMBER) {
+        // The command starts with a number, so the operator is its second token.
+        command->first = *operator;
+        parsed = nextCommandToken(reader, &command->first, operator, TOKEN_FORWARD);
+        last = operator;
+        if (parsed == PARSE_ERROR && operator->type == TOKEN_QUERY) {
+            parsed = PARSE_COMMAND;
+            command->type = COMMAND_GET;
+        } else if (parsed == PARSE_COMMAND) {
+            command->type = COMMAND_ADD;
+            parsed = nextCommandToken(reader, operator, &command->second, TOKEN_NUMBER);
+            last = &command->second;
+        }
+    } else {
+        last = operator;
+    }
+
+    if (parsed == PARSE_ERROR) {
+        *error = last->begin;
+    }
+    command->end = last->begin + last->size;
+    return parsed;
+}
+
+/** Function appends a line to the output.
+ * @param[in, out] writer - a pointer to the writer of the output;
+ * @param[in] line - a pointer to the line without '\n';
+ * @param[in] size - the number of characters of @p line.
+ * @return Value @p false if failed to write the output. Otherwise @p true.
+ */
+static bool putLine(Writer *writer, char const *line, size_t size) {
+    size_t available;
+    char *space = writerReserve(writer, size + 1, &available);
+    if (space == NULL) {
+        return false;
+    }
+    memcpy(space, line, size);
+    space[size] = '\n';
+    writerCommit(writer, size + 1);
+    return true;
+}
+
+/** Function writes the forwarding of a number.
+ * The result is written directly to the output buffer.
+ * @param[in] pf - a pointer to the structure;
+ * @param[in] num - a pointer to the number;
+ * @param[in, out] writer - a pointer to the writer of the output.
+ * @return Value @p false if failed to write the output. Otherwise @p true.
+ */
+static bool putForwarding(PhoneForward const *pf, char const *num, Writer *writer) {
+    size_t available, length = 0;
+    char *space = writerReserve(writer, 1, &available);
+    if (space != NULL && !phfwdGetInto(pf, num, space, available, &length)) {
+        // The result did not fit, now it is known how long it is.
+        space = length > 0 ? writerReserve(writer, length + 1, &available) : NULL;
+        if (space != NULL && !phfwdGetInto(pf, num, space, available, &length)) {
+            space = NULL;
+        }
+    }
+    if (space == NULL) {
+        return false;
+    }
+    space[length] = '\n';
+    writerCommit(writer, length + 1);
+    return true;
+}
+
+/** Function writes the numbers forwarded to a number.
+ * @param[in] pf - a pointer to the structure;
+ * @param[in] num - a pointer to the number;
+ * @param[in, out] writer - a pointer to the writer of the output.
+ * @return Value @p false if failed to allocate memory or to write the output.
+ * Otherwise @p true.
+ */
+static bool putReverse(PhoneForward const *pf, char const *num, Writer *writer) {
+    PhoneNumbers *pnum = phfwdReverse(pf, num);
+    bool written = pnum != NULL;
+    char const *number;
+    for (size_t i = 0; written && (number = phnumGet(pnum, i)) != NULL; i++) {
+        written = putLine(writer, number, strlen(number));
+    }
+    phnumDelete(pnum);
+    return written;
+}
+
+/** Function returns a structure with a given name.
+ * @param[in] processor - a pointer to the state of the program;
+ * @param[in] name - a pointer to the identifier token.
+ * @return A pointer to the structure in @p tables or NULL if it does not exist.
+ */
+static Table *findTable(Processor const *processor, Token const *name) {
+    for (size_t i = 0; i < processor->tablesCount; i++) {
+        Table *table = &processor->tables[i];
+        if (table->nameSize == name->size && memcmp(table->name, name->begin, name->size) == 0) {
+            return table;
+        }
+    }
+    return NULL;
+}
+
+/** Function executes the command `NEW id`.
+ * @param[in, out] processor - a pointer to the state of the program;
+ * @param[in] name - a pointer to the identifier token.
+ * @return Value @p false if failed to allocate memory. Otherwise @p true.
+ */
+static bool newTable(Processor *processor, Token const *name) {
+    Table *table = findTable(processor, name);
+    if (table != NULL) {
+        processor->current = table->pf;
+        return true;
+    }
+
+    if (processor->tablesCount == processor->tablesSize) {
+        size_t tablesSize = processor->tablesSize == 0 ? INITIAL_TABLES_SIZE : 2 * processor->tablesSize;
+        Table *tables = realloc(processor->tables, tablesSize * sizeof(Table));
+        if (tables == NULL) {
+            return false;
+        }
+        processor->tables = tables;
+        processor->tablesSize = tablesSize;
+    }
+    table = &processor->tables[processor->tablesCount];
+    table->name = malloc(name->size);
+    table->pf = phfwdNew();
+    if (table->name == NULL || table->pf == NULL) {
+        free(table->name);
+        phfwdDelete(table->pf);
+        return false;
+    }
+    memcpy(table->name, name->begin, name->size);
+    table->nameSize = name->size;
+    processor->tablesCount++;
+    processor->current = table->pf;
+    return true;
+}
+
+/** Function executes the command `DEL id`.
+ * @param[in, out] processor - a pointer to the state of the program;
+ * @param[in] name - a pointer to the identifier token.
+ * @return Value @p false if the structure does not exist. Otherwise @p true.
+ */
+static bool deleteTable(Processor *processor, Token const *name) {
+    Table *table = findTable(processor, name);
+    if (table == NULL) {
+        return false;
+    }
+    if (processor->current == table->pf) {
+        processor->current = NULL;
+    }
+    phfwdDelete(table->pf);
+    free(table->name);
+    *table = processor->tables[--processor->tablesCount];
+    return true;
+}
+
+/** Function executes a command.
+ * Numbers of the command are followed by '\0' while they are used, and then
+ * the replaced characters are restored, so the input is parsed only once.
+ * @param[in, out] processor - a pointer to the state of the program;
+ * @param[in] command - a pointer to the command.
+ * @return Value @p false if the command can not be executed. Otherwise @p true.
+ */
+static bool runCommand(Processor *processor, Command const *command) {
+    if (command->type == COMMAND_NEW) {
+        return newTable(processor, &command->first);
+    }
+    if (command->type == COMMAND_DELETE) {
+        return deleteTable(processor, &command->first);
+    }
+
+    PhoneForward *pf = processor->current;
+    char *firstEnd = command->first.begin + command->first.size;
+    char first = *firstEnd;
+    *firstEnd = '\0';
+    bool done = pf != NULL;
+    if (done && command->type == COMMAND_ADD) {
+        char *secondEnd = command->second.begin + command->second.size;
+        char second = *secondEnd;
+        *secondEnd = '\0';
+        done = phfwdAdd(pf, command->first.begin, command->second.begin);
+        *secondEnd = second;
+    } else if (done && command->type == COMMAND_REMOVE) {
+        phfwdRemove(pf, command->first.begin);
+    } else if (done && command->type == COMMAND_GET) {
+        done = putForwarding(pf, command->first.begin, &processor->writer);
+    } else if (done) {
+        done = putReverse(pf, command->first.begin, &processor->writer);
+    }
+    *firstEnd = first;
+    return done;
+}
+
+/** Function deletes the state of the program.
+ * @param[in, out] processor - a pointer to the state of the program.
+ */
+static void destroyProcessor(Processor *processor) {
+    for (size_t i = 0; i < processor->tablesCount; i++) {
+        phfwdDelete(processor->tables[i].pf);
+        free(processor->tables[i].name);
+    }
+    free(processor->tables);
+    readerDestroy(&processor->reader);
+    writerDestroy(&processor->writer);
+}
+
+/** Function executes all commands of the input.
+ * @param[in, out] processor - a pointer to the state of the program.
+ * @return The exit code of the program.
+ */
+static int run(Processor *processor) {
+    Reader *reader = &processor->reader;
+    Command command;
+    char *error = NULL;
+    while (true) {
+        int parsed = parseCommand(reader, &command, &error);
+        if (parsed == PARSE_MORE) {
+            if (!readerFill(reader)) {
+                writerFlush(&processor->writer);
+                fprintf(stderr, "ERROR READ\n");
+                return 1;
+            }
+            continue;
+        }
+        if (parsed == PARSE_END) {
+            return writerFlush(&processor->writer) ? 0 : 1;
+        }
+
+        bool done = parsed == PARSE_COMMAND && runCommand(processor, &command);
+        if (!done) {
+            // The results of the preceding commands are written before the error.
+            writerFlush(&processor->writer);
+            if (parsed == PARSE_EOF) {
+                fprintf(stderr, "ERROR EOF\n");
+            } else if (parsed == PARSE_ERROR) {
+                fprintf(stderr, "ERROR %" PRIu64 "\n", readerPosition(reader, error));
+            } else {
+                Token const *operator = &command.operator;
+                fprintf(stderr, "ERROR %.*s %" PRIu64 "\n", (int) operator->size, operator->begin,
+                        readerPosition(reader, operator->begin));
+            }
+            return 1;
+        }
+        reader->begin = command.end - reader->buffer;
+    }
+}
+
+/** Function executes the commands of the standard input.
+ * @return The exit code of the program, 0 if all commands have been executed, 1 otherwise.
+ */
+int main(void) {
+    initClasses();
+    Processor processor = {.tables = NULL, .tablesCount = 0, .tablesSize = 0, .current = NULL};
+    bool initialized = readerInit(&processor.reader, STDIN_FILENO, INPUT_BUFFER_SIZE);
+    initialized = writerInit(&processor.writer, STDOUT_FILENO, OUTPUT_BUFFER_SIZE) && initialized;
+    int code = 1;
+    if (initialized) {
+        code = run(&processor);
+    }
+    destroyProcessor(&processor);
+    return code;
+}
@@ -0,0 +1,92 @@
+/** @file
+ * An interface for nodes of the tries of phone number forwarding
+ *
+ * @author Emilia Dębicka <ed438406@students.mimuw.edu.pl>
+ * @copyright University of Warsaw
+ * @date 2022
+ */
+
+#ifndef __NODE_H__
+#define __NODE_H__
+
+#include "pool.h"
+#include <stdint.h>
+
+/**
+ * A macro that informs how many different characters can follow a digit.
+ */
+#define NUMBER_OF_DIGITS 12
+
+/**
+ * A macro that informs how many digits can be stored in one node of the trie.
+ * Longer chains of digits are split into several nodes.
+ */
+#define LABEL_CAPACITY 16
+
+/**
+ * A macro that stores the size of the small array of children. Nodes with more
+ * children use an array indexed directly by digits.
+ */
+#define SMALL_CAPACITY 4
+
+/**
+ * A macro that marks the end of a prefix in a trie of sources of the reverse index.
+ */
+#define SOURCE_MARK 1
+
+/**
+ * A macro that describes a node of the forwarding trie.
+ */
+#define FORWARD_NODE 0
+
+/**
+ * A macro that describes a node of the reverse index.
+ */
+#define REVERSE_NODE 1
+
+/**
+ * A macro that describes a node of a trie of numbers forwarded to one number.
+ */
+#define SOURCE_NODE 2
+
+/**
+ * An index of a node in the pool of nodes.
+ */
+typedef uint32_t NodeId;
+
+/**
+ * The structure stores a node of the forwarding trie.
+ * It is a node of a path-compressed trie: a chain of digits, that has no
+ * branches and no forwardings, is stored in one node.
+ */
+typedef struct Node {
+    /**@{*/
+    /** Children of the node. If @p capacity is 1, it is the index of the only child.
+     * Otherwise it is the index of an array of @p capacity indices of children. In an array of
+     * @ref SMALL_CAPACITY elements children are sorted by digits stored in @p keys,
+     * in an array of @ref NUMBER_OF_DIGITS elements they are indexed by digits.
+     */
+    uint32_t next;
+
+    /** Forwarding from numbers with prefix @p num1 to numbers with prefix changed to @p num2. \n
+    * @p node->@p forward != @ref POOL_NONE when there is a redirection from numbers with prefix finished
+    * in @p node (@p num1 ends with the last digit of @p node->@p label). \n
+    * Then @p node->@p forward is the index of the Target storing @p num2. \n
+    * In the reverse index it is the root of the trie of all @p num1 forwarded to the number
+    * ending in @p node, and in that trie it is @ref SOURCE_MARK at the end of each @p num1.
+    */
+    uint32_t forward;
+
+    /** Digits (from 0 to 11) leading from the parent to this node, 4 bits each.
+     * The first digit is stored in the highest bits and the unused bits are 0.
+     */
+    uint64_t label;
+    uint8_t labelLength; /**< The number of digits in @p label. */
+    uint8_t capacity; /**< The size of the array of children: 0, 1, @ref SMALL_CAPACITY or @ref NUMBER_OF_DIGITS. */
+    uint8_t numberOfNextDigits; /**< The number of children. */
+    uint8_t keys[SMALL_CAPACITY]; /**< First digits of children's labels if @p capacity <= @ref SMALL_CAPACITY. */
+    uint8_t shared; /**< Nonzero if the node has been published in copying mode, so it can not be changed. */
+    /**@}*/
+} Node;
+
+#endif /* __NODE_H__ */
@@ -0,0 +1,79 @@
+/** @file
+ * The main module of functions checking and comparing phone numbers
+ *
+ * @author Emilia Dębicka <ed438406@students.mimuw.edu.pl>
+ * @copyright University of Warsaw
+ * @date 2022
+ */
+
+#include "number.h"
+#include "phone_forward.h"
+#include <stdint.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+
+/**
+ * A macro that informs how many characters are checked at once.
+ */
+#define BLOCK_SIZE 16
+
+// Blocks are aligned, so a block never crosses a page boundary and it can be read
+// past the end of the string. The sanitizer would report it, so it is disabled here.
+__attribute__((no_sanitize_address))
+size_t numberLength(char const *num) {
+    if (num == NULL) {
+        return 0;
+    }
+
+    size_t misalignment = (uintptr_t) num % BLOCK_SIZE;
+    char const *block = num - misalignment;
+    // Characters of the first block preceding the number are not checked.
+    unsigned skipped = (1u << misalignment) - 1;
+    __m128i const belowZero = _mm_set1_epi8('0' - 1);
+    __m128i const aboveNine = _mm_set1_epi8('9' + 1);
+    __m128i const star = _mm_set1_epi8('*');
+    __m128i const hash = _mm_set1_epi8('#');
+    while (true) {
+        __m128i chars = _mm_load_si128((__m128i const *) block);
+        __m128i digits = _mm_and_si128(_mm_cmpgt_epi8(chars, belowZero), _mm_cmplt_epi8(chars, aboveNine));
+        __m128i valid = _mm_or_si128(digits, _mm_or_si128(_mm_cmpeq_epi8(chars, star),
+                                                          _mm_cmpeq_epi8(chars, hash)));
+        unsigned invalid = ~(unsigned) _mm_movemask_epi8(valid) & 0xffff & ~skipped;
+        if (invalid != 0) {
+            // The first character that is not a digit has to end the number.
+            size_t end = __builtin_ctz(invalid);
+            return block[end] == '\0' ? (size_t) (block + end - num) : 0;
+        }
+        block += BLOCK_SIZE;
+        skipped = 0;
+    }
+}
+
+#else
+
+size_t numberLength(char const *num) {
+    if (num == NULL) {
+        return 0;
+    }
+    size_t i = 0;
+    while (num[i] != '\0') {
+        if (!isDigit(num[i])) {
+            return 0;
+        }
+        i++;
+    }
+    return i;
+}
+
+#endif
+
+int numberCompare(char const *a, size_t aSize, char const *b, size_t bSize) {
+    size_t size = aSize < bSize ? aSize : bSize;
+    for (size_t i = 0; i < size; i++) {
+        if (a[i] != b[i]) {
+            return compareDigits(a[i], b[i]);
+        }
+    }
+    return (aSize > bSize) - (aSize < bSize);
+}
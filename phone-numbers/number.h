@@ -0,0 +1,31 @@
+/** @file
+ * An interface for functions checking and comparing phone numbers
+ *
+ * @author Emilia Dębicka <ed438406@students.mimuw.edu.pl>
+ * @copyright University of Warsaw
+ * @date 2022
+ */
+
+#ifndef __NUMBER_H__
+#define __NUMBER_H__
+
+#include <stddef.h>
+
+/** Function checks a number and counts its digits.
+ * Function checks many characters at once if the processor allows it.
+ * @param[in] num - a pointer to the string or NULL.
+ * @return The number of digits of @p num or 0 if @p num is NULL or does not represent a number.
+ */
+size_t numberLength(char const *num);
+
+/** Function compares numbers in the order of digits.
+ * @param[in] a - a pointer to the digits of the first number;
+ * @param[in] aSize - the number of digits of @p a;
+ * @param[in] b - a pointer to the digits of the second number;
+ * @param[in] bSize - the number of digits of @p b.
+ * @return A negative integer if @p a is lexicographically smaller, positive if it is larger,
+ * 0 if the numbers are equal.
+ */
+int numberCompare(char const *a, size_t aSize, char const *b, size_t bSize);
+
+#endif /* __NUMBER_H__ */
@@ -0,0 +1,45 @@
+/** @file
+ * The main module of functions storing phone numbers with two digits in a byte
+ *
+ * @author Emilia Dębicka <ed438406@students.mimuw.edu.pl>
+ * @copyright University of Warsaw
+ * @date 2022
+ */
+
+#include "packed.h"
+#include "phone_forward.h"
+#include <string.h>
+
+void packNumber(char const *num, size_t numSize, uint8_t *packed) {
+    size_t i = 0;
+    for (; i + 1 < numSize; i += 2) {
+        *(packed++) = charToDigit(num[i]) << 4 | charToDigit(num[i + 1]);
+    }
+    if (i < numSize) {
+        *packed = charToDigit(num[i]) << 4;
+    }
+}
+
+void unpackNumber(uint8_t const *packed, size_t numSize, char *num) {
+    size_t i = 0;
+    for (; i + 1 < numSize; i += 2) {
+        *(num++) = digitToChar(*packed >> 4);
+        *(num++) = digitToChar(*(packed++) & 0xf);
+    }
+    if (i < numSize) {
+        *num = digitToChar(*packed >> 4);
+    }
+}
+
+int comparePacked(uint8_t const *a, size_t aSize, uint8_t const *b, size_t bSize) {
+    // Whole bytes of the common length are compared at once, then its last odd digit.
+    size_t size = aSize < bSize ? aSize : bSize;
+    int result = memcmp(a, b, size / 2);
+    if (result != 0) {
+        return result;
+    }
+    if (size % 2 == 1 && (a[size / 2] >> 4) != (b[size / 2] >> 4)) {
+        return (a[size / 2] >> 4) - (b[size / 2] >> 4);
+    }
+    return (aSize > bSize) - (aSize < bSize);
+}
@@ -0,0 +1,85 @@
+/** @file
+ * An interface for functions storing phone numbers with two digits in a byte
+ *
+ * @author Emilia Dębicka <ed438406@students.mimuw.edu.pl>
+ * @copyright University of Warsaw
+ * @date 2022
+ */
+
+#ifndef __PACKED_H__
+#define __PACKED_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * A macro that informs how many bytes have to be readable after a packed number
+ * to call @ref packedWindow.
+ */
+#define PACKED_PADDING 8
+
+/** Function returns the number of bytes of a packed number.
+ * @param[in] numSize - the number of digits.
+ * @return The number of bytes storing @p numSize digits.
+ */
+static inline size_t packedSize(size_t numSize) {
+    return (numSize + 1) / 2;
+}
+
+/** Function returns a digit of a packed number.
+ * @param[in] packed - a pointer to the packed number;
+ * @param[in] i - the index of the digit.
+ * @return The digit, from 0 to 11.
+ */
+static inline int packedDigit(uint8_t const *packed, size_t i) {
+    return i % 2 == 0 ? packed[i / 2] >> 4 : packed[i / 2] & 0xf;
+}
+
+/** Function returns 16 consecutive digits of a packed number.
+ * The digits are placed like in the packed number, so the digit @p i is stored in the highest
+ * 4 bits. Digits following the number are undefined.
+ * @param[in] packed - a pointer to the packed number followed by @ref PACKED_PADDING bytes;
+ * @param[in] i - the index of the first digit, smaller than the length of the number.
+ * @return The digits from @p i to @p i + 15.
+ */
+static inline uint64_t packedWindow(uint8_t const *packed, size_t i) {
+    uint64_t window;
+    memcpy(&window, packed + i / 2, sizeof(window));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    window = __builtin_bswap64(window);
+#endif
+    if (i % 2 == 1) {
+        window = window << 4 | packed[i / 2 + sizeof(window)] >> 4;
+    }
+    return window;
+}
+
+/** Function packs a number.
+ * Each digit takes 4 bits and the first digit of a byte is stored in its higher half,
+ * so packed numbers are ordered like the numbers if they are compared byte by byte.
+ * The unused half of the last byte is 0.
+ * @param[in] num - a pointer to the correct number;
+ * @param[in] numSize - the number of digits to pack;
+ * @param[out] packed - a pointer to the array of at least @ref packedSize(@p numSize) bytes.
+ */
+void packNumber(char const *num, size_t numSize, uint8_t *packed);
+
+/** Function converts a packed number to characters.
+ * @param[in] packed - a pointer to the packed number;
+ * @param[in] numSize - the number of digits to convert;
+ * @param[out] num - a pointer to the array of at least @p numSize characters, '\0' is not added.
+ */
+void unpackNumber(uint8_t const *packed, size_t numSize, char *num);
+
+/** Function compares packed numbers.
+ * @param[in] a - a pointer to the first packed number;
+ * @param[in] aSize - the number of digits of @p a;
+ * @param[in] b - a pointer to the second packed number;
+ * @param[in] bSize - the number of digits of @p b.
+ * @return A negative integer if @p a is lexicographically smaller, positive if it is larger,
+ * 0 if the numbers are equal.
+ */
+int comparePacked(uint8_t const *a, size_t aSize, uint8_t const *b, size_t bSize);
+
+#endif /* __PACKED_H__ */
@@ -6,606 +6,4269 @@
  * @date 2022
  */
 
-#include "stack.h"
+#define _POSIX_C_SOURCE 200809L
+
+#include "bulk.h"
+#include "cache.h"
+#include "journal.h"
+#include "node.h"
+#include "number.h"
+#include "packed.h"
+#include "pool.h"
+#include "reclaim.h"
+#include "store.h"
 #include "phone_forward.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 /**
- * A macro that informs how many different characters can follow a digit.
+ * A macro that stores the inital size of pnum numbers array.
  */
-#define NUMBER_OF_DIGITS 12
+#define INITIAL_NUMBERS_SIZE 4
 
 /**
- * A macro that stores the inital size of pnum numbers array.
+ * A macro that stores the inital size of pnum array of packed digits.
  */
-#define INITIAL_NUMBERS_SIZE 4
+#define INITIAL_DIGITS_SIZE 32
+
+/**
+ * A macro that stores the size of the buffer for packed digits of a number given
+ * to a function as a string. Digits of longer numbers are allocated.
+ */
+#define LOCAL_DIGITS_SIZE 64
+
+/**
+ * A macro that stores the inital size of the array of nodes used
+ * in @ref phfwdRemove.
+ */
+#define INITIAL_PATH_SIZE 16
+
+/**
+ * A macro that stores the inital size of the arrays of nodes and numbers used
+ * in @ref addSources.
+ */
+#define INITIAL_SOURCES_SIZE 16
+
+/**
+ * A macro that informs how many digits of a forwarding are stored in one chunk.
+ */
+#define CHUNK_CAPACITY 24
+
+/**
+ * A macro that informs how many walks are interleaved by @ref phfwdGetBatch.
+ */
+#define BATCH_STREAMS 16
+
+/**
+ * A macro that informs how many nodes of the path of a number are remembered
+ * by @ref phfwdGetBatch to be shared with the next number.
+ */
+#define BATCH_PATH_CAPACITY 32
+
+/**
+ * A macro that informs how many numbers ahead @ref phfwdGetBatch prefetches forwardings
+ * while writing the results.
+ */
+#define BATCH_PREFETCH_DISTANCE 8
+
+/**
+ * A macro that stores the inital number of buckets of the hash table of forwardings.
+ */
+#define INITIAL_TARGET_BUCKETS 64
+
+/**
+ * A macro that stores the inital size of the array of nodes created by a write
+ * in copying mode.
+ */
+#define INITIAL_FRESH_SIZE 64
+
+/**
+ * A macro that stores the number of levels of a trie walked without allocating memory.
+ */
+#define WALK_LOCAL_DEPTH 32
+
+/**
+ * A macro that stores the number of digits of a path walked without allocating memory.
+ */
+#define WALK_LOCAL_PATH 128
+
+/**
+ * A macro that stores the number of nodes of removed subtrees freed by a write.
+ */
+#define REMOVED_NODES_PER_WRITE 64
+
+/**
+ * A macro that stores the kind of cached results of @ref phfwdGet.
+ */
+#define RESULT_FORWARD 0
+
+/**
+ * A macro that stores the kind of cached results of @ref phfwdResolve for forwarded prefixes.
+ */
+#define RESULT_RESOLVE 1
+
+/**
+ * A macro that stores the kind of cached results of @ref phfwdResolve for whole numbers.
+ */
+#define RESULT_RESOLVE_NUMBER 2
+
+/**
+ * A macro that stores the number of forwardings of a cached chain that comes back to its number.
+ */
+#define CHAIN_CYCLE UINT32_MAX
+
+/**
+ * A macro that stores the number of forwardings of a cached chain of a prefix, which can not be
+ * shared by numbers starting with the prefix, as they are forwarded depending on their next digits.
+ */
+#define CHAIN_OPEN (UINT32_MAX - 1)
+
+/**
+ * A macro that stores the number of characters of a number of a chain kept without allocating memory.
+ */
+#define CHAIN_LOCAL_SIZE 64
+
+/**
+ * The structure stores a part of a forwarding.
+ */
+typedef struct Chunk {
+    /**@{*/
+    uint32_t next; /**< The index of the next chunk or @ref POOL_NONE. */
+    uint8_t digits[CHUNK_CAPACITY / 2]; /**< Digits of the forwarding packed by @ref packNumber. */
+    /**@}*/
+} Chunk;
 
 /**
- * A macro that informs what is the initial index value of index of the element
- * of PhoneForward structure.
+ * The structure stores a forwarding @p num2. Each @p num2 is stored once and shared
+ * by all prefixes forwarded to it.
  */
-#define INITIAL_PF_INDEX -1
+typedef struct Target {
+    /**@{*/
+    uint32_t chunks; /**< The index of the first chunk of the number. */
+    uint32_t length; /**< The number of digits of the number. */
+    uint32_t references; /**< The number of prefixes forwarded to the number. */
+    uint32_t hash; /**< The hash of the number. */
+    uint32_t hashNext; /**< The next target in the same bucket of the hash table or @ref POOL_NONE. */
+    /**@}*/
+} Target;
+
+/**
+ * The structure stores the size of the trie of forwarded prefixes, which is changed
+ * by writes, so it is known without walking the trie.
+ */
+typedef struct TrieSize {
+    /**@{*/
+    size_t nodes; /**< The number of nodes. */
+    size_t rules; /**< The number of nodes with a forwarding. */
+    size_t bytes; /**< Bytes of the nodes and of their arrays of children. */
+    /**@}*/
+} TrieSize;
 
 /**
  * The structure stores phone number forwarding.
+ * All nodes of the trie, arrays of their children and forwardings are allocated
+ * in pools owned by this structure. Equal forwardings are stored once and found
+ * by a hash table. \n
+ * In copying mode, that is in concurrent mode or when the structure has snapshots, writers never
+ * change a published node. They copy the nodes on the changed paths and publish both new roots
+ * at once in @p published, so readers and snapshots see an unchanged version. Removed elements
+ * are freed by @p reclaimer when no reader or snapshot uses them. In concurrent mode writers
+ * are serialized by @p lock and readers do not lock anything. \n
+ * A snapshot is a structure that only stores the roots of a version of its @p origin
+ * and reads the nodes of @p origin.
  */
 struct PhoneForward {
     /**@{*/
-    PhoneForward *nextDigitsArray[NUMBER_OF_DIGITS]; /**< An array of the next possible digits. */
-    PhoneForward *prevDigit; /**< A pointer to the previous digit. */
+    Pool nodes; /**< A pool of nodes. */
+    Pool smallArrays; /**< A pool of arrays of @ref SMALL_CAPACITY children. */
+    Pool digitArrays; /**< A pool of arrays of @ref NUMBER_OF_DIGITS children. */
+    Pool chunks; /**< A pool of chunks of forwardings. */
+    Pool targets; /**< A pool of forwardings. */
+    uint32_t *targetBuckets; /**< A hash table of forwardings, a bucket is a list linked by @p hashNext. */
+    size_t targetBucketsSize; /**< The number of buckets in @p targetBuckets. */
+    size_t targetsCount; /**< The number of forwardings in @p targetBuckets. */
+    NodeId root; /**< The root of the trie. In concurrent mode it is seen only by writers. */
+    NodeId reverseRoot; /**< The root of the reverse index, a trie of all @p num2. */
+    bool concurrent; /**< A boolean informing if the structure is in concurrent mode. */
+    bool copying; /**< A boolean informing if the structure is in copying mode. */
+    pthread_mutex_t lock; /**< A mutex taken by writers in concurrent mode. */
+    _Atomic uint64_t published; /**< Published @p root in lower and @p reverseRoot in upper 32 bits. */
+    Reclaimer reclaimer; /**< Elements removed in copying mode that may be still used. */
+    NodeId *fresh; /**< Nodes created by the current write in copying mode. */
+    size_t freshCount; /**< The number of nodes in @p fresh. */
+    size_t freshSize; /**< The size of @p fresh array. */
+    size_t references; /**< The number of snapshots, increased by 1 until the structure is deleted. */
+    PhoneForward *origin; /**< The structure of a snapshot or NULL if it is not a snapshot. */
+    uint64_t snapshotVersion; /**< The version of @p origin held by a snapshot. */
+    char *mapped; /**< The file read by @ref phfwdLoad storing the pools or NULL if they own their memory. */
+    size_t mappedSize; /**< The size of @p mapped in bytes. */
+    Journal *journal; /**< The journal of changes or NULL if changes are not written. */
+    struct RemovedSubtree *removed; /**< Removed subtrees waiting to be freed, the first one is being freed. */
+    struct RemovedSubtree *removedLast; /**< The last subtree of @p removed or NULL. */
+    _Atomic uint64_t staleSequence; /**< Odd while the published reverse index can store forwardings of
+                                         @p removed. In a snapshot its value when the snapshot was taken. */
+    ResultCache *cache; /**< The cache of results of @ref phfwdGet or NULL if it is disabled. */
+    PhoneForwardCacheStats cacheStats; /**< Counters of the earlier caches of the structure. */
+    TrieSize trieSize; /**< The size of the trie with @p removed subtrees, in a snapshot of its version. */
+    size_t usedNodes; /**< Increased by allocating and decreased by releasing a node of any trie. */
+    size_t usedBytes; /**< Changed by bytes of allocated and released nodes and arrays of children. */
+    /**@}*/
+};
+
+/**
+ * The structure stores a copy of a structure made by @ref phfwdSave.
+ */
+typedef struct Compaction {
+    /**@{*/
+    PhoneForward const *pf; /**< The structure owning the copied nodes. */
+    PhoneForward *copy; /**< The copy. */
+    uint8_t *kinds; /**< Kinds of the copied nodes, from @ref FORWARD_NODE to @ref SOURCE_NODE. */
+    size_t kindsSize; /**< The size of @p kinds array. */
+    uint32_t *targets; /**< Indices of the copied forwardings or @ref POOL_NONE if not copied yet. */
+    size_t targetsSize; /**< The size of @p targets array. */
+    /**@}*/
+} Compaction;
+
+/**
+ * The structure stores a node waiting to be visited by @ref phfwdStats.
+ */
+typedef struct StatsFrame {
+    /**@{*/
+    NodeId id; /**< The index of the node. */
+    size_t depth; /**< The number of nodes on the path from the root to the node's parent. */
+    size_t chain; /**< The number of consecutive nodes with one child ending with the node's parent. */
+    /**@}*/
+} StatsFrame;
+
+/**
+ * The structure stores a node on the path of a walk.
+ */
+typedef struct WalkFrame {
+    /**@{*/
+    NodeId id; /**< The index of the node. */
+    size_t depth; /**< The number of digits on the path to the node, without its label. */
+    int position; /**< The position of the next child for @ref nextChild, -1 if the node has not been entered. */
+    /**@}*/
+} WalkFrame;
+
+/**
+ * The structure stores the state of a depth-first walk of a trie. It stores only the path
+ * from the root of the walk to the current node, so short paths fit in its local arrays
+ * and a step allocates memory only when the path is longer than any before.
+ */
+typedef struct TrieWalk {
+    /**@{*/
+    PhoneForward const *pf; /**< The structure owning the nodes. */
+    WalkFrame *frames; /**< The path, @p localFrames or an allocated array. */
+    size_t framesCount; /**< The number of nodes on the path. */
+    size_t framesSize; /**< The size of @p frames array. */
+    char *digits; /**< Digits of the path and '\0', @p localDigits or an allocated array, NULL if not stored. */
+    size_t digitsSize; /**< The size of @p digits array. */
+    size_t length; /**< The number of digits on the path to the end of the label of the last returned node. */
+    bool postorder; /**< A boolean informing if nodes are returned after their children. */
+    bool failed; /**< A boolean informing if the walk has stopped, because it failed to allocate memory. */
+    WalkFrame localFrames[WALK_LOCAL_DEPTH]; /**< Frames of short paths. */
+    char localDigits[WALK_LOCAL_PATH]; /**< Digits of short paths. */
+    /**@}*/
+} TrieWalk;
 
-    /** An integer describing how many cells in @p nextDigitsArray are occupied. */
-    int numberOfNextDigits;
+/**
+ * The structure stores a subtree removed from the trie, whose nodes are freed by later writes.
+ * Until then its forwardings stay in the reverse index.
+ */
+typedef struct RemovedSubtree {
+    /**@{*/
+    struct RemovedSubtree *next; /**< The next removed subtree or NULL. */
+    TrieWalk walk; /**< The walk freeing the nodes after their children, it starts with digits before the subtree. */
+    /**@}*/
+} RemovedSubtree;
 
-    /** A value of the digit (a node of PhoneForward). */
-    int index;
+/**
+ * The structure stores the roots of a version of PhoneForward seen by a reader.
+ */
+typedef struct Version {
+    /**@{*/
+    PhoneForward const *owner; /**< The structure owning the nodes of the version. */
+    NodeId root; /**< The root of the trie. */
+    NodeId reverseRoot; /**< The root of the reverse index. */
+    size_t slot; /**< The slot of the reader in concurrent mode, @ref RECLAIM_READERS if none is taken. */
+    bool stale; /**< A boolean informing if the reverse index can store forwardings of removed subtrees. */
+    /**@}*/
+} Version;
 
-    /** Forwarding from numbers with prefix @p num1 to numbers with prefix changed to @p num2. \n
-    * @p digit->@p forward != NULL when there is a redirection from numbers with prefix finished in @p digit
-    * (@p num1[@p digit] is the last character of @p num1). \n
-    * Then @p digit->@p forward = @p num2.
-    */
-    char *forward;
+/**
+ * This is a structure of an iterator over the forwardings of a version of a structure.
+ */
+struct PhoneForwardIterator {
+    /**@{*/
+    Version version; /**< The read version. */
+    NodeId start; /**< The first node of the iterated subtree or @ref POOL_NONE if it is empty. */
+    size_t startDepth; /**< The number of digits on the path to @p start, without its label. */
+    TrieWalk walk; /**< The walk of the subtree. */
+    char *forward; /**< The last returned @p num2, @p localForward or an allocated array. */
+    size_t forwardSize; /**< The size of @p forward array. */
+    char localForward[WALK_LOCAL_PATH]; /**< The last returned @p num2 if it is short. */
     /**@}*/
 };
 
 /**
- * The structure stores a sequence of phone numbers.
+ * The structure stores a node on the path of a number resolved by @ref phfwdGetBatch.
+ */
+typedef struct BatchStep {
+    /**@{*/
+    NodeId node; /**< The node whose label has been matched. */
+    NodeId forwarded; /**< The deepest node with a forwarding up to @p node or @ref POOL_NONE. */
+    size_t depth; /**< The number of digits up to the end of the label of @p node. */
+    size_t prefixSize; /**< The length of the prefix ending in @p forwarded. */
+    /**@}*/
+} BatchStep;
+
+/**
+ * The structure stores the state of one of the walks interleaved by @ref phfwdGetBatch.
+ * Each stream resolves a contiguous part of the batch, one number after another,
+ * and keeps the path of the previous number to start the next one from their common prefix.
+ */
+typedef struct BatchStream {
+    /**@{*/
+    size_t current; /**< The index of the resolved number. */
+    size_t end; /**< The index after the last number of the part of this stream. */
+    char const *previous; /**< The previous correct number resolved by this stream or NULL. */
+    size_t numSize; /**< The number of digits of the resolved number. */
+    size_t i; /**< The number of digits matched so far. */
+    NodeId node; /**< The last matched node. */
+    NodeId child; /**< The prefetched node to be matched in the next step or @ref POOL_NONE. */
+    NodeId forwarded; /**< The deepest matched node with a forwarding or @ref POOL_NONE. */
+    size_t prefixSize; /**< The length of the prefix ending in @p forwarded. */
+    size_t pathSize; /**< The number of nodes on @p path. */
+    BatchStep path[BATCH_PATH_CAPACITY]; /**< The first matched nodes of the current number. */
+    /**@}*/
+} BatchStream;
+
+/**
+ * The structure stores the result of a walk of @ref phfwdGetBatch.
+ */
+typedef struct BatchResult {
+    /**@{*/
+    NodeId forwarded; /**< The node ending the longest forwarded prefix or @ref POOL_NONE. */
+    size_t prefixSize; /**< The length of the longest forwarded prefix. */
+    char const *num; /**< The number. */
+    size_t numSize; /**< The number of digits of the number, 0 if it is incorrect. */
+    /**@}*/
+} BatchResult;
+
+/**
+ * The structure stores a chain of forwardings followed by @ref phfwdResolve. A cycle is
+ * found with Brent's algorithm: the number is saved after 1, 2, 4, 8... forwardings
+ * and the following numbers are compared with it.
+ */
+typedef struct Chain {
+    /**@{*/
+    char *num; /**< The current number ended with '\0'. */
+    size_t numSize; /**< The size of @p num array. */
+    size_t length; /**< The number of digits of @p num. */
+    char *next; /**< The forwarding of @p num ended with '\0'. */
+    size_t nextSize; /**< The size of @p next array. */
+    char *saved; /**< The saved number ended with '\0'. */
+    size_t savedSize; /**< The size of @p saved array. */
+    size_t savedLength; /**< The number of digits of @p saved. */
+    size_t hops; /**< The number of forwardings from the first number to @p num. */
+    size_t sinceSaved; /**< The number of forwardings from @p saved to @p num. */
+    size_t power; /**< The number of forwardings after which @p num is saved again. */
+    bool cycle; /**< A boolean informing if @p num is equal to @p saved. */
+    bool prefix; /**< A boolean informing if the first number is a forwarded prefix of longer numbers. */
+    bool open; /**< A boolean informing if a later number of a chain of a prefix could be forwarded
+                    differently with digits added after it, then @p num may be wrong for longer numbers. */
+    NodeId path[CACHE_PATH_SIZE]; /**< Nodes passed by @ref findPrefixPath for numbers of the chain. */
+    size_t pathSize; /**< The number of nodes of @p path, larger than @ref CACHE_PATH_SIZE if they
+                          do not fit. */
+    char localNum[CHAIN_LOCAL_SIZE]; /**< The initial memory of @p num. */
+    char localNext[CHAIN_LOCAL_SIZE]; /**< The initial memory of @p next. */
+    char localSaved[CHAIN_LOCAL_SIZE]; /**< The initial memory of @p saved. */
+    /**@}*/
+} Chain;
+
+/**
+ * The structure stores a number waiting to be added by @ref addSources. The number consists
+ * of the digits on the path to a visited node followed by the suffix from a given position.
+ */
+typedef struct PendingSource {
+    /**@{*/
+    size_t offset; /**< The position in the suffix of the first digit following the path. */
+    size_t key; /**< The place of the number among the children of the node, see @ref pendingKey. */
+    /**@}*/
+} PendingSource;
+
+/**
+ * The structure stores a node on the path visited by @ref addSources.
+ */
+typedef struct SourceFrame {
+    /**@{*/
+    Node const *node; /**< The visited node. */
+    size_t depth; /**< The number of digits on the path to the node, including its label. */
+    int position; /**< The position of the next child of the node for @ref nextChild. */
+    size_t first; /**< The index of the first pending number of the node. */
+    size_t next; /**< The index of the first pending number of the node that has not been added. */
+    size_t end; /**< The index following the last pending number of the node. */
+    /**@}*/
+} SourceFrame;
+
+/**
+ * The structure stores the state of @ref addSources.
+ */
+typedef struct SourceWalk {
+    /**@{*/
+    PhoneForward const *pf; /**< The structure owning the nodes. */
+    NodeId forwardRoot; /**< The root of the read version of the forwarding trie. */
+    char const *suffix; /**< The digits of the number following the forwarding. */
+    size_t suffixSize; /**< The number of digits of @p suffix. */
+    bool onlyPreimages; /**< A boolean informing if only preimages of the number are added. */
+    char const *target; /**< The number to which the sources are forwarded if they have to be checked, or NULL. */
+    size_t targetSize; /**< The number of digits of @p target. */
+    char *path; /**< The digits on the path to the visited node. */
+    size_t pathSize; /**< The size of @p path array. */
+    uint8_t *packed; /**< The buffer for a number to be packed, at least half as big as @p path
+                          and followed by @ref PACKED_PADDING bytes. */
+    SourceFrame *frames; /**< The nodes on the path, the visited one is the last. */
+    size_t framesCount; /**< The number of nodes in @p frames. */
+    size_t framesSize; /**< The size of @p frames array. */
+    PendingSource *pending; /**< The pending numbers of the nodes in @p frames, one part after another. */
+    size_t pendingCount; /**< The number of numbers in @p pending. */
+    size_t pendingSize; /**< The size of @p pending array. */
+    /**@}*/
+} SourceWalk;
+
+/**
+ * The structure stores a sorted part of the numbers added to a PhoneNumbers structure.
+ */
+typedef struct NumbersRun {
+    /**@{*/
+    size_t next; /**< The index of the first number of the part that has not been merged. */
+    size_t end; /**< The index following the last number of the part. */
+    /**@}*/
+} NumbersRun;
+
+/**
+ * The structure stores the position of a phone number in a sequence.
+ */
+typedef struct NumberEntry {
+    /**@{*/
+    size_t offset; /**< The position of the number in @p digits of the sequence, or in @p strings
+                        after the numbers have been converted by @ref phnumGet. */
+    size_t length; /**< The number of digits, 0 describes an incorrect number. */
+    /**@}*/
+} NumberEntry;
+
+/**
+ * The structure stores a sequence of phone numbers. The numbers are packed by @ref packNumber
+ * one after another in one array, so the whole sequence takes a constant number of allocations.
  */
 struct PhoneNumbers {
     /**@{*/
-    char **numbers; /**< An array of phone numbers. */
+    NumberEntry *numbers; /**< An array of positions of phone numbers, NULL if failed to allocate memory. */
     size_t numbersSize; /**< The size of @p numbers array. */
     size_t numbersCount; /**< The number of numbers stored in @p numbers array. */
+    uint8_t *digits; /**< The packed digits of the numbers. */
+    size_t digitsSize; /**< The size of @p digits array. */
+    size_t digitsCount; /**< The number of bytes used in @p digits array. */
+    char *strings; /**< The numbers as characters, each followed by '\0', NULL until
+                        @ref phnumGet is called. */
+    /**@}*/
+};
+
+/**
+ * The structure stores a checked phone number.
+ */
+struct PhoneNumberView {
+    /**@{*/
+    char const *num; /**< The characters of the number. */
+    size_t length; /**< The number of digits, 0 if the number is incorrect. */
+    uint8_t *digits; /**< The digits packed by @ref packNumber, followed by @ref PACKED_PADDING bytes. */
+    /**@}*/
 };
 
 /** Function creates a new PhoneNumbers structure.
  * Function creates a new PhoneNumbers structure with no numbers and sets the initial field values.
- * The initial size of @p numbers array is 4.
+ * @param[in] numbersSize - the initial size of @p numbers array, at least 1;
+ * @param[in] digitsSize - the initial size of @p digits array, it can be 0.
  * @return A pointer to the created structure or NULL if failed to allocate memory.
  */
-static PhoneNumbers *pnumNew(void) {
-    PhoneNumbers *pnum = NULL;
-    pnum = (PhoneNumbers *) malloc(sizeof(PhoneNumbers));
-
-    if (pnum != NULL) {
-        pnum->numbersCount = 0;
-        pnum->numbersSize = INITIAL_NUMBERS_SIZE;
-        pnum->numbers = malloc(pnum->numbersSize * sizeof(char *));
+static PhoneNumbers *pnumNew(size_t numbersSize, size_t digitsSize) {
+    PhoneNumbers *pnum = malloc(sizeof(PhoneNumbers));
+    if (pnum == NULL) {
+        return NULL;
     }
 
+    pnum->numbers = malloc(numbersSize * sizeof(NumberEntry));
+    pnum->numbersSize = numbersSize;
+    pnum->numbersCount = 0;
+    pnum->digits = digitsSize == 0 ? NULL : malloc(digitsSize);
+    pnum->digitsSize = pnum->digits == NULL ? 0 : digitsSize;
+    pnum->digitsCount = 0;
+    pnum->strings = NULL;
+    if (pnum->numbers == NULL) {
+        free(pnum->digits);
+        free(pnum);
+        return NULL;
+    }
     return pnum;
 }
 
-PhoneForward *phfwdNew(void) {
+/** Function checks a number and packs its digits.
+ * @param[out] view - a pointer to the initialized view;
+ * @param[in] num - a pointer to the string or NULL;
+ * @param[in] local - a pointer to the buffer used for the digits if they fit in it;
+ * @param[in] localSize - the size of @p local buffer.
+ * @return Value @p false if failed to allocate memory. Otherwise @p true, also if @p num
+ * does not represent a number, then the length of the view is 0.
+ */
+static bool initView(PhoneNumberView *view, char const *num, uint8_t *local, size_t localSize) {
+    view->num = num;
+    view->length = numberLength(num);
+    size_t size = packedSize(view->length);
+    view->digits = size + PACKED_PADDING <= localSize ? local : malloc(size + PACKED_PADDING);
+    if (view->digits == NULL) {
+        return false;
+    }
+    packNumber(num, view->length, view->digits);
+    memset(view->digits + size, 0, PACKED_PADDING);
+    return true;
+}
+
+/** Function frees the memory of a view initialized by @ref initView.
+ * @param[in, out] view - a pointer to the view;
+ * @param[in] local - a pointer to the buffer given to @ref initView.
+ */
+static void freeView(PhoneNumberView *view, uint8_t const *local) {
+    if (view->digits != local) {
+        free(view->digits);
+    }
+}
+
+/** Function returns a node.
+ * @param[in] pf - a pointer to the structure owning the node;
+ * @param[in] id - the index of the node.
+ * @return A pointer to the node.
+ */
+static inline Node *nodeAt(PhoneForward const *pf, NodeId id) {
+    return poolGet(&pf->nodes, id);
+}
+
+/** Function returns a forwarding.
+ * @param[in] pf - a pointer to the structure owning the forwarding;
+ * @param[in] forward - the index of the forwarding.
+ * @return A pointer to the forwarding.
+ */
+static inline Target *targetAt(PhoneForward const *pf, uint32_t forward) {
+    return poolGet(&pf->targets, forward);
+}
+
+/** Function returns the memory of a node.
+ * @param[in] node - a pointer to the node.
+ * @return Bytes of the node and of its array of children.
+ */
+static inline size_t nodeBytes(Node const *node) {
+    return sizeof(Node) + (node->capacity > 1 ? node->capacity * sizeof(NodeId) : 0);
+}
+
+/** Function returns a digit of the label of a node.
+ * @param[in] node - a pointer to the node;
+ * @param[in] i - the index of the digit, less than @ref LABEL_CAPACITY.
+ * @return The digit, from 0 to 11.
+ */
+static inline int labelDigit(Node const *node, size_t i) {
+    return (node->label >> (60 - 4 * i)) & 0xf;
+}
+
+/** Function returns the bits of a label storing its first digits.
+ * @param[in] size - the number of digits, at most @ref LABEL_CAPACITY.
+ * @return A mask of the bits of the first @p size digits.
+ */
+static inline uint64_t labelMask(size_t size) {
+    return size == 0 ? 0 : ~UINT64_C(0) << (64 - 4 * size);
+}
+
+/** Function makes an array of characters fit a given number of characters.
+ * An array stored in a structure is replaced by an allocated one when it is too small,
+ * so a structure allocates memory only for long numbers.
+ * @param[in, out] array - a pointer to the array;
+ * @param[in, out] size - a pointer to the size of the array;
+ * @param[in] local - a pointer to the array stored in the structure;
+ * @param[in] used - the number of characters to be kept;
+ * @param[in] needed - the number of characters.
+ * @return Value @p false if failed to allocate memory. Otherwise @p true.
+ */
+static bool reserveChars(char **array, size_t *size, char const *local, size_t used, size_t needed) {
+    if (needed <= *size) {
+        return true;
+    }
+    size_t newSize = 2 * *size > needed ? 2 * *size : needed;
+    char *newArray = *array == local ? malloc(newSize * sizeof(char)) : realloc(*array, newSize * sizeof(char));
+    if (newArray == NULL) {
+        return false;
+    }
+    if (*array == local) {
+        memcpy(newArray, local, used);
+    }
+    *array = newArray;
+    *size = newSize;
+    return true;
+}
+
+/** Function starts a walk of a subtree.
+ * The walk returns nodes in the order of digits of their paths and it does not allocate
+ * memory until the path is longer than @ref WALK_LOCAL_DEPTH nodes or @ref WALK_LOCAL_PATH digits.
+ * @param[out] walk - a pointer to the walk;
+ * @param[in] pf - a pointer to the structure owning the subtree;
+ * @param[in] id - the index of the root of the subtree or @ref POOL_NONE if it is empty;
+ * @param[in] prefix - a pointer to the digits leading to the subtree or NULL if the digits
+ * of paths are not needed;
+ * @param[in] depth - the number of digits in @p prefix;
+ * @param[in] postorder - a boolean informing if nodes are returned after their children.
+ */
+static void walkInit(TrieWalk *walk, PhoneForward const *pf, NodeId id, char const *prefix, size_t depth,
+                     bool postorder) {
+    walk->pf = pf;
+    walk->frames = walk->localFrames;
+    walk->framesCount = 0;
+    walk->framesSize = WALK_LOCAL_DEPTH;
+    walk->digits = NULL;
+    walk->digitsSize = 0;
+    walk->length = 0;
+    walk->postorder = postorder;
+    walk->failed = false;
+    if (prefix != NULL) {
+        walk->digits = walk->localDigits;
+        walk->digitsSize = WALK_LOCAL_PATH;
+        if (!reserveChars(&walk->digits, &walk->digitsSize, walk->localDigits, 0, depth + 1)) {
+            walk->failed = true;
+            return;
+        }
+        memcpy(walk->digits, prefix, depth);
+        walk->digits[depth] = '\0';
+        walk->length = depth;
+    }
+    if (id != POOL_NONE) {
+        walk->frames[0] = (WalkFrame) {id, depth, -1};
+        walk->framesCount = 1;
+    }
+}
+
+/** Function frees the memory allocated by a walk.
+ * @param[in, out] walk - a pointer to the walk.
+ */
+static void walkDestroy(TrieWalk *walk) {
+    if (walk->frames != walk->localFrames) {
+        free(walk->frames);
+    }
+    if (walk->digits != walk->localDigits) {
+        free(walk->digits);
+    }
+}
+
+/** Function creates a new node.
+ * Function allocates a node with an empty label, no children and no forwarding.
+ * @param[in, out] pf - a pointer to the structure owning the node.
+ * @return The index of the node or @ref POOL_NONE if failed to allocate memory.
+ */
+static NodeId newTrieNode(PhoneForward *pf) {
+    NodeId id = poolAlloc(&pf->nodes);
+    if (id != POOL_NONE && pf->copying) {
+        // The node has to be marked as shared when the write is published.
+        if (pf->freshCount == pf->freshSize) {
+            size_t freshSize = pf->freshSize == 0 ? INITIAL_FRESH_SIZE : 2 * pf->freshSize;
+            NodeId *fresh = realloc(pf->fresh, freshSize * sizeof(NodeId));
+            if (fresh == NULL) {
+                poolFree(&pf->nodes, id);
+                return POOL_NONE;
+            }
+            pf->fresh = fresh;
+            pf->freshSize = freshSize;
+        }
+        pf->fresh[pf->freshCount++] = id;
+    }
+    if (id != POOL_NONE) {
+        pf->usedNodes++;
+        pf->usedBytes += sizeof(Node);
+        Node *node = nodeAt(pf, id);
+        node->next = POOL_NONE;
+        node->forward = POOL_NONE;
+        node->label = 0;
+        node->labelLength = 0;
+        node->capacity = 0;
+        node->numberOfNextDigits = 0;
+        node->shared = 0;
+    }
+    return id;
+}
+
+/** Function publishes the changes made by a write.
+ * In copying mode function marks the nodes created by the write as shared, publishes
+ * the new roots and frees the elements that are no longer used by any reader or snapshot.
+ * @param[in, out] pf - a pointer to the PhoneForward structure.
+ */
+static void publish(PhoneForward *pf) {
+    if (pf->copying) {
+        for (size_t i = 0; i < pf->freshCount; i++) {
+            nodeAt(pf, pf->fresh[i])->shared = 1;
+        }
+        pf->freshCount = 0;
+        atomic_store(&pf->published, (uint64_t) pf->reverseRoot << 32 | pf->root);
+        reclaimAdvance(&pf->reclaimer);
+    }
+}
+
+/** Function frees a structure.
+ * @param[in, out] pf - a pointer to the PhoneForward structure, which is not a snapshot.
+ */
+static void destroyPhoneForward(PhoneForward *pf) {
+    poolDestroy(&pf->nodes);
+    poolDestroy(&pf->smallArrays);
+    poolDestroy(&pf->digitArrays);
+    poolDestroy(&pf->chunks);
+    poolDestroy(&pf->targets);
+    if (pf->mapped != NULL) {
+        storeUnmap(pf->mapped, pf->mappedSize);
+    }
+    journalClose(pf->journal);
+    while (pf->removed != NULL) {
+        RemovedSubtree *next = pf->removed->next;
+        walkDestroy(&pf->removed->walk);
+        free(pf->removed);
+        pf->removed = next;
+    }
+    if (pf->cache != NULL) {
+        cacheDestroy(pf->cache);
+        free(pf->cache);
+    }
+    free(pf->targetBuckets);
+    pthread_mutex_destroy(&pf->lock);
+    reclaimDestroy(&pf->reclaimer);
+    free(pf->fresh);
+    free(pf);
+}
+
+/** Function creates a new structure without nodes.
+ * @param[in] concurrent - a boolean informing if the structure is in concurrent mode.
+ * @return A pointer to the created structure with empty pools and no roots
+ * or NULL if failed to allocate memory.
+ */
+static PhoneForward *allocPhoneForward(bool concurrent) {
     PhoneForward *pf = NULL;
     pf = (PhoneForward *) malloc(sizeof(PhoneForward));
 
     if (pf) {
-        pf->forward = NULL;
-        pf->index = INITIAL_PF_INDEX;
-        pf->numberOfNextDigits = 0;
-        pf->prevDigit = NULL;
-        for (int i = 0; i < NUMBER_OF_DIGITS; i++) {
-            pf->nextDigitsArray[i] = NULL;
+        poolInit(&pf->nodes, sizeof(Node));
+        poolInit(&pf->smallArrays, SMALL_CAPACITY * sizeof(NodeId));
+        poolInit(&pf->digitArrays, NUMBER_OF_DIGITS * sizeof(NodeId));
+        poolInit(&pf->chunks, sizeof(Chunk));
+        poolInit(&pf->targets, sizeof(Target));
+        pf->targetBuckets = NULL;
+        pf->targetBucketsSize = 0;
+        pf->targetsCount = 0;
+        pf->concurrent = concurrent;
+        pf->copying = concurrent;
+        pf->references = 1;
+        pf->origin = NULL;
+        pf->snapshotVersion = 0;
+        pthread_mutex_init(&pf->lock, NULL);
+        reclaimInit(&pf->reclaimer);
+        pf->fresh = NULL;
+        pf->freshCount = 0;
+        pf->freshSize = 0;
+        pf->mapped = NULL;
+        pf->mappedSize = 0;
+        pf->journal = NULL;
+        pf->removed = NULL;
+        pf->removedLast = NULL;
+        atomic_init(&pf->staleSequence, 0);
+        pf->cache = NULL;
+        memset(&pf->cacheStats, 0, sizeof(PhoneForwardCacheStats));
+        memset(&pf->trieSize, 0, sizeof(TrieSize));
+        pf->usedNodes = 0;
+        pf->usedBytes = 0;
+        pf->root = POOL_NONE;
+        pf->reverseRoot = POOL_NONE;
+    }
+
+    return pf;
+}
+
+/** Function creates a new structure.
+ * @param[in] concurrent - a boolean informing if the structure is in concurrent mode.
+ * @return A pointer to the created structure or NULL if failed to allocate memory.
+ */
+static PhoneForward *newPhoneForward(bool concurrent) {
+    PhoneForward *pf = allocPhoneForward(concurrent);
+
+    if (pf) {
+        pf->root = newTrieNode(pf);
+        pf->reverseRoot = newTrieNode(pf);
+        if (pf->root == POOL_NONE || pf->reverseRoot == POOL_NONE) {
+            destroyPhoneForward(pf);
+            return NULL;
         }
+        pf->trieSize.nodes = 1;
+        pf->trieSize.bytes = sizeof(Node);
+        publish(pf);
+    }
+
+    return pf;
+}
+
+PhoneForward *phfwdNew(void) {
+    return newPhoneForward(false);
+}
+
+PhoneForward *phfwdNewConcurrent(void) {
+    return newPhoneForward(true);
+}
+
+/** Function starts a write.
+ * In concurrent mode function waits until other writers finish.
+ * @param[in, out] pf - a pointer to the PhoneForward structure.
+ */
+static void writeBegin(PhoneForward *pf) {
+    if (pf->concurrent) {
+        pthread_mutex_lock(&pf->lock);
+    }
+}
+
+/** Function ends a write.
+ * Function publishes the changes with @ref publish and lets other writers start.
+ * @p staleSequence is odd from before the first version whose reverse index stores forwardings
+ * of removed subtrees is published until after all of them are removed from it.
+ * @param[in, out] pf - a pointer to the PhoneForward structure.
+ */
+static void writeEnd(PhoneForward *pf) {
+    bool stale = pf->removed != NULL;
+    if (stale && atomic_load(&pf->staleSequence) % 2 == 0) {
+        atomic_fetch_add(&pf->staleSequence, 1);
+    }
+    publish(pf);
+    if (!stale && atomic_load(&pf->staleSequence) % 2 == 1) {
+        atomic_fetch_add(&pf->staleSequence, 1);
+    }
+    if (pf->concurrent) {
+        pthread_mutex_unlock(&pf->lock);
+    }
+}
+
+/** Function makes the pools of a structure changeable.
+ * The pools of a structure read by @ref phfwdLoad are stored in the read-only file, so
+ * before the first change function copies them to memory and builds the hash table of
+ * forwardings, which is not saved. It does nothing for other structures.
+ * @param[in, out] pf - a pointer to the PhoneForward structure, which is not a snapshot.
+ * @return Value @p false if failed to allocate memory. Otherwise @p true.
+ */
+static bool ownPools(PhoneForward *pf) {
+    if (pf->mapped == NULL) {
+        return true;
+    }
+    if (!poolOwn(&pf->nodes) || !poolOwn(&pf->smallArrays) || !poolOwn(&pf->digitArrays)
+        || !poolOwn(&pf->chunks) || !poolOwn(&pf->targets)) {
+        return false;
+    }
+
+    size_t bucketsSize = INITIAL_TARGET_BUCKETS;
+    while (bucketsSize <= pf->targetsCount) {
+        bucketsSize *= 2;
+    }
+    uint32_t *buckets = malloc(bucketsSize * sizeof(uint32_t));
+    if (buckets == NULL) {
+        return false;
+    }
+    for (size_t i = 0; i < bucketsSize; i++) {
+        buckets[i] = POOL_NONE;
+    }
+    // A saved pool has no freed elements, so every index stores a forwarding.
+    for (uint32_t forward = POOL_NONE + 1; forward < pf->targets.nextIndex; forward++) {
+        Target *target = targetAt(pf, forward);
+        target->hashNext = buckets[target->hash & (bucketsSize - 1)];
+        buckets[target->hash & (bucketsSize - 1)] = forward;
+    }
+    pf->targetBuckets = buckets;
+    pf->targetBucketsSize = bucketsSize;
+    storeUnmap(pf->mapped, pf->mappedSize);
+    pf->mapped = NULL;
+    pf->mappedSize = 0;
+    return true;
+}
+
+void phfwdDelete(PhoneForward *pf) {
+    if (pf == NULL) {
+        return;
+    }
+
+    // Snapshots share the nodes of the structure, so they are freed with the last of them.
+    PhoneForward *owner = pf->origin != NULL ? pf->origin : pf;
+    writeBegin(owner);
+    if (pf->origin != NULL) {
+        reclaimRelease(&owner->reclaimer, pf->snapshotVersion);
+    }
+    size_t references = --owner->references;
+    writeEnd(owner);
+    if (!owner->concurrent && owner->reclaimer.heldCount == 0) {
+        // Without snapshots nodes can be changed in place again.
+        owner->copying = false;
+    }
+
+    if (pf->origin != NULL) {
+        free(pf);
+    }
+    if (references == 0) {
+        destroyPhoneForward(owner);
+    }
+}
+
+PhoneForward *phfwdSnapshot(PhoneForward *pf) {
+    if (pf == NULL) {
+        return NULL;
+    }
+    PhoneForward *snapshot = malloc(sizeof(PhoneForward));
+    if (snapshot == NULL) {
+        return NULL;
+    }
+
+    PhoneForward *owner = pf->origin != NULL ? pf->origin : pf;
+    writeBegin(owner);
+    if (!ownPools(owner)) {
+        writeEnd(owner);
+        free(snapshot);
+        return NULL;
+    }
+    if (!owner->copying) {
+        // All existing nodes are published at once, later writes copy them.
+        for (NodeId id = POOL_NONE + 1; id < owner->nodes.nextIndex; id++) {
+            nodeAt(owner, id)->shared = 1;
+        }
+        owner->copying = true;
+        // Results are not cached while nodes are copied, as changes replace the nodes of their paths.
+        if (owner->cache != NULL) {
+            cacheClear(owner->cache);
+        }
+    }
+    snapshot->origin = owner;
+    snapshot->root = pf->root;
+    snapshot->reverseRoot = pf->reverseRoot;
+    snapshot->removed = NULL;
+    snapshot->removedLast = NULL;
+    atomic_init(&snapshot->staleSequence, atomic_load(&pf->staleSequence) % 2);
+    snapshot->cache = NULL;
+    memset(&snapshot->cacheStats, 0, sizeof(PhoneForwardCacheStats));
+    snapshot->trieSize = pf->trieSize;
+    snapshot->snapshotVersion = pf->origin != NULL ? pf->snapshotVersion : atomic_load(&owner->reclaimer.version);
+    snapshot->concurrent = false;
+    snapshot->copying = false;
+    bool held = reclaimHold(&owner->reclaimer, snapshot->snapshotVersion);
+    if (held) {
+        owner->references++;
+    }
+    writeEnd(owner);
+
+    if (!held) {
+        free(snapshot);
+        return NULL;
+    }
+    return snapshot;
+}
+
+/** Function starts reading a structure.
+ * In concurrent mode function announces the reader, so the version it reads is not freed.
+ * The version of a snapshot is held until the snapshot is deleted.
+ * @param[in] pf - a pointer to the PhoneForward structure or its snapshot.
+ * @return The version to be read.
+ */
+static Version readBegin(PhoneForward const *pf) {
+    Version version = {pf, POOL_NONE, POOL_NONE, RECLAIM_READERS, false};
+    if (!pf->concurrent) {
+        version.owner = pf->origin != NULL ? pf->origin : pf;
+        version.root = pf->root;
+        version.reverseRoot = pf->reverseRoot;
+        version.stale = atomic_load(&pf->staleSequence) % 2 == 1;
+    } else {
+        // Readers change only the atomic slots of the reclaimer.
+        version.slot = reclaimEnter((Reclaimer *) &pf->reclaimer);
+        // The version is clean if no removal made the reverse index stale before or while it was read.
+        uint64_t sequence = atomic_load(&pf->staleSequence);
+        uint64_t published = atomic_load(&pf->published);
+        version.root = (NodeId) published;
+        version.reverseRoot = (NodeId) (published >> 32);
+        version.stale = sequence % 2 == 1 || atomic_load(&pf->staleSequence) != sequence;
+    }
+    return version;
+}
+
+/** Function ends reading a structure.
+ * @param[in] version - a pointer to the version returned by @ref readBegin.
+ */
+static void readEnd(Version const *version) {
+    if (version->slot < RECLAIM_READERS) {
+        reclaimExit((Reclaimer *) &version->owner->reclaimer, version->slot);
+    }
+}
+
+/** Function frees an element of a pool.
+ * In copying mode readers and snapshots can still use the element, so it is freed
+ * by the reclaimer when they finish.
+ * @param[in, out] pf - a pointer to the structure owning the element;
+ * @param[in, out] pool - a pointer to the pool of the element;
+ * @param[in] index - the index of the element.
+ */
+static void release(PhoneForward *pf, Pool *pool, uint32_t index) {
+    if (pool == &pf->nodes) {
+        pf->usedNodes--;
+    }
+    if (pool == &pf->nodes || pool == &pf->smallArrays || pool == &pf->digitArrays) {
+        pf->usedBytes -= pool->elementSize;
+    }
+    if (!pf->copying) {
+        poolFree(pool, index);
+    } else {
+        reclaimRetire(&pf->reclaimer, pool, index);
+    }
+}
+
+/** Function returns the array of children of a node.
+ * @param[in] pf - a pointer to the structure owning the node;
+ * @param[in] node - a pointer to the node with at least @ref SMALL_CAPACITY children slots.
+ * @return A pointer to the array.
+ */
+static inline NodeId *childArray(PhoneForward const *pf, Node const *node) {
+    if (node->capacity == NUMBER_OF_DIGITS) {
+        return poolGet(&pf->digitArrays, node->next);
+    }
+    return poolGet(&pf->smallArrays, node->next);
+}
+
+/** Function returns a child of a node.
+ * @param[in] pf - a pointer to the structure owning the node;
+ * @param[in] node - a pointer to the node;
+ * @param[in] digit - the first digit of the child's label.
+ * @return The index of the child or @ref POOL_NONE if there is no such child.
+ */
+static NodeId getChild(PhoneForward const *pf, Node const *node, int digit) {
+    if (node->capacity == NUMBER_OF_DIGITS) {
+        return childArray(pf, node)[digit];
+    }
+    if (node->capacity == 1) {
+        return node->keys[0] == digit ? node->next : POOL_NONE;
+    }
+    for (int i = 0; i < node->numberOfNextDigits; i++) {
+        if (node->keys[i] == digit) {
+            return childArray(pf, node)[i];
+        }
+    }
+    return POOL_NONE;
+}
+
+/** Function returns the next child of a node in the order of digits.
+ * @param[in] pf - a pointer to the structure owning the node;
+ * @param[in] node - a pointer to the node;
+ * @param[in, out] position - a position in the array of children, the search starts from it
+ * and it is set after the returned child. It should be 0 before the first call.
+ * @return The index of the child or @ref POOL_NONE if there are no more children.
+ */
+static NodeId nextChild(PhoneForward const *pf, Node const *node, int *position) {
+    if (node->capacity == NUMBER_OF_DIGITS) {
+        NodeId const *children = childArray(pf, node);
+        while (*position < NUMBER_OF_DIGITS) {
+            NodeId child = children[(*position)++];
+            if (child != POOL_NONE) {
+                return child;
+            }
+        }
+        return POOL_NONE;
+    }
+    if (*position >= node->numberOfNextDigits) {
+        return POOL_NONE;
+    }
+    (*position)++;
+    return node->capacity == 1 ? node->next : childArray(pf, node)[*position - 1];
+}
+
+/** Function adds a node to the path of a walk.
+ * @param[in, out] walk - a pointer to the walk;
+ * @param[in] id - the index of the node;
+ * @param[in] depth - the number of digits on the path to the node, without its label.
+ * @return Value @p false if failed to allocate memory. Otherwise @p true.
+ */
+static bool walkPush(TrieWalk *walk, NodeId id, size_t depth) {
+    if (walk->framesCount == walk->framesSize) {
+        size_t newSize = 2 * walk->framesSize;
+        WalkFrame *newFrames = walk->frames == walk->localFrames ? malloc(newSize * sizeof(WalkFrame)) :
+                               realloc(walk->frames, newSize * sizeof(WalkFrame));
+        if (newFrames == NULL) {
+            walk->failed = true;
+            return false;
+        }
+        if (walk->frames == walk->localFrames) {
+            memcpy(newFrames, walk->localFrames, sizeof(walk->localFrames));
+        }
+        walk->frames = newFrames;
+        walk->framesSize = newSize;
+    }
+    walk->frames[walk->framesCount++] = (WalkFrame) {id, depth, -1};
+    return true;
+}
+
+/** Function enters a node of a walk.
+ * Function writes the label of the node after the digits of the path, if they are stored.
+ * @param[in, out] walk - a pointer to the walk;
+ * @param[in, out] frame - a pointer to the frame of the node on the top of the path.
+ * @return Value @p false if failed to allocate memory. Otherwise @p true.
+ */
+static bool walkEnter(TrieWalk *walk, WalkFrame *frame) {
+    Node const *node = nodeAt(walk->pf, frame->id);
+    size_t length = frame->depth + node->labelLength;
+    if (walk->digits != NULL) {
+        if (!reserveChars(&walk->digits, &walk->digitsSize, walk->localDigits, frame->depth, length + 1)) {
+            walk->failed = true;
+            return false;
+        }
+        for (size_t i = 0; i < node->labelLength; i++) {
+            walk->digits[frame->depth + i] = digitToChar(labelDigit(node, i));
+        }
+        walk->digits[length] = '\0';
+    }
+    frame->position = 0;
+    walk->length = length;
+    return true;
+}
+
+/** Function returns the next node of a walk.
+ * Children are visited in the order of digits. The first @p length digits of @p digits
+ * are the path to the returned node. A node returned after its children can be freed
+ * before the next step. A walk that failed to allocate memory can be continued after
+ * clearing @p failed, no node is skipped.
+ * @param[in, out] walk - a pointer to the walk.
+ * @return The index of the node or @ref POOL_NONE if the walk has ended or failed
+ * to allocate memory.
+ */
+static NodeId walkNext(TrieWalk *walk) {
+    while (walk->framesCount > 0 && !walk->failed) {
+        WalkFrame *frame = &walk->frames[walk->framesCount - 1];
+        if (frame->position < 0) {
+            if (!walkEnter(walk, frame)) {
+                return POOL_NONE;
+            }
+            if (!walk->postorder) {
+                return frame->id;
+            }
+        }
+        Node const *node = nodeAt(walk->pf, frame->id);
+        int position = frame->position;
+        NodeId child = nextChild(walk->pf, node, &frame->position);
+        if (child != POOL_NONE) {
+            if (!walkPush(walk, child, frame->depth + node->labelLength)) {
+                frame->position = position;
+            }
+        } else {
+            // Children wrote their labels after the digits of the node.
+            walk->framesCount--;
+            walk->length = frame->depth + node->labelLength;
+            if (walk->postorder) {
+                return frame->id;
+            }
+        }
+    }
+    return POOL_NONE;
+}
+
+/** Function frees the array of children of a node.
+ * @param[in, out] pf - a pointer to the structure owning the node;
+ * @param[in] node - a pointer to the node.
+ */
+static void freeChildArray(PhoneForward *pf, Node const *node) {
+    if (node->capacity == NUMBER_OF_DIGITS) {
+        release(pf, &pf->digitArrays, node->next);
+    } else if (node->capacity == SMALL_CAPACITY) {
+        release(pf, &pf->smallArrays, node->next);
+    }
+}
+
+/** Function changes the size of the array of children.
+ * Function moves the children of @p node to a new array of size @p capacity, which has
+ * to fit all of them.
+ * @param[in, out] pf - a pointer to the structure owning the node;
+ * @param[in, out] node - a pointer to the node;
+ * @param[in] capacity - the new size: 0, 1, @ref SMALL_CAPACITY or @ref NUMBER_OF_DIGITS.
+ * @return Value @p false if failed to allocate memory. Otherwise @p true.
+ */
+static bool resizeChildren(PhoneForward *pf, Node *node, uint8_t capacity) {
+    NodeId children[NUMBER_OF_DIGITS];
+    uint8_t digits[NUMBER_OF_DIGITS];
+    int count = 0, position = 0;
+    NodeId child;
+    while ((child = nextChild(pf, node, &position)) != POOL_NONE) {
+        children[count] = child;
+        digits[count] = labelDigit(nodeAt(pf, child), 0);
+        count++;
+    }
+
+    uint32_t array = POOL_NONE;
+    if (capacity == NUMBER_OF_DIGITS) {
+        array = poolAlloc(&pf->digitArrays);
+    } else if (capacity == SMALL_CAPACITY) {
+        array = poolAlloc(&pf->smallArrays);
+    }
+    if (capacity > 1 && array == POOL_NONE) {
+        return false;
+    }
+    if (capacity > 1) {
+        pf->usedBytes += capacity * sizeof(NodeId);
+    }
+    freeChildArray(pf, node);
+
+    node->capacity = capacity;
+    if (capacity == 0) {
+        node->next = POOL_NONE;
+    } else if (capacity == 1) {
+        node->next = children[0];
+        node->keys[0] = digits[0];
+    } else {
+        node->next = array;
+        NodeId *newChildren = childArray(pf, node);
+        if (capacity == NUMBER_OF_DIGITS) {
+            for (int i = 0; i < NUMBER_OF_DIGITS; i++) {
+                newChildren[i] = POOL_NONE;
+            }
+        }
+        for (int i = 0; i < count; i++) {
+            if (capacity == NUMBER_OF_DIGITS) {
+                newChildren[digits[i]] = children[i];
+            } else {
+                newChildren[i] = children[i];
+                node->keys[i] = digits[i];
+            }
+        }
+    }
+    return true;
+}
+
+/** Function adds a child to a node or replaces the child with the same first digit.
+ * The array of children grows if needed.
+ * @param[in, out] pf - a pointer to the structure owning the node;
+ * @param[in, out] node - a pointer to the node;
+ * @param[in] child - the index of the child.
+ * @return Value @p false if failed to allocate memory. Otherwise @p true.
+ */
+static bool setChild(PhoneForward *pf, Node *node, NodeId child) {
+    int digit = labelDigit(nodeAt(pf, child), 0);
+    if (node->capacity == NUMBER_OF_DIGITS) {
+        NodeId *children = childArray(pf, node);
+        if (children[digit] == POOL_NONE) {
+            node->numberOfNextDigits++;
+        }
+        children[digit] = child;
+        return true;
+    }
+
+    int i = 0;
+    while (i < node->numberOfNextDigits && node->keys[i] < digit) {
+        i++;
+    }
+    if (i < node->numberOfNextDigits && node->keys[i] == digit) {
+        if (node->capacity == 1) {
+            node->next = child;
+        } else {
+            childArray(pf, node)[i] = child;
+        }
+        return true;
+    }
+
+    if (node->numberOfNextDigits == node->capacity) {
+        uint8_t capacity = node->capacity == 0 ? 1 :
+                           node->capacity == 1 ? SMALL_CAPACITY : NUMBER_OF_DIGITS;
+        if (!resizeChildren(pf, node, capacity)) {
+            return false;
+        }
+        if (capacity == NUMBER_OF_DIGITS) {
+            return setChild(pf, node, child);
+        }
+    }
+
+    if (node->capacity == 1) {
+        node->next = child;
+        node->keys[0] = digit;
+    } else {
+        NodeId *children = childArray(pf, node);
+        for (int j = node->numberOfNextDigits; j > i; j--) {
+            children[j] = children[j - 1];
+            node->keys[j] = node->keys[j - 1];
+        }
+        children[i] = child;
+        node->keys[i] = digit;
+    }
+    node->numberOfNextDigits++;
+    return true;
+}
+
+/** Function removes a child of a node.
+ * The array of children shrinks if the remaining children fit in a smaller one.
+ * @param[in, out] pf - a pointer to the structure owning the node;
+ * @param[in, out] node - a pointer to the node;
+ * @param[in] digit - the first digit of the removed child's label.
+ */
+static void removeChild(PhoneForward *pf, Node *node, int digit) {
+    if (node->capacity == NUMBER_OF_DIGITS) {
+        childArray(pf, node)[digit] = POOL_NONE;
+    } else if (node->capacity == 1) {
+        node->next = POOL_NONE;
+    } else {
+        NodeId *children = childArray(pf, node);
+        int i = 0;
+        while (node->keys[i] != digit) {
+            i++;
+        }
+        for (; i + 1 < node->numberOfNextDigits; i++) {
+            children[i] = children[i + 1];
+            node->keys[i] = node->keys[i + 1];
+        }
+    }
+    node->numberOfNextDigits--;
+
+    // Shrinking can not fail when the new array is not allocated.
+    if (node->numberOfNextDigits <= 1 && node->capacity > 1) {
+        resizeChildren(pf, node, node->numberOfNextDigits);
+    } else if (node->numberOfNextDigits == 0) {
+        node->capacity = 0;
+    } else if (node->numberOfNextDigits <= SMALL_CAPACITY && node->capacity == NUMBER_OF_DIGITS) {
+        resizeChildren(pf, node, SMALL_CAPACITY);
+    }
+}
+
+/** Function frees chunks.
+ * @param[in, out] pf - a pointer to the structure owning the chunks;
+ * @param[in] chunks - the index of the first chunk of the list.
+ */
+static void freeChunks(PhoneForward *pf, uint32_t chunks) {
+    while (chunks != POOL_NONE) {
+        uint32_t next = ((Chunk *) poolGet(&pf->chunks, chunks))->next;
+        release(pf, &pf->chunks, chunks);
+        chunks = next;
+    }
+}
+
+/** Function drops a reference to a forwarding.
+ * The forwarding is removed from the hash table and freed when no prefix is forwarded to it.
+ * @param[in, out] pf - a pointer to the structure owning the forwarding;
+ * @param[in] forward - the index of the forwarding or @ref POOL_NONE.
+ */
+static void releaseTarget(PhoneForward *pf, uint32_t forward) {
+    if (forward == POOL_NONE || --targetAt(pf, forward)->references > 0) {
+        return;
+    }
+    Target const *target = targetAt(pf, forward);
+    uint32_t *link = &pf->targetBuckets[target->hash & (pf->targetBucketsSize - 1)];
+    while (*link != forward) {
+        link = &targetAt(pf, *link)->hashNext;
+    }
+    *link = target->hashNext;
+    pf->targetsCount--;
+    freeChunks(pf, target->chunks);
+    release(pf, &pf->targets, forward);
+}
+
+/** Function frees a subtree.
+ * Function returns all nodes of the subtree, arrays of their children and their forwardings
+ * to the pools, so they can be reused.
+ * @param[in, out] pf - a pointer to the structure owning the subtree;
+ * @param[in] id - the index of the root of the subtree.
+ */
+static void freeSubtree(PhoneForward *pf, NodeId id) {
+    // Nodes are freed after their children, whose indices they store.
+    TrieWalk walk;
+    walkInit(&walk, pf, id, NULL, 0, true);
+    while ((id = walkNext(&walk)) != POOL_NONE) {
+        Node *node = nodeAt(pf, id);
+        freeChildArray(pf, node);
+        releaseTarget(pf, node->forward);
+        release(pf, &pf->nodes, id);
+    }
+    walkDestroy(&walk);
+}
+
+/** Function returns the place where a child of a node is stored.
+ * @param[in] pf - a pointer to the structure owning the node;
+ * @param[in] node - a pointer to the node;
+ * @param[in] digit - the first digit of the child's label.
+ * @return A pointer to the index of the child or NULL if there is no such child.
+ */
+static NodeId *childSlot(PhoneForward const *pf, Node *node, int digit) {
+    if (node->capacity == NUMBER_OF_DIGITS) {
+        NodeId *slot = &childArray(pf, node)[digit];
+        return *slot == POOL_NONE ? NULL : slot;
+    }
+    if (node->capacity == 1) {
+        return node->keys[0] == digit ? &node->next : NULL;
+    }
+    for (int i = 0; i < node->numberOfNextDigits; i++) {
+        if (node->keys[i] == digit) {
+            return &childArray(pf, node)[i];
+        }
+    }
+    return NULL;
+}
+
+/** Function makes a node changeable.
+ * In copying mode a published node is replaced by its copy with a copy of the array
+ * of children, which can be changed without disturbing readers. The forwarding and
+ * the children are shared by both nodes.
+ * @param[in, out] pf - a pointer to the structure owning the node;
+ * @param[in, out] slot - a pointer to the index of the node in its parent, which has
+ * to be changeable, or a pointer to a root.
+ * @return The index of the node that can be changed or @ref POOL_NONE if failed to allocate memory.
+ */
+static NodeId ownNode(PhoneForward *pf, NodeId *slot) {
+    NodeId id = *slot;
+    if (!pf->copying || !nodeAt(pf, id)->shared) {
+        return id;
+    }
+
+    NodeId copyId = newTrieNode(pf);
+    if (copyId == POOL_NONE) {
+        return POOL_NONE;
+    }
+    Node *copy = nodeAt(pf, copyId);
+    Node const *node = nodeAt(pf, id);
+    *copy = *node;
+    copy->shared = 0;
+    if (node->capacity > 1) {
+        Pool *pool = node->capacity == NUMBER_OF_DIGITS ? &pf->digitArrays : &pf->smallArrays;
+        copy->next = poolAlloc(pool);
+        if (copy->next == POOL_NONE) {
+            poolFree(&pf->nodes, copyId);
+            pf->usedNodes--;
+            pf->usedBytes -= sizeof(Node);
+            return POOL_NONE;
+        }
+        pf->usedBytes += pool->elementSize;
+        memcpy(poolGet(pool, copy->next), poolGet(pool, node->next), pool->elementSize);
+    }
+
+    freeChildArray(pf, node);
+    release(pf, &pf->nodes, id);
+    *slot = copyId;
+    return copyId;
+}
+
+/** Function makes all nodes on a path changeable.
+ * Function calls @ref ownNode for the nodes of the path from the top and replaces them
+ * in @p path with their changeable copies.
+ * @param[in, out] pf - a pointer to the structure owning the trie;
+ * @param[in, out] root - a pointer to the root of the trie;
+ * @param[in, out] path - an array of nodes from the root, each one is a child of the previous one;
+ * @param[in] pathSize - the number of nodes in @p path.
+ * @return Value @p false if failed to allocate memory. Otherwise @p true.
+ */
+static bool ownPath(PhoneForward *pf, NodeId *root, NodeId *path, size_t pathSize) {
+    path[0] = ownNode(pf, root);
+    if (path[0] == POOL_NONE) {
+        return false;
+    }
+    for (size_t i = 1; i < pathSize; i++) {
+        NodeId *slot = childSlot(pf, nodeAt(pf, path[i - 1]), labelDigit(nodeAt(pf, path[i]), 0));
+        path[i] = ownNode(pf, slot);
+        if (path[i] == POOL_NONE) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/** Function returns the length of a forwarding.
+ * @param[in] pf - a pointer to the structure owning the forwarding;
+ * @param[in] forward - the index of the forwarding.
+ * @return The number of characters of the forwarding.
+ */
+static inline size_t forwardLength(PhoneForward const *pf, uint32_t forward) {
+    return targetAt(pf, forward)->length;
+}
+
+/** Function copies a forwarding to a string.
+ * @param[in] pf - a pointer to the structure owning the forwarding;
+ * @param[in] forward - the index of the forwarding;
+ * @param[out] num - a pointer to the array which fits the forwarding and '\0'.
+ */
+static void copyForward(PhoneForward const *pf, uint32_t forward, char *num) {
+    Target const *target = targetAt(pf, forward);
+    size_t size = target->length;
+    uint32_t chunks = target->chunks;
+    while (size > 0) {
+        Chunk const *chunk = poolGet(&pf->chunks, chunks);
+        size_t copied = size < CHUNK_CAPACITY ? size : CHUNK_CAPACITY;
+        unpackNumber(chunk->digits, copied, num);
+        num += copied;
+        size -= copied;
+        chunks = chunk->next;
+    }
+    *num = '\0';
+}
+
+/** Function calculates the hash of a number.
+ * @param[in] num - a pointer to the number;
+ * @param[in] numSize - the number of digits in @p num.
+ * @return The FNV-1a hash of @p num.
+ */
+static uint32_t hashNumber(char const *num, size_t numSize) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < numSize; i++) {
+        hash = (hash ^ (uint8_t) num[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/** Function checks if a forwarding is equal to a number.
+ * @param[in] pf - a pointer to the structure owning the forwarding;
+ * @param[in] target - a pointer to the forwarding;
+ * @param[in] num - a pointer to the number;
+ * @param[in] numSize - the number of digits in @p num.
+ * @return Value @p true if the forwarding is @p num, @p false otherwise.
+ */
+static bool targetEquals(PhoneForward const *pf, Target const *target, char const *num, size_t numSize) {
+    if (target->length != numSize) {
+        return false;
+    }
+    uint32_t chunks = target->chunks;
+    for (size_t begin = 0; begin < numSize; begin += CHUNK_CAPACITY) {
+        Chunk const *chunk = poolGet(&pf->chunks, chunks);
+        size_t size = numSize - begin < CHUNK_CAPACITY ? numSize - begin : CHUNK_CAPACITY;
+        uint8_t digits[CHUNK_CAPACITY / 2];
+        packNumber(num + begin, size, digits);
+        if (memcmp(chunk->digits, digits, packedSize(size)) != 0) {
+            return false;
+        }
+        chunks = chunk->next;
+    }
+    return true;
+}
+
+/** Function doubles the hash table of forwardings.
+ * @param[in, out] pf - a pointer to the structure owning the hash table.
+ * @return Value @p false if failed to allocate memory. Otherwise @p true.
+ */
+static bool growTargetBuckets(PhoneForward *pf) {
+    size_t bucketsSize = pf->targetBucketsSize == 0 ? INITIAL_TARGET_BUCKETS : 2 * pf->targetBucketsSize;
+    uint32_t *buckets = malloc(bucketsSize * sizeof(uint32_t));
+    if (buckets == NULL) {
+        return false;
+    }
+    for (size_t i = 0; i < bucketsSize; i++) {
+        buckets[i] = POOL_NONE;
+    }
+    for (size_t i = 0; i < pf->targetBucketsSize; i++) {
+        uint32_t forward = pf->targetBuckets[i];
+        while (forward != POOL_NONE) {
+            Target *target = targetAt(pf, forward);
+            uint32_t next = target->hashNext;
+            target->hashNext = buckets[target->hash & (bucketsSize - 1)];
+            buckets[target->hash & (bucketsSize - 1)] = forward;
+            forward = next;
+        }
+    }
+    free(pf->targetBuckets);
+    pf->targetBuckets = buckets;
+    pf->targetBucketsSize = bucketsSize;
+    return true;
+}
+
+/** Function adds a reference to a forwarding.
+ * Function finds the forwarding equal to @p num in the hash table or creates it.
+ * @param[in, out] pf - a pointer to the structure owning the forwarding;
+ * @param[in] num - a pointer to the number;
+ * @param[in] numSize - the number of digits in @p num.
+ * @return The index of the forwarding or @ref POOL_NONE if failed to allocate memory.
+ */
+static uint32_t internTarget(PhoneForward *pf, char const *num, size_t numSize) {
+    uint32_t hash = hashNumber(num, numSize);
+    if (pf->targetBucketsSize > 0) {
+        uint32_t forward = pf->targetBuckets[hash & (pf->targetBucketsSize - 1)];
+        while (forward != POOL_NONE) {
+            Target *target = targetAt(pf, forward);
+            if (target->hash == hash && targetEquals(pf, target, num, numSize)) {
+                target->references++;
+                return forward;
+            }
+            forward = target->hashNext;
+        }
+    }
+    if (pf->targetsCount >= pf->targetBucketsSize && !growTargetBuckets(pf)) {
+        return POOL_NONE;
+    }
+
+    // Chunks are created from the end, so each one can point to the next.
+    uint32_t chunks = POOL_NONE;
+    for (size_t i = (numSize + CHUNK_CAPACITY - 1) / CHUNK_CAPACITY; i > 0; i--) {
+        uint32_t id = poolAlloc(&pf->chunks);
+        if (id == POOL_NONE) {
+            freeChunks(pf, chunks);
+            return POOL_NONE;
+        }
+        Chunk *chunk = poolGet(&pf->chunks, id);
+        size_t begin = (i - 1) * CHUNK_CAPACITY;
+        packNumber(num + begin, numSize - begin < CHUNK_CAPACITY ? numSize - begin : CHUNK_CAPACITY, chunk->digits);
+        chunk->next = chunks;
+        chunks = id;
+    }
+    uint32_t forward = poolAlloc(&pf->targets);
+    if (forward == POOL_NONE) {
+        freeChunks(pf, chunks);
+        return POOL_NONE;
+    }
+    Target *target = targetAt(pf, forward);
+    target->chunks = chunks;
+    target->length = numSize;
+    target->references = 1;
+    target->hash = hash;
+    target->hashNext = pf->targetBuckets[hash & (pf->targetBucketsSize - 1)];
+    pf->targetBuckets[hash & (pf->targetBucketsSize - 1)] = forward;
+    pf->targetsCount++;
+    return forward;
+}
+
+/** Function compares the label of a node with a part of a number.
+ * @param[in] node - a pointer to the node;
+ * @param[in] num - a pointer to the part of the number following the node's parent;
+ * @param[in] numSize - the number of digits in @p num.
+ * @return The number of leading digits of the label that match @p num.
+ */
+static size_t matchLabel(Node const *node, char const *num, size_t numSize) {
+    // The digits of the number are packed like the label, so they are compared at once.
+    size_t size = node->labelLength < numSize ? node->labelLength : numSize;
+    uint64_t digits = 0;
+    for (size_t i = 0; i < size; i++) {
+        digits |= (uint64_t) charToDigit(num[i]) << (60 - 4 * i);
+    }
+    uint64_t difference = (node->label ^ digits) & labelMask(size);
+    return difference == 0 ? size : (size_t) __builtin_clzll(difference) / 4;
+}
+
+/** Function compares the label of a node with a part of a packed number.
+ * @param[in] node - a pointer to the node;
+ * @param[in] digits - a pointer to the number packed by @ref packNumber, followed by
+ * @ref PACKED_PADDING bytes;
+ * @param[in] i - the index of the digit following the node's parent, smaller than @p numSize;
+ * @param[in] numSize - the number of digits of the number.
+ * @return The number of leading digits of the label that match the number from the digit @p i.
+ */
+static size_t matchPacked(Node const *node, uint8_t const *digits, size_t i, size_t numSize) {
+    size_t size = node->labelLength < numSize - i ? node->labelLength : numSize - i;
+    uint64_t difference = (node->label ^ packedWindow(digits, i)) & labelMask(size);
+    return difference == 0 ? size : (size_t) __builtin_clzll(difference) / 4;
+}
+
+/** Function creates a chain of nodes storing a number.
+ * @param[in, out] pf - a pointer to the structure owning the nodes;
+ * @param[in] num - a pointer to the digits to be stored;
+ * @param[in] numSize - the number of digits in @p num, at least 1;
+ * @param[out] last - the last node of the chain.
+ * @return The index of the first node of the chain or @ref POOL_NONE if failed to allocate memory.
+ */
+static NodeId newChain(PhoneForward *pf, char const *num, size_t numSize, NodeId *last) {
+    NodeId first = POOL_NONE, prev = POOL_NONE;
+    size_t i = 0;
+    while (i < numSize) {
+        NodeId id = newTrieNode(pf);
+        if (id == POOL_NONE) {
+            if (first != POOL_NONE) {
+                freeSubtree(pf, first);
+            }
+            return POOL_NONE;
+        }
+        Node *node = nodeAt(pf, id);
+        while (i < numSize && node->labelLength < LABEL_CAPACITY) {
+            node->label |= (uint64_t) charToDigit(num[i++]) << (60 - 4 * node->labelLength++);
+        }
+        if (prev == POOL_NONE) {
+            first = id;
+        } else {
+            // A node with one child never needs to allocate an array.
+            setChild(pf, nodeAt(pf, prev), id);
+        }
+        prev = id;
+    }
+    *last = prev;
+    return first;
+}
+
+/** Function splits a node into two.
+ * The first @p at digits of the label of @p node are moved to a new node, which replaces
+ * @p node as a child of @p parent and has @p node as its only child.
+ * @param[in, out] pf - a pointer to the structure owning the nodes;
+ * @param[in, out] parent - a pointer to the parent of @p node;
+ * @param[in] id - the index of the node;
+ * @param[in] at - the number of digits moved to the new node, less than the label's length.
+ * @return The index of the new node or @ref POOL_NONE if failed to allocate memory.
+ */
+static NodeId splitNode(PhoneForward *pf, Node *parent, NodeId id, size_t at) {
+    NodeId upperId = newTrieNode(pf);
+    if (upperId == POOL_NONE) {
+        return POOL_NONE;
+    }
+    Node *upper = nodeAt(pf, upperId);
+    Node *node = nodeAt(pf, id);
+    upper->label = node->label & labelMask(at);
+    upper->labelLength = at;
+    node->labelLength -= at;
+    node->label <<= 4 * at;
+    setChild(pf, upper, id);
+    setChild(pf, parent, upperId);
+    return upperId;
+}
+
+/** Function finds the node storing a number, creating the missing nodes.
+ * All nodes on the path of the number are made changeable with @ref ownNode.
+ * @param[in, out] pf - a pointer to the structure owning the trie;
+ * @param[in, out] root - a pointer to the root of the trie;
+ * @param[in] num - a pointer to the number;
+ * @param[in] numSize - the number of digits in @p num.
+ * @return The index of the node or @ref POOL_NONE if failed to allocate memory.
+ */
+static NodeId insertNumber(PhoneForward *pf, NodeId *root, char const *num, size_t numSize) {
+    NodeId id = ownNode(pf, root);
+    if (id == POOL_NONE) {
+        return POOL_NONE;
+    }
+    size_t i = 0;
+    while (i < numSize) {
+        Node *node = nodeAt(pf, id);
+        NodeId *slot = childSlot(pf, node, charToDigit(num[i]));
+        if (slot == NULL) {
+            NodeId last;
+            NodeId child = newChain(pf, num + i, numSize - i, &last);
+            if (child == POOL_NONE) {
+                return POOL_NONE;
+            }
+            if (!setChild(pf, node, child)) {
+                freeSubtree(pf, child);
+                return POOL_NONE;
+            }
+            return last;
+        }
+        NodeId child = ownNode(pf, slot);
+        if (child == POOL_NONE) {
+            return POOL_NONE;
+        }
+        size_t matched = matchLabel(nodeAt(pf, child), num + i, numSize - i);
+        if (matched < nodeAt(pf, child)->labelLength) {
+            child = splitNode(pf, node, child, matched);
+            if (child == POOL_NONE) {
+                return POOL_NONE;
+            }
+        }
+        id = child;
+        i += matched;
+    }
+    return id;
+}
+
+/** Function marks the end of the prefix @p num1 with corresponding new prefix @p num2.
+ * Function sets the forwarding to @p num1 used in @ref phfwdAdd function.
+ * @param[in, out] pf - a pointer to the structure owning the node;
+ * @param[in, out] node - a pointer to the node describing the last character of @p num1;
+ * @param[in] forwardNum - a pointer to the new prefix;
+ * @param[in] forwardSize - the number of digits in @p forwardNum.
+ * @return Value @p false if failed to allocate memory. Otherwise @p true.
+ */
+static bool mark(PhoneForward *pf, Node *node, char const *forwardNum, size_t forwardSize) {
+    uint32_t forward = internTarget(pf, forwardNum, forwardSize);
+    if (forward == POOL_NONE) {
+        return false;
+    }
+    releaseTarget(pf, node->forward);
+    node->forward = forward;
+    return true;
+}
+
+/** Function removes a node which has no forwarding and no children.
+ * Then it merges the parent with its only remaining child if their labels fit in one node.
+ * Nodes on the @p path are checked from the bottom until one of them is still needed.
+ * @param[in, out] pf - a pointer to the structure owning the trie;
+ * @param[in] path - an array of changeable nodes from the root to the removed node;
+ * @param[in] pathSize - the number of nodes in @p path.
+ */
+static void pruneNodes(PhoneForward *pf, NodeId const *path, size_t pathSize) {
+    while (pathSize > 1) {
+        Node *node = nodeAt(pf, path[pathSize - 1]);
+        Node *parent = nodeAt(pf, path[pathSize - 2]);
+        if (node->forward != POOL_NONE || node->numberOfNextDigits > 1) {
+            return;
+        }
+        if (node->numberOfNextDigits == 1) {
+            if (node->capacity != 1 || node->labelLength + nodeAt(pf, node->next)->labelLength > LABEL_CAPACITY) {
+                return;
+            }
+            NodeId childId = ownNode(pf, &node->next);
+            if (childId == POOL_NONE) {
+                return;
+            }
+            // The node is merged into its child, so indices of nodes with forwardings do not change.
+            Node *child = nodeAt(pf, childId);
+            child->label = node->label | child->label >> (4 * node->labelLength);
+            child->labelLength += node->labelLength;
+            setChild(pf, parent, childId);
+            release(pf, &pf->nodes, path[pathSize - 1]);
+            return;
+        }
+        removeChild(pf, parent, labelDigit(node, 0));
+        release(pf, &pf->nodes, path[pathSize - 1]);
+        pathSize--;
+    }
+}
+
+/** Function finds the nodes storing a number.
+ * Function follows @p num from @p root as long as the labels of the nodes match it.
+ * The label of the last node on the path can be longer than the rest of @p num.
+ * @param[in] pf - a pointer to the structure owning the trie;
+ * @param[in] root - the root of the trie;
+ * @param[in] num - a pointer to the number;
+ * @param[in] numSize - the number of digits in @p num;
+ * @param[out] pathSize - the number of nodes on the path;
+ * @param[out] end - the number of digits in the labels on the path.
+ * @return An array of nodes from @p root or NULL if failed to allocate memory.
+ */
+static NodeId *findPath(PhoneForward const *pf, NodeId root, char const *num, size_t numSize,
+                        size_t *pathSize, size_t *end) {
+    size_t maxPathSize = INITIAL_PATH_SIZE;
+    NodeId *path = malloc(maxPathSize * sizeof(NodeId));
+    if (path == NULL) {
+        return NULL;
+    }
+    *pathSize = 0;
+    *end = 0;
+    path[(*pathSize)++] = root;
+
+    while (*end < numSize) {
+        NodeId child = getChild(pf, nodeAt(pf, path[*pathSize - 1]), charToDigit(num[*end]));
+        if (child == POOL_NONE) {
+            break;
+        }
+        Node const *node = nodeAt(pf, child);
+        size_t matched = matchLabel(node, num + *end, numSize - *end);
+        if (matched < node->labelLength && *end + matched < numSize) {
+            break;
+        }
+        if (*pathSize == maxPathSize) {
+            maxPathSize *= 2;
+            NodeId *newPath = realloc(path, maxPathSize * sizeof(NodeId));
+            if (newPath == NULL) {
+                free(path);
+                return NULL;
+            }
+            path = newPath;
+        }
+        path[(*pathSize)++] = child;
+        *end += node->labelLength;
+    }
+    return path;
+}
+
+/** Function marks the changed part of the trie in the cache of results.
+ * Adding @p num changes only the deepest node whose label matches it fully, by setting its
+ * forwarding or replacing one of its children, and the child it splits. After removing @p num
+ * and pruning nodes, the deepest node left on its path is the highest changed one. A cached
+ * result stays valid as long as none of the nodes on its path is marked, so only results of
+ * numbers passing the marked node are invalidated. Does nothing if the cache is disabled or
+ * nodes are copied, as then nothing is cached.
+ * @param[in, out] pf - a pointer to the structure owning the trie;
+ * @param[in] num - a pointer to the number, which is about to be added or has been removed;
+ * @param[in] numSize - the number of digits in @p num.
+ */
+static void touchPath(PhoneForward *pf, char const *num, size_t numSize) {
+    if (pf->cache == NULL || pf->copying) {
+        return;
+    }
+    NodeId id = pf->root;
+    NodeId child = POOL_NONE;
+    size_t i = 0;
+    while (i < numSize) {
+        child = getChild(pf, nodeAt(pf, id), charToDigit(num[i]));
+        if (child == POOL_NONE) {
+            break;
+        }
+        Node const *node = nodeAt(pf, child);
+        if (matchLabel(node, num + i, numSize - i) < node->labelLength) {
+            break;
+        }
+        id = child;
+        child = POOL_NONE;
+        i += node->labelLength;
+    }
+    cacheAdvance(pf->cache);
+    if (!cacheTouch(pf->cache, id) || (child != POOL_NONE && !cacheTouch(pf->cache, child))) {
+        cacheClear(pf->cache);
+    }
+}
+
+/** Function adds a source of a forwarding to the reverse index.
+ * @param[in, out] pf - a pointer to the PhoneForward structure;
+ * @param[in] target - a pointer to the forwarding @p num2;
+ * @param[in] targetSize - the number of digits in @p target;
+ * @param[in] source - a pointer to the forwarded prefix @p num1;
+ * @param[in] sourceSize - the number of digits in @p source.
+ * @return Value @p false if failed to allocate memory. Otherwise @p true.
+ */
+static bool addSource(PhoneForward *pf, char const *target, size_t targetSize, char const *source,
+                      size_t sourceSize) {
+    NodeId targetId = insertNumber(pf, &pf->reverseRoot, target, targetSize);
+    if (targetId == POOL_NONE) {
+        return false;
+    }
+    Node *targetNode = nodeAt(pf, targetId);
+    if (targetNode->forward == POOL_NONE) {
+        targetNode->forward = newTrieNode(pf);
+        if (targetNode->forward == POOL_NONE) {
+            return false;
+        }
+    }
+
+    NodeId id = insertNumber(pf, &targetNode->forward, source, sourceSize);
+    if (id == POOL_NONE) {
+        if (nodeAt(pf, targetNode->forward)->numberOfNextDigits == 0) {
+            release(pf, &pf->nodes, targetNode->forward);
+            targetNode->forward = POOL_NONE;
+        }
+        return false;
+    }
+    nodeAt(pf, id)->forward = SOURCE_MARK;
+    return true;
+}
+
+/** Function removes a source of a forwarding from the reverse index.
+ * Nodes that are no longer needed are removed from both tries.
+ * @param[in, out] pf - a pointer to the PhoneForward structure;
+ * @param[in] target - a pointer to the forwarding @p num2;
+ * @param[in] targetSize - the number of digits in @p target;
+ * @param[in] source - a pointer to the forwarded prefix @p num1;
+ * @param[in] sourceSize - the number of digits in @p source.
+ */
+static void removeSource(PhoneForward *pf, char const *target, size_t targetSize, char const *source,
+                         size_t sourceSize) {
+    size_t pathSize, end;
+    NodeId *path = findPath(pf, pf->reverseRoot, target, targetSize, &pathSize, &end);
+    if (path == NULL) {
+        return;
+    }
+    NodeId forward = nodeAt(pf, path[pathSize - 1])->forward;
+    if (end == targetSize && forward != POOL_NONE) {
+        size_t sourcePathSize, sourceEnd;
+        NodeId *sourcePath = findPath(pf, forward, source, sourceSize, &sourcePathSize, &sourceEnd);
+        if (sourcePath != NULL && sourceEnd == sourceSize && ownPath(pf, &pf->reverseRoot, path, pathSize)
+            && ownPath(pf, &nodeAt(pf, path[pathSize - 1])->forward, sourcePath, sourcePathSize)) {
+            Node *targetNode = nodeAt(pf, path[pathSize - 1]);
+            nodeAt(pf, sourcePath[sourcePathSize - 1])->forward = POOL_NONE;
+            pruneNodes(pf, sourcePath, sourcePathSize);
+            if (nodeAt(pf, targetNode->forward)->numberOfNextDigits == 0) {
+                release(pf, &pf->nodes, targetNode->forward);
+                targetNode->forward = POOL_NONE;
+                pruneNodes(pf, path, pathSize);
+            }
+        }
+        free(sourcePath);
+    }
+    free(path);
+}
+
+/** Function finds the forwarding of a number.
+ * @param[in] pf - a pointer to the structure owning the trie;
+ * @param[in] root - the root of the trie;
+ * @param[in] num - a pointer to the number;
+ * @param[in] numSize - the number of digits in @p num.
+ * @return The index of the forwarding of the node storing exactly @p num or @ref POOL_NONE
+ * if there is no such node or it is not forwarded.
+ */
+static uint32_t findForward(PhoneForward const *pf, NodeId root, char const *num, size_t numSize) {
+    Node const *node = nodeAt(pf, root);
+    size_t i = 0;
+    while (i < numSize) {
+        NodeId child = getChild(pf, node, charToDigit(num[i]));
+        if (child == POOL_NONE) {
+            return POOL_NONE;
+        }
+        node = nodeAt(pf, child);
+        if (matchLabel(node, num + i, numSize - i) < node->labelLength) {
+            return POOL_NONE;
+        }
+        i += node->labelLength;
+    }
+    return node->forward;
+}
+
+/** Function adds the changes of the nodes made since a given moment to the size of the trie.
+ * Function is called after changing only the trie of forwarded prefixes, so all nodes
+ * allocated and released since then are its nodes.
+ * @param[in, out] pf - a pointer to the PhoneForward structure;
+ * @param[in] usedNodes - the value of @p usedNodes of @p pf at that moment;
+ * @param[in] usedBytes - the value of @p usedBytes of @p pf at that moment.
+ */
+static void countTrieChange(PhoneForward *pf, size_t usedNodes, size_t usedBytes) {
+    // Differences are added modulo the size of size_t, so they can be negative.
+    pf->trieSize.nodes += pf->usedNodes - usedNodes;
+    pf->trieSize.bytes += pf->usedBytes - usedBytes;
+}
+
+/** Function frees a part of the removed subtrees.
+ * Nodes are freed after their children, in the order of removals. A forwarding of a freed node
+ * is removed from the reverse index, unless the same forwarding has been added again.
+ * @param[in, out] pf - a pointer to the PhoneForward structure;
+ * @param[in] nodes - the maximal number of freed nodes.
+ */
+static void reclaimRemoved(PhoneForward *pf, size_t nodes) {
+    char localTarget[WALK_LOCAL_PATH];
+    char *target = localTarget;
+    size_t targetSize = WALK_LOCAL_PATH;
+    while (pf->removed != NULL && nodes > 0) {
+        RemovedSubtree *subtree = pf->removed;
+        TrieWalk *walk = &subtree->walk;
+        NodeId id = walkNext(walk);
+        if (id == POOL_NONE && walk->failed) {
+            // The walk is continued by the next write.
+            walk->failed = false;
+            break;
+        }
+        if (id == POOL_NONE) {
+            pf->removed = subtree->next;
+            if (pf->removed == NULL) {
+                pf->removedLast = NULL;
+            }
+            walkDestroy(walk);
+            free(subtree);
+            continue;
+        }
+
+        Node *node = nodeAt(pf, id);
+        uint32_t forward = node->forward;
+        if (forward != POOL_NONE && findForward(pf, pf->root, walk->digits, walk->length) != forward) {
+            size_t length = forwardLength(pf, forward);
+            if (reserveChars(&target, &targetSize, localTarget, 0, length + 1)) {
+                copyForward(pf, forward, target);
+                removeSource(pf, target, length, walk->digits, walk->length);
+            }
+        }
+        size_t usedNodes = pf->usedNodes, usedBytes = pf->usedBytes;
+        freeChildArray(pf, node);
+        release(pf, &pf->nodes, id);
+        countTrieChange(pf, usedNodes, usedBytes);
+        pf->trieSize.rules -= forward != POOL_NONE;
+        releaseTarget(pf, forward);
+        nodes--;
+    }
+    if (target != localTarget) {
+        free(target);
+    }
+}
+
+/** Function copies a forwarding to a new string.
+ * @param[in] pf - a pointer to the structure owning the forwarding;
+ * @param[in] forward - the index of the first chunk of the forwarding.
+ * @return A pointer to the allocated string or NULL if failed to allocate memory.
+ */
+static char *newForwardString(PhoneForward const *pf, uint32_t forward) {
+    char *num = malloc((forwardLength(pf, forward) + 1) * sizeof(char));
+    if (num != NULL) {
+        copyForward(pf, forward, num);
+    }
+    return num;
+}
+
+/** Function adds a forwarding.
+ * Function adds the forwarding to both tries and removes the replaced one from the reverse index.
+ * @param[in, out] pf - a pointer to the PhoneForward structure;
+ * @param[in] num1 - a pointer to the correct forwarded prefix;
+ * @param[in] num1Size - the number of digits in @p num1;
+ * @param[in] num2 - a pointer to the correct new prefix;
+ * @param[in] num2Size - the number of digits in @p num2.
+ * @return Value @p false if failed to allocate memory. Otherwise @p true.
+ */
+static bool addForwarding(PhoneForward *pf, char const *num1, size_t num1Size, char const *num2, size_t num2Size) {
+    touchPath(pf, num1, num1Size);
+    size_t usedNodes = pf->usedNodes, usedBytes = pf->usedBytes;
+    NodeId id = insertNumber(pf, &pf->root, num1, num1Size);
+    countTrieChange(pf, usedNodes, usedBytes);
+    if (id == POOL_NONE) {
+        return false;
+    }
+    char *oldForward = NULL;
+    size_t oldForwardSize = 0;
+    if (nodeAt(pf, id)->forward != POOL_NONE) {
+        oldForward = newForwardString(pf, nodeAt(pf, id)->forward);
+        if (oldForward == NULL) {
+            return false;
+        }
+        oldForwardSize = forwardLength(pf, nodeAt(pf, id)->forward);
+        if (oldForwardSize == num2Size && memcmp(oldForward, num2, num2Size) == 0) {
+            free(oldForward);
+            return true;
+        }
+    }
+
+    if (!addSource(pf, num2, num2Size, num1, num1Size)) {
+        free(oldForward);
+        return false;
+    }
+    if (!mark(pf, nodeAt(pf, id), num2, num2Size)) {
+        removeSource(pf, num2, num2Size, num1, num1Size);
+        free(oldForward);
+        return false;
+    }
+    if (oldForward != NULL) {
+        removeSource(pf, oldForward, oldForwardSize, num1, num1Size);
+        free(oldForward);
+    } else {
+        pf->trieSize.rules++;
+    }
+    return true;
+}
+
+bool phfwdAdd(PhoneForward *pf, char const *num1, char const *num2) {
+    // The digits are not used by adding, so they are not packed.
+    PhoneNumberView view1 = {num1, numberLength(num1), NULL};
+    PhoneNumberView view2 = {num2, numberLength(num2), NULL};
+    return phfwdAddView(pf, &view1, &view2);
+}
+
+bool phfwdAddView(PhoneForward *pf, PhoneNumberView const *num1, PhoneNumberView const *num2) {
+    if (pf == NULL || pf->origin != NULL || num1 == NULL || num2 == NULL) {
+        return false;
+    }
+
+    // Function returns false if any of the numbers ([num1], [num2]) is incorrect,
+    // or if they are the same number.
+    if (num1->length == 0 || num2->length == 0
+        || (num1->length == num2->length && memcmp(num1->num, num2->num, num1->length) == 0)) {
+        return false;
+    }
+
+    writeBegin(pf);
+    bool added = ownPools(pf) && addForwarding(pf, num1->num, num1->length, num2->num, num2->length);
+    if (added && pf->journal != NULL) {
+        journalAppend(pf->journal, JOURNAL_ADD, num1->num, num1->length, num2->num, num2->length);
+    }
+    reclaimRemoved(pf, REMOVED_NODES_PER_WRITE);
+    writeEnd(pf);
+    return added;
+}
+
+/** Function builds the trie and the reverse index of an empty structure.
+ * Function stores the targets of the forwardings and builds the tries by @ref bulkBuild.
+ * @param[in, out] pf - a pointer to the PhoneForward structure with empty roots;
+ * @param[in] keys - a pointer to the sorted keys of different @p num1 of the forwardings;
+ * @param[in] count - the number of forwardings, at least 1.
+ * @return Value @p false if failed to allocate memory, then @p pf stores no forwardings.
+ * Otherwise @p true.
+ */
+static bool buildBulk(PhoneForward *pf, BulkKey *keys, size_t count) {
+    size_t interned = 0;
+    while (interned < count) {
+        BulkRule *rule = keys[interned].rule;
+        rule->forward = internTarget(pf, rule->num2, rule->num2Size);
+        if (rule->forward == POOL_NONE) {
+            break;
+        }
+        interned++;
+    }
+    bool built = interned == count;
+    if (built) {
+        // In copying mode the new nodes are published with the roots.
+        BulkTrie trie = {&pf->nodes, &pf->smallArrays, &pf->digitArrays, ownNode(pf, &pf->root), POOL_NONE,
+                         pf->copying};
+        trie.reverseRoot = trie.root != POOL_NONE ? ownNode(pf, &pf->reverseRoot) : POOL_NONE;
+        BulkSize size;
+        built = trie.reverseRoot != POOL_NONE && bulkBuild(&trie, keys, count, &size);
+        if (built) {
+            pf->trieSize.nodes += size.nodes;
+            pf->trieSize.rules += count;
+            pf->trieSize.bytes += size.bytes;
+            pf->usedNodes += size.allNodes;
+            pf->usedBytes += size.allBytes;
+        }
+    }
+    if (!built) {
+        for (size_t i = 0; i < interned; i++) {
+            releaseTarget(pf, keys[i].rule->forward);
+        }
+    }
+    return built;
+}
+
+bool phfwdAddBulk(PhoneForward *pf, PhoneForwardRule const *rules, size_t count) {
+    if (pf == NULL || pf->origin != NULL || (rules == NULL && count > 0)) {
+        return false;
+    }
+    BulkRule *bulk = malloc((count > 0 ? count : 1) * sizeof(BulkRule));
+    BulkKey *keys = malloc((count > 0 ? count : 1) * sizeof(BulkKey));
+    if (bulk == NULL || keys == NULL) {
+        free(bulk);
+        free(keys);
+        return false;
+    }
+
+    // Incorrect forwardings are skipped, as phfwdAdd does not add them.
+    size_t size = 0;
+    bool sorted = true;
+    for (size_t i = 0; i < count; i++) {
+        BulkRule rule = {rules[i].num1, rules[i].num2, numberLength(rules[i].num1), numberLength(rules[i].num2),
+                         POOL_NONE};
+        if (rule.num1Size == 0 || rule.num2Size == 0
+            || (rule.num1Size == rule.num2Size && memcmp(rule.num1, rule.num2, rule.num1Size) == 0)) {
+            continue;
+        }
+        bulk[size] = rule;
+        bulkInitKey(&keys[size], rule.num1, rule.num1Size, &bulk[size]);
+        sorted = sorted && (size == 0 || bulkCompare(&keys[size - 1], &keys[size]) <= 0);
+        size++;
+    }
+    if (!sorted && !bulkSort(keys, size)) {
+        free(bulk);
+        free(keys);
+        return false;
+    }
+    // The sort is stable, so only the last forwarding of a number stays, as it replaces the earlier ones.
+    size_t unique = 0;
+    for (size_t i = 0; i < size; i++) {
+        if (i + 1 == size || bulkCompare(&keys[i], &keys[i + 1]) != 0) {
+            keys[unique++] = keys[i];
+        }
+    }
+
+    writeBegin(pf);
+    size_t added = 0;
+    if (unique > 0 && ownPools(pf)) {
+        if (nodeAt(pf, pf->root)->numberOfNextDigits == 0 && nodeAt(pf, pf->reverseRoot)->numberOfNextDigits == 0) {
+            added = buildBulk(pf, keys, unique) ? unique : 0;
+            if (pf->cache != NULL) {
+                cacheClear(pf->cache);
+            }
+        } else {
+            // Sorted numbers share paths with the previous ones, which are still in the cache.
+            while (added < unique && addForwarding(pf, keys[added].rule->num1, keys[added].rule->num1Size,
+                                                   keys[added].rule->num2, keys[added].rule->num2Size)) {
+                added++;
+            }
+        }
+    }
+    for (size_t i = 0; i < added && pf->journal != NULL; i++) {
+        BulkRule const *rule = keys[i].rule;
+        journalAppend(pf->journal, JOURNAL_ADD, rule->num1, rule->num1Size, rule->num2, rule->num2Size);
+    }
+    reclaimRemoved(pf, REMOVED_NODES_PER_WRITE);
+    writeEnd(pf);
+    free(bulk);
+    free(keys);
+    return added == unique;
+}
+
+void phfwdRemove(PhoneForward *pf, char const *num) {
+    PhoneNumberView view = {num, numberLength(num), NULL};
+    phfwdRemoveView(pf, &view);
+}
+
+/** Function removes forwardings of all numbers with a given prefix.
+ * Function only detaches the subtree of the prefix, in time proportional to its length.
+ * The subtree is freed and its forwardings are removed from the reverse index by
+ * @ref reclaimRemoved during later writes.
+ * @param[in, out] pf - a pointer to the PhoneForward structure;
+ * @param[in] num - a pointer to the prefix;
+ * @param[in] numSize - the number of digits in @p num.
+ * @return Value @p true if any forwarding has been removed. Otherwise @p false.
+ */
+static bool removeForwarding(PhoneForward *pf, char const *num, size_t numSize) {
+    // The removed subtree starts in the node whose label contains the last digit of [num].
+    size_t pathSize, end;
+    bool removed = false;
+    NodeId *path = findPath(pf, pf->root, num, numSize, &pathSize, &end);
+    if (path != NULL && end >= numSize) {
+        NodeId id = path[pathSize - 1];
+        RemovedSubtree *subtree = malloc(sizeof(RemovedSubtree));
+        if (subtree != NULL) {
+            subtree->next = NULL;
+            walkInit(&subtree->walk, pf, id, num, end - nodeAt(pf, id)->labelLength, true);
+        }
+        // The detached subtree is counted until its nodes are freed by reclaimRemoved.
+        size_t usedNodes = pf->usedNodes, usedBytes = pf->usedBytes;
+        if (subtree != NULL && !subtree->walk.failed && ownPath(pf, &pf->root, path, pathSize - 1)) {
+            removeChild(pf, nodeAt(pf, path[pathSize - 2]), labelDigit(nodeAt(pf, id), 0));
+            pruneNodes(pf, path, pathSize - 1);
+            if (pf->removedLast != NULL) {
+                pf->removedLast->next = subtree;
+            } else {
+                pf->removed = subtree;
+            }
+            pf->removedLast = subtree;
+            removed = true;
+        } else if (subtree != NULL) {
+            walkDestroy(&subtree->walk);
+            free(subtree);
+        }
+        countTrieChange(pf, usedNodes, usedBytes);
+    }
+    free(path);
+    touchPath(pf, num, numSize);
+    return removed;
+}
+
+void phfwdRemoveView(PhoneForward *pf, PhoneNumberView const *num) {
+    if (pf == NULL || pf->origin != NULL || num == NULL || num->length == 0) {
+        return;
+    }
+
+    writeBegin(pf);
+    if (ownPools(pf) && removeForwarding(pf, num->num, num->length) && pf->journal != NULL) {
+        journalAppend(pf->journal, JOURNAL_REMOVE, num->num, num->length, NULL, 0);
+    }
+    reclaimRemoved(pf, REMOVED_NODES_PER_WRITE);
+    writeEnd(pf);
+}
+
+bool phfwdReclaim(PhoneForward *pf, size_t nodes) {
+    if (pf == NULL || pf->origin != NULL) {
+        return false;
+    }
+    writeBegin(pf);
+    reclaimRemoved(pf, nodes);
+    bool pending = pf->removed != NULL;
+    writeEnd(pf);
+    return pending;
+}
+
+/** Function marks that a PhoneNumbers structure could not be completed.
+ * Function frees the positions of the numbers and sets @p numbers to NULL, then
+ * next calls of @ref addPhoneNumber do nothing.
+ * @param[in, out] pn - a pointer to the PhoneNumbers structure.
+ */
+static void failPhoneNumbers(PhoneNumbers *pn) {
+    free(pn->numbers);
+    pn->numbers = NULL;
+    pn->numbersCount = 0;
+}
+
+/** Function adds a number to PhoneNumbers.
+ * Function packs the number @p num at the end of the digits of @p pn, reallocating
+ * its arrays if needed. If it fails to allocate memory, @ref failPhoneNumbers is called.
+ * @param[in, out] pn - a pointer to the PhoneNumbers structure;
+ * @param[in] num - a pointer to the number to be added;
+ * @param[in] numSize - the number of digits of @p num, 0 if the number is incorrect.
+ */
+static void addPhoneNumber(PhoneNumbers *pn, char const *num, size_t numSize) {
+    if (pn == NULL || pn->numbers == NULL) {
+        return;
+    }
+    if (pn->numbersCount == pn->numbersSize) {
+        NumberEntry *numbers = realloc(pn->numbers, 2 * pn->numbersSize * sizeof(NumberEntry));
+        if (numbers == NULL) {
+            failPhoneNumbers(pn);
+            return;
+        }
+        pn->numbers = numbers;
+        pn->numbersSize *= 2;
+    }
+    size_t size = packedSize(numSize);
+    if (pn->digitsCount + size > pn->digitsSize) {
+        size_t digitsSize = pn->digitsSize == 0 ? INITIAL_DIGITS_SIZE : 2 * pn->digitsSize;
+        while (digitsSize < pn->digitsCount + size) {
+            digitsSize *= 2;
+        }
+        uint8_t *digits = realloc(pn->digits, digitsSize);
+        if (digits == NULL) {
+            failPhoneNumbers(pn);
+            return;
+        }
+        pn->digits = digits;
+        pn->digitsSize = digitsSize;
+    }
+
+    NumberEntry *entry = &pn->numbers[pn->numbersCount++];
+    entry->offset = pn->digitsCount;
+    entry->length = numSize;
+    if (numSize != 0) {
+        packNumber(num, numSize, pn->digits + pn->digitsCount);
+        pn->digitsCount += size;
+    }
+}
+
+/** Function finds the longest prefix of @p num that has a redirection.
+ * Function traverses the @p PhoneForward structure and remembers only the deepest node
+ * with a forwarding on the path of @p num.
+ * @param[in] pf - a pointer to the PhoneForward structure;
+ * @param[in] root - the root of the read version of the trie;
+ * @param[in] digits - a pointer to the number packed by @ref packNumber, followed by
+ * @ref PACKED_PADDING bytes;
+ * @param[in] numSize - the number of digits of the number;
+ * @param[out] prefixSize - the length of the longest forwarded prefix.
+ * @return The node ending the longest forwarded prefix or @ref POOL_NONE if no prefix is forwarded.
+ */
+static NodeId findPrefix(PhoneForward const *pf, NodeId root, uint8_t const *digits, size_t numSize,
+                         size_t *prefixSize) {
+    NodeId forwarded = POOL_NONE;
+    *prefixSize = 0;
+
+    Node const *node = nodeAt(pf, root);
+    size_t i = 0;
+    while (i < numSize) {
+        NodeId child = getChild(pf, node, packedDigit(digits, i));
+        if (child == POOL_NONE) {
+            break;
+        }
+        node = nodeAt(pf, child);
+        if (matchPacked(node, digits, i, numSize) < node->labelLength) {
+            break;
+        }
+        i += node->labelLength;
+
+        if (node->forward != POOL_NONE) {
+            forwarded = child;
+            *prefixSize = i;
+        }
+    }
+    return forwarded;
+}
+
+/** Function adds a node to the nodes on which a cached result depends.
+ * Does nothing if the node is already in @p path.
+ * @param[in, out] path - an array of @ref CACHE_PATH_SIZE nodes;
+ * @param[in, out] pathSize - a pointer to the number of nodes of @p path, it is set to
+ * @ref CACHE_PATH_SIZE + 1 if they do not fit, then nodes are not added;
+ * @param[in] id - the index of the node.
+ */
+static void addPathNode(NodeId *path, size_t *pathSize, NodeId id) {
+    if (*pathSize > CACHE_PATH_SIZE) {
+        return;
+    }
+    for (size_t i = 0; i < *pathSize; i++) {
+        if (path[i] == id) {
+            return;
+        }
+    }
+    if (*pathSize == CACHE_PATH_SIZE) {
+        (*pathSize)++;
+        return;
+    }
+    path[(*pathSize)++] = id;
+}
+
+/** Function finds the longest prefix of @p num that has a redirection and the nodes it depends on.
+ * Works like @ref findPrefix and adds the nodes it passes to @p path, as a change of the
+ * forwarding of the number changes one of them. They include the node where the search stopped,
+ * which also changes when a number starting with @p num gets a longer forwarded prefix.
+ * @param[in] pf - a pointer to the PhoneForward structure;
+ * @param[in] root - the root of the read version of the trie;
+ * @param[in] digits - a pointer to the number packed by @ref packNumber, followed by
+ * @ref PACKED_PADDING bytes;
+ * @param[in] numSize - the number of digits of the number;
+ * @param[out] prefixSize - the length of the longest forwarded prefix;
+ * @param[in, out] path - an array of @ref CACHE_PATH_SIZE nodes;
+ * @param[in, out] pathSize - a pointer to the number of nodes of @p path, see @ref addPathNode;
+ * @param[out] open - a pointer to a boolean informing if the search reached the end of the number
+ * with nodes below, so a number with more digits could have a longer forwarded prefix, or NULL.
+ * @return The node ending the longest forwarded prefix or @ref POOL_NONE if no prefix is forwarded.
+ */
+static NodeId findPrefixPath(PhoneForward const *pf, NodeId root, uint8_t const *digits, size_t numSize,
+                             size_t *prefixSize, NodeId *path, size_t *pathSize, bool *open) {
+    NodeId forwarded = POOL_NONE;
+    *prefixSize = 0;
+    addPathNode(path, pathSize, root);
+
+    Node const *node = nodeAt(pf, root);
+    size_t i = 0;
+    bool ended = node->numberOfNextDigits > 0;
+    while (i < numSize) {
+        NodeId child = getChild(pf, node, packedDigit(digits, i));
+        if (child == POOL_NONE) {
+            ended = false;
+            break;
+        }
+        node = nodeAt(pf, child);
+        size_t matched = matchPacked(node, digits, i, numSize);
+        if (matched < node->labelLength) {
+            ended = i + matched == numSize;
+            break;
+        }
+        i += node->labelLength;
+        addPathNode(path, pathSize, child);
+
+        if (node->forward != POOL_NONE) {
+            forwarded = child;
+            *prefixSize = i;
+        }
+        ended = node->numberOfNextDigits > 0;
+    }
+    if (open != NULL) {
+        *open = ended;
+    }
+    return forwarded;
+}
+
+/** Function writes the forwarded number.
+ * Function merges the forwarding of the prefix found by @ref findPrefix with the rest of
+ * the number @p num.
+ * @param[in] pf - a pointer to the PhoneForward structure;
+ * @param[in] num - a pointer to the number;
+ * @param[in] numSize - the number of digits in @p num;
+ * @param[in] forwarded - the node ending the longest forwarded prefix or @ref POOL_NONE;
+ * @param[in] prefixSize - the length of the longest forwarded prefix;
+ * @param[out] newNumber - a pointer to the array which fits the forwarded number and '\0'.
+ */
+static void mergePrefNum(PhoneForward const *pf, char const *num, size_t numSize, NodeId forwarded,
+                         size_t prefixSize, char *newNumber) {
+    if (forwarded != POOL_NONE) {
+        uint32_t forward = nodeAt(pf, forwarded)->forward;
+        copyForward(pf, forward, newNumber);
+        newNumber += forwardLength(pf, forward);
+    }
+    memcpy(newNumber, num + prefixSize, (numSize - prefixSize) * sizeof(char));
+    newNumber[numSize - prefixSize] = '\0';
+}
+
+/** Function calculates the length of the forwarded number.
+ * @param[in] pf - a pointer to the PhoneForward structure;
+ * @param[in] numSize - the number of digits in the number;
+ * @param[in] forwarded - the node ending the longest forwarded prefix or @ref POOL_NONE;
+ * @param[in] prefixSize - the length of the longest forwarded prefix.
+ * @return The number of digits of the forwarded number.
+ */
+static size_t forwardedLength(PhoneForward const *pf, size_t numSize, NodeId forwarded, size_t prefixSize) {
+    if (forwarded == POOL_NONE) {
+        return numSize;
+    }
+    return forwardLength(pf, nodeAt(pf, forwarded)->forward) + numSize - prefixSize;
+}
+
+/** Function checks if results are cached.
+ * Results are not cached while nodes are copied, as changes replace the nodes of their paths.
+ * @param[in] pf - a pointer to the PhoneForward structure.
+ * @return Value @p true if the cache is used. Otherwise @p false.
+ */
+static bool isCaching(PhoneForward const *pf) {
+    return pf->cache != NULL && !pf->copying;
+}
+
+/** Function finds a cached result of a number.
+ * @param[in] pf - a pointer to the PhoneForward structure;
+ * @param[in] kind - @ref RESULT_FORWARD, @ref RESULT_RESOLVE or @ref RESULT_RESOLVE_NUMBER;
+ * @param[in] num - a pointer to the view of the number.
+ * @return A pointer to the entry of the cache or NULL if the result is not cached.
+ */
+static CacheEntry const *findCached(PhoneForward const *pf, uint8_t kind, PhoneNumberView const *num) {
+    return isCaching(pf) ? cacheFind(pf->cache, kind, num->num, num->length) : NULL;
+}
+
+/** Function stores the forwarding of a number in the cache.
+ * Does nothing if results are not cached.
+ * @param[in] pf - a pointer to the PhoneForward structure;
+ * @param[in] num - a pointer to the view of the number, whose result is not cached;
+ * @param[in] newNumber - a pointer to the forwarded number;
+ * @param[in] newNumberSize - the number of digits in @p newNumber;
+ * @param[in] path - an array of nodes found by @ref findPrefixPath;
+ * @param[in] pathSize - the number of nodes of @p path.
+ */
+static void cacheForwarded(PhoneForward const *pf, PhoneNumberView const *num, char const *newNumber,
+                           size_t newNumberSize, NodeId const *path, size_t pathSize) {
+    if (isCaching(pf)) {
+        cacheInsert(pf->cache, RESULT_FORWARD, num->num, num->length, newNumber, newNumberSize, path, pathSize);
+    }
+}
+
+PhoneNumbers *phfwdGet(PhoneForward const *pf, char const *num) {
+    uint8_t local[LOCAL_DIGITS_SIZE];
+    PhoneNumberView view;
+    if (pf == NULL || !initView(&view, num, local, sizeof(local))) {
+        return NULL;
+    }
+    PhoneNumbers *pnum = phfwdGetView(pf, &view);
+    freeView(&view, local);
+    return pnum;
+}
+
+PhoneNumbers *phfwdGetView(PhoneForward const *pf, PhoneNumberView const *num) {
+    if (pf == NULL) {
+        return NULL;
+    }
+
+    PhoneNumbers *pnum = pnumNew(1, 0);
+    if (pnum == NULL) {
+        return NULL;
+    }
+    if (num == NULL || num->length == 0) {
+        addPhoneNumber(pnum, NULL, 0);
+        return pnum;
+    }
+
+    // The forwarded number is written directly to the result.
+    size_t newNumberSize;
+    char *newNumber;
+    CacheEntry const *cached = findCached(pf, RESULT_FORWARD, num);
+    if (cached != NULL) {
+        newNumberSize = cached->valueLength;
+        newNumber = malloc((newNumberSize + 1) * sizeof(char));
+        if (newNumber != NULL) {
+            memcpy(newNumber, cacheValue(cached), newNumberSize * sizeof(char));
+            newNumber[newNumberSize] = '\0';
+        }
+    } else {
+        NodeId path[CACHE_PATH_SIZE];
+        size_t pathSize = isCaching(pf) ? 0 : CACHE_PATH_SIZE + 1;
+        Version version = readBegin(pf);
+        size_t prefixSize;
+        NodeId forwarded = findPrefixPath(version.owner, version.root, num->digits, num->length, &prefixSize,
+                                          path, &pathSize, NULL);
+        newNumberSize = forwardedLength(version.owner, num->length, forwarded, prefixSize);
+        newNumber = malloc((newNumberSize + 1) * sizeof(char));
+        if (newNumber != NULL) {
+            mergePrefNum(version.owner, num->num, num->length, forwarded, prefixSize, newNumber);
+            cacheForwarded(pf, num, newNumber, newNumberSize, path, pathSize);
+        }
+        readEnd(&version);
+    }
+    if (newNumber == NULL) {
+        phnumDelete(pnum);
+        return NULL;
+    }
+    // The number is returned by phnumGet, so it is stored as characters at once.
+    pnum->strings = newNumber;
+    pnum->numbers[0].offset = 0;
+    pnum->numbers[0].length = newNumberSize;
+    pnum->numbersCount = 1;
+
+    return pnum;
+}
+
+bool phfwdGetInto(PhoneForward const *pf, char const *num, char *buf, size_t cap, size_t *len) {
+    uint8_t local[LOCAL_DIGITS_SIZE];
+    PhoneNumberView view;
+    if (!initView(&view, num, local, sizeof(local))) {
+        view.length = 0;
+        view.digits = local;
+    }
+    bool written = phfwdGetIntoView(pf, &view, buf, cap, len);
+    freeView(&view, local);
+    return written;
+}
+
+bool phfwdGetIntoView(PhoneForward const *pf, PhoneNumberView const *num, char *buf, size_t cap, size_t *len) {
+    size_t newNumberSize = 0;
+    bool written = false;
+
+    CacheEntry const *cached = NULL;
+    if (pf != NULL && num != NULL && num->length != 0) {
+        cached = findCached(pf, RESULT_FORWARD, num);
+    }
+    if (cached != NULL) {
+        newNumberSize = cached->valueLength;
+        if (buf != NULL && newNumberSize < cap) {
+            memcpy(buf, cacheValue(cached), newNumberSize * sizeof(char));
+            buf[newNumberSize] = '\0';
+            written = true;
+        }
+    } else if (pf != NULL && num != NULL && num->length != 0) {
+        NodeId path[CACHE_PATH_SIZE];
+        size_t pathSize = isCaching(pf) ? 0 : CACHE_PATH_SIZE + 1;
+        Version version = readBegin(pf);
+        size_t prefixSize;
+        NodeId forwarded = findPrefixPath(version.owner, version.root, num->digits, num->length, &prefixSize,
+                                          path, &pathSize, NULL);
+        newNumberSize = forwardedLength(version.owner, num->length, forwarded, prefixSize);
+        if (buf != NULL && newNumberSize < cap) {
+            mergePrefNum(version.owner, num->num, num->length, forwarded, prefixSize, buf);
+            cacheForwarded(pf, num, buf, newNumberSize, path, pathSize);
+            written = true;
+        }
+        readEnd(&version);
+    }
+
+    if (len != NULL) {
+        *len = newNumberSize;
+    }
+    return written;
+}
+
+/** Function starts a chain of forwardings.
+ * @param[out] chain - a pointer to the chain;
+ * @param[in] num - a pointer to the view of the first number;
+ * @param[in] caching - a boolean informing if nodes passed by the chain are collected for the cache;
+ * @param[in] prefix - a boolean informing if @p num is a forwarded prefix of longer numbers,
+ * then the chain stops when it depends on the digits following the prefix.
+ * @return Value @p false if failed to allocate memory, then the chain still has to be
+ * destroyed with @ref chainDestroy. Otherwise @p true.
+ */
+static bool chainInit(Chain *chain, PhoneNumberView const *num, bool caching, bool prefix) {
+    chain->num = chain->localNum;
+    chain->numSize = CHAIN_LOCAL_SIZE;
+    chain->next = chain->localNext;
+    chain->nextSize = CHAIN_LOCAL_SIZE;
+    chain->saved = chain->localSaved;
+    chain->savedSize = CHAIN_LOCAL_SIZE;
+    chain->length = num->length;
+    chain->savedLength = num->length;
+    chain->hops = 0;
+    chain->sinceSaved = 0;
+    chain->power = 1;
+    chain->cycle = false;
+    chain->prefix = prefix;
+    chain->open = false;
+    chain->pathSize = caching ? 0 : CACHE_PATH_SIZE + 1;
+    if (!reserveChars(&chain->num, &chain->numSize, chain->localNum, 0, num->length + 1)
+        || !reserveChars(&chain->saved, &chain->savedSize, chain->localSaved, 0, num->length + 1)) {
+        return false;
+    }
+    memcpy(chain->num, num->num, num->length * sizeof(char));
+    chain->num[num->length] = '\0';
+    memcpy(chain->saved, chain->num, (num->length + 1) * sizeof(char));
+    return true;
+}
+
+/** Function frees the memory of a chain of forwardings.
+ * @param[in, out] chain - a pointer to the chain.
+ */
+static void chainDestroy(Chain *chain) {
+    if (chain->num != chain->localNum) {
+        free(chain->num);
+    }
+    if (chain->next != chain->localNext) {
+        free(chain->next);
+    }
+    if (chain->saved != chain->localSaved) {
+        free(chain->saved);
+    }
+}
+
+/** Function forwards the current number of a chain once.
+ * @param[in] pf - a pointer to the PhoneForward structure;
+ * @param[in] root - the root of the read version of the trie;
+ * @param[in, out] chain - a pointer to the chain;
+ * @param[out] moved - a pointer to a boolean informing if the number has been forwarded.
+ * @return Value @p false if failed to allocate memory. Otherwise @p true.
+ */
+static bool chainStep(PhoneForward const *pf, NodeId root, Chain *chain, bool *moved) {
+    uint8_t local[LOCAL_DIGITS_SIZE];
+    PhoneNumberView view;
+    if (!initView(&view, chain->num, local, sizeof(local))) {
+        return false;
+    }
+    size_t prefixSize;
+    bool open;
+    NodeId forwarded = findPrefixPath(pf, root, view.digits, view.length, &prefixSize, chain->path,
+                                      &chain->pathSize, &open);
+    // The first number is the prefix itself, its longest forwarded prefix, whatever digits follow.
+    chain->open = chain->prefix && chain->hops > 0 && open;
+    size_t length = forwardedLength(pf, view.length, forwarded, prefixSize);
+    *moved = forwarded != POOL_NONE;
+    bool reserved = !*moved || reserveChars(&chain->next, &chain->nextSize, chain->localNext, 0, length + 1);
+    if (*moved && reserved) {
+        mergePrefNum(pf, chain->num, view.length, forwarded, prefixSize, chain->next);
+    }
+    freeView(&view, local);
+    if (!*moved || !reserved) {
+        return reserved;
+    }
+
+    if (chain->sinceSaved == chain->power) {
+        if (!reserveChars(&chain->saved, &chain->savedSize, chain->localSaved, 0, chain->length + 1)) {
+            return false;
+        }
+        memcpy(chain->saved, chain->num, (chain->length + 1) * sizeof(char));
+        chain->savedLength = chain->length;
+        chain->power *= 2;
+        chain->sinceSaved = 0;
+    }
+    if (!reserveChars(&chain->num, &chain->numSize, chain->localNum, 0, length + 1)) {
+        return false;
+    }
+    memcpy(chain->num, chain->next, (length + 1) * sizeof(char));
+    chain->length = length;
+    chain->hops++;
+    chain->sinceSaved++;
+    chain->cycle = length == chain->savedLength && memcmp(chain->num, chain->saved, length) == 0;
+    return true;
+}
+
+/** Function resolves a number by the chain of its prefix, which is cached.
+ * The result is the last number of the chain of the prefix followed by the rest of the number,
+ * so it is correct for the number if the chain does not depend on the digits following the prefix.
+ * @param[in] pf - a pointer to the PhoneForward structure;
+ * @param[in] version - a pointer to the read version of the structure;
+ * @param[in] num - a pointer to the view of the number;
+ * @param[in] kind - @ref RESULT_RESOLVE for a prefix or @ref RESULT_RESOLVE_NUMBER for the whole number;
+ * @param[in] prefixSize - the length of the longest forwarded prefix of @p num for @ref RESULT_RESOLVE,
+ * otherwise the length of @p num;
+ * @param[in] maxHops - the maximal number of forwardings of the chain;
+ * @param[out] resolved - a pointer to the last number of the chain ended with '\0', which has to
+ * be freed, or NULL if the chain has no last number within @p maxHops forwardings;
+ * @param[out] resolvedSize - a pointer to the number of digits of @p resolved;
+ * @param[out] open - a pointer to a boolean informing if the chain of the prefix depends on
+ * the following digits, then @p num has to be resolved whole.
+ * @return Value @p false if failed to allocate memory. Otherwise @p true.
+ */
+static bool resolveChain(PhoneForward const *pf, Version const *version, PhoneNumberView const *num, uint8_t kind,
+                         size_t prefixSize, size_t maxHops, char **resolved, size_t *resolvedSize, bool *open) {
+    PhoneNumberView prefix = *num;
+    prefix.length = prefixSize;
+    size_t restSize = num->length - prefixSize;
+    *resolved = NULL;
+    *open = false;
+
+    // A cached chain is valid for every limit, as its number of forwardings is stored with it.
+    CacheEntry const *cached = findCached(pf, kind, &prefix);
+    if (cached != NULL) {
+        *open = cached->data == CHAIN_OPEN;
+        if (*open || cached->data == CHAIN_CYCLE || cached->data > maxHops) {
+            return true;
+        }
+        *resolvedSize = cached->valueLength + restSize;
+        *resolved = malloc((*resolvedSize + 1) * sizeof(char));
+        if (*resolved == NULL) {
+            return false;
+        }
+        memcpy(*resolved, cacheValue(cached), cached->valueLength * sizeof(char));
+    } else {
+        Chain chain;
+        bool caching = isCaching(pf);
+        bool moved = true;
+        bool failed = !chainInit(&chain, &prefix, caching, kind == RESULT_RESOLVE);
+        while (!failed && moved && !chain.cycle && !chain.open && chain.hops <= maxHops) {
+            failed = !chainStep(version->owner, version->root, &chain, &moved);
+        }
+        bool found = !failed && !moved && !chain.open;
+        *open = !failed && chain.open;
+        if (caching && (found || chain.cycle || *open) && chain.hops > 0 && chain.hops < CHAIN_OPEN) {
+            CacheEntry *entry = cacheInsert(pf->cache, kind, prefix.num, prefix.length, chain.num,
+                                            found ? chain.length : 0, chain.path, chain.pathSize);
+            if (entry != NULL) {
+                entry->data = found ? chain.hops : *open ? CHAIN_OPEN : CHAIN_CYCLE;
+            }
+        }
+        *resolvedSize = chain.length + restSize;
+        *resolved = found ? malloc((*resolvedSize + 1) * sizeof(char)) : NULL;
+        if (*resolved != NULL) {
+            memcpy(*resolved, chain.num, chain.length * sizeof(char));
+        }
+        chainDestroy(&chain);
+        if (failed || (found && *resolved == NULL)) {
+            return false;
+        }
+        if (!found) {
+            return true;
+        }
+    }
+    memcpy(*resolved + *resolvedSize - restSize, num->num + prefixSize, restSize * sizeof(char));
+    (*resolved)[*resolvedSize] = '\0';
+    return true;
+}
+
+PhoneNumbers *phfwdResolve(PhoneForward const *pf, char const *num, size_t maxHops) {
+    uint8_t local[LOCAL_DIGITS_SIZE];
+    PhoneNumberView view;
+    if (pf == NULL || !initView(&view, num, local, sizeof(local))) {
+        return NULL;
+    }
+    PhoneNumbers *pnum = phfwdResolveView(pf, &view, maxHops);
+    freeView(&view, local);
+    return pnum;
+}
+
+PhoneNumbers *phfwdResolveView(PhoneForward const *pf, PhoneNumberView const *num, size_t maxHops) {
+    if (pf == NULL) {
+        return NULL;
+    }
+
+    PhoneNumbers *pnum = pnumNew(1, 0);
+    if (pnum == NULL) {
+        return NULL;
+    }
+    if (num == NULL || num->length == 0) {
+        addPhoneNumber(pnum, NULL, 0);
+        return pnum;
+    }
+
+    // Numbers with the same longest forwarded prefix share the chain of the prefix, unless it
+    // depends on the digits following the prefix. Then the chain is cached for the whole number.
+    Version version = readBegin(pf);
+    size_t prefixSize = 0;
+    if (isCaching(pf)) {
+        findPrefix(version.owner, version.root, num->digits, num->length, &prefixSize);
+    }
+    char *resolved = NULL;
+    size_t resolvedSize = 0;
+    bool open = prefixSize == 0;
+    bool failed = !open && !resolveChain(pf, &version, num, RESULT_RESOLVE, prefixSize, maxHops, &resolved,
+                                         &resolvedSize, &open);
+    if (!failed && open) {
+        failed = !resolveChain(pf, &version, num, RESULT_RESOLVE_NUMBER, num->length, maxHops, &resolved,
+                               &resolvedSize, &open);
+    }
+    readEnd(&version);
+    if (failed) {
+        phnumDelete(pnum);
+        return NULL;
+    }
+    if (resolved == NULL) {
+        addPhoneNumber(pnum, NULL, 0);
+        return pnum;
+    }
+    pnum->strings = resolved;
+    pnum->numbers[0].offset = 0;
+    pnum->numbers[0].length = resolvedSize;
+    pnum->numbersCount = 1;
+
+    return pnum;
+}
+
+bool phfwdCacheEnable(PhoneForward *pf, size_t capacity) {
+    // Concurrent reads and snapshots can not change the cache of their structure.
+    if (pf == NULL || pf->concurrent || pf->origin != NULL) {
+        return false;
+    }
+    if (pf->cache != NULL) {
+        pf->cacheStats.hits += pf->cache->hits;
+        pf->cacheStats.misses += pf->cache->misses;
+        pf->cacheStats.evictions += pf->cache->evictions;
+        pf->cacheStats.invalidations += pf->cache->invalidations;
+        cacheDestroy(pf->cache);
+        free(pf->cache);
+        pf->cache = NULL;
+    }
+    if (capacity == 0) {
+        return true;
+    }
+
+    ResultCache *cache = malloc(sizeof(ResultCache));
+    if (cache == NULL || !cacheInit(cache, capacity)) {
+        free(cache);
+        return false;
+    }
+    pf->cache = cache;
+    return true;
+}
+
+bool phfwdCacheStats(PhoneForward const *pf, PhoneForwardCacheStats *stats) {
+    if (pf == NULL || stats == NULL) {
+        return false;
+    }
+    *stats = pf->cacheStats;
+    if (pf->cache != NULL) {
+        stats->hits += pf->cache->hits;
+        stats->misses += pf->cache->misses;
+        stats->evictions += pf->cache->evictions;
+        stats->invalidations += pf->cache->invalidations;
+        stats->entries = pf->cache->count;
+        stats->capacity = pf->cache->capacity;
+    }
+    return true;
+}
+
+/** Function starts resolving the next number of a stream.
+ * Function removes from the path of the previous number the nodes that do not lie
+ * on the common prefix of both numbers, so the walk continues from the deepest shared node.
+ * @param[in] root - the root of the read version of the trie;
+ * @param[in, out] stream - a pointer to the stream;
+ * @param[in] results - an array of the results of the batch storing its numbers.
+ */
+static void startNumber(NodeId root, BatchStream *stream, BatchResult const *results) {
+    char const *num = results[stream->current].num;
+    stream->numSize = results[stream->current].numSize;
+    size_t common = 0;
+    if (stream->previous != NULL) {
+        while (common < stream->numSize && stream->previous[common] == num[common]) {
+            common++;
+        }
+    }
+    while (stream->pathSize > 0 && stream->path[stream->pathSize - 1].depth > common) {
+        stream->pathSize--;
+    }
+
+    if (stream->pathSize == 0) {
+        stream->node = root;
+        stream->i = 0;
+        stream->forwarded = POOL_NONE;
+        stream->prefixSize = 0;
+    } else {
+        BatchStep const *step = &stream->path[stream->pathSize - 1];
+        stream->node = step->node;
+        stream->i = step->depth;
+        stream->forwarded = step->forwarded;
+        stream->prefixSize = step->prefixSize;
+    }
+    stream->child = POOL_NONE;
+}
+
+/** Function makes one step of the walk of a stream.
+ * In one step the stream either finds the next child and prefetches it, or matches the label
+ * of the child prefetched in the previous step and prefetches the array of its children.
+ * When the walk ends, the result is stored and the stream starts its next number.
+ * @param[in] pf - a pointer to the PhoneForward structure;
+ * @param[in] root - the root of the read version of the trie;
+ * @param[in, out] stream - a pointer to the stream;
+ * @param[in, out] results - an array of the results of the batch storing its numbers.
+ * @return Value @p false if the stream has resolved all its numbers. Otherwise @p true.
+ */
+static bool stepStream(PhoneForward const *pf, NodeId root, BatchStream *stream, BatchResult *results) {
+    char const *num = results[stream->current].num;
+    if (stream->i < stream->numSize) {
+        if (stream->child == POOL_NONE) {
+            stream->child = getChild(pf, nodeAt(pf, stream->node), charToDigit(num[stream->i]));
+            if (stream->child != POOL_NONE) {
+                __builtin_prefetch(nodeAt(pf, stream->child));
+                return true;
+            }
+        } else {
+            Node const *child = nodeAt(pf, stream->child);
+            if (matchLabel(child, num + stream->i, stream->numSize - stream->i) == child->labelLength) {
+                stream->i += child->labelLength;
+                stream->node = stream->child;
+                stream->child = POOL_NONE;
+                if (child->forward != POOL_NONE) {
+                    stream->forwarded = stream->node;
+                    stream->prefixSize = stream->i;
+                }
+                if (child->capacity > 1) {
+                    __builtin_prefetch(childArray(pf, child));
+                }
+                // Deeper nodes are not remembered, their numbers are just not shared.
+                if (stream->pathSize < BATCH_PATH_CAPACITY) {
+                    BatchStep step = {stream->node, stream->forwarded, stream->i, stream->prefixSize};
+                    stream->path[stream->pathSize++] = step;
+                }
+                return true;
+            }
+        }
+    }
+
+    results[stream->current].forwarded = stream->forwarded;
+    results[stream->current].prefixSize = stream->prefixSize;
+    if (stream->numSize != 0) {
+        stream->previous = num;
+    }
+    stream->current++;
+    if (stream->current == stream->end) {
+        return false;
+    }
+    startNumber(root, stream, results);
+    return true;
+}
+
+/** Function resolves a batch of numbers.
+ * Function implements @ref phfwdGetBatch for numbers already checked.
+ * @param[in] pf - a pointer to a structure that stores number redirections;
+ * @param[in, out] results - an array of @p count results storing the numbers and their lengths;
+ * @param[in] count - the number of numbers;
+ * @param[out] buf - a pointer to the buffer for the results;
+ * @param[in] cap - the size of @p buf in bytes;
+ * @param[out] offsets - an array of @p count positions of the results in @p buf;
+ * @param[out] len - a pointer to the number of bytes needed to store all results or NULL.
+ * @return Value @p true if all results have been written to @p buf. Otherwise @p false.
+ */
+static bool resolveBatch(PhoneForward const *pf, BatchResult *results, size_t count, char *buf, size_t cap,
+                         size_t *offsets, size_t *len) {
+    // Each stream resolves a contiguous part of the batch, so in a sorted batch
+    // its consecutive numbers share long prefixes.
+    Version version = readBegin(pf);
+    PhoneForward const *owner = version.owner;
+    BatchStream streams[BATCH_STREAMS];
+    size_t active = 0;
+    for (size_t k = 0; k < BATCH_STREAMS; k++) {
+        size_t begin = count * k / BATCH_STREAMS;
+        size_t end = count * (k + 1) / BATCH_STREAMS;
+        if (begin < end) {
+            BatchStream *stream = &streams[active++];
+            stream->current = begin;
+            stream->end = end;
+            stream->previous = NULL;
+            stream->pathSize = 0;
+            startNumber(version.root, stream, results);
+        }
+    }
+
+    // The walks are interleaved, so the nodes prefetched by one stream arrive
+    // while the other streams make their steps.
+    while (active > 0) {
+        for (size_t k = 0; k < active;) {
+            if (stepStream(owner, version.root, &streams[k], results)) {
+                k++;
+            } else {
+                streams[k] = streams[--active];
+            }
+        }
+    }
+
+    size_t size = 0;
+    for (size_t k = 0; k < count; k++) {
+        if (k + BATCH_PREFETCH_DISTANCE < count && results[k + BATCH_PREFETCH_DISTANCE].forwarded != POOL_NONE) {
+            Node const *node = nodeAt(owner, results[k + BATCH_PREFETCH_DISTANCE].forwarded);
+            __builtin_prefetch(targetAt(owner, node->forward));
+        }
+        size_t newNumberSize = 0;
+        if (results[k].numSize != 0) {
+            newNumberSize = forwardedLength(owner, results[k].numSize, results[k].forwarded, results[k].prefixSize);
+        }
+        offsets[k] = size;
+        if (size + newNumberSize < cap) {
+            if (results[k].numSize != 0) {
+                mergePrefNum(owner, results[k].num, results[k].numSize, results[k].forwarded,
+                             results[k].prefixSize, buf + size);
+            } else {
+                buf[size] = '\0';
+            }
+        }
+        size += newNumberSize + 1;
+    }
+    readEnd(&version);
+
+    if (len != NULL) {
+        *len = size;
+    }
+    return size <= cap;
+}
+
+bool phfwdGetBatch(PhoneForward const *pf, char const *const *nums, size_t count, char *buf, size_t cap,
+                   size_t *offsets, size_t *len) {
+    BatchResult *results = malloc(count * sizeof(BatchResult));
+    if (pf == NULL || nums == NULL || offsets == NULL || (results == NULL && count > 0)) {
+        free(results);
+        if (len != NULL) {
+            *len = 0;
+        }
+        return false;
+    }
+
+    for (size_t k = 0; k < count; k++) {
+        results[k].num = nums[k];
+        results[k].numSize = numberLength(nums[k]);
+    }
+    bool written = resolveBatch(pf, results, count, buf, cap, offsets, len);
+    free(results);
+    return written;
+}
+
+bool phfwdGetBatchView(PhoneForward const *pf, PhoneNumberView const *const *nums, size_t count, char *buf,
+                       size_t cap, size_t *offsets, size_t *len) {
+    BatchResult *results = malloc(count * sizeof(BatchResult));
+    if (pf == NULL || nums == NULL || offsets == NULL || (results == NULL && count > 0)) {
+        free(results);
+        if (len != NULL) {
+            *len = 0;
+        }
+        return false;
+    }
+
+    for (size_t k = 0; k < count; k++) {
+        results[k].num = nums[k] == NULL ? NULL : nums[k]->num;
+        results[k].numSize = nums[k] == NULL ? 0 : nums[k]->length;
+    }
+    bool written = resolveBatch(pf, results, count, buf, cap, offsets, len);
+    free(results);
+    return written;
+}
+
+/** Function compares two numbers of a sequence. Returns positive integer if the first number is larger,
+ * negative if smaller, and 0 if they are equal.
+ * @param[in] pnum - a pointer to the PhoneNumbers structure storing the numbers;
+ * @param[in] a - a pointer to the position of the first number;
+ * @param[in] b - a pointer to the position of the second number;
+ * @return Positive integer if @p a > @p b, negative if @p a < @p b, 0 otherwise.
+ */
+static inline int compareNumbers(PhoneNumbers const *pnum, NumberEntry const *a, NumberEntry const *b) {
+    return comparePacked(pnum->digits + a->offset, a->length, pnum->digits + b->offset, b->length);
+}
+
+/** Function compares the ends of the same number.
+ * @param[in] a - a pointer to the first end;
+ * @param[in] b - a pointer to the second end.
+ * @return Positive integer if @p a is lexicographically larger, negative if smaller, 0 otherwise.
+ */
+static int compareSuffixes(char const *a, char const *b) {
+    while (*a != '\0' && *a == *b) {
+        a++;
+        b++;
+    }
+    if (*a == '\0' || *b == '\0') {
+        return (*a != '\0') - (*b != '\0');
+    }
+    return compareDigits(*a, *b);
+}
+
+/** Function finds the place of a pending number among the children of a node.
+ * The pending number consists of the digits on the path to @p node followed by @p rest.
+ * Children are visited in the order of digits, so numbers sorted by these keys are added
+ * in the lexicographic order if each of them is added before the first child with a larger key.
+ * @param[in] pf - a pointer to the structure owning the node;
+ * @param[in] node - a pointer to the node;
+ * @param[in] rest - a pointer to the digits of the number following the path;
+ * @param[in] restSize - the number of digits of @p rest.
+ * @return Value 0 if @p rest is empty, so the number precedes all others. Otherwise, if @p d is
+ * the first digit of @p rest, 3 @p d + 1 if the number precedes the numbers in the subtree of
+ * the child @p d, 3 @p d + 2 if it is passed to this child, because it starts with its label,
+ * and 3 @p d + 3 if it follows them.
+ */
+static size_t pendingKey(PhoneForward const *pf, Node const *node, char const *rest, size_t restSize) {
+    if (restSize == 0) {
+        return 0;
+    }
+    int digit = charToDigit(rest[0]);
+    size_t key = 3 * (size_t) digit + 1;
+    NodeId child = getChild(pf, node, digit);
+    if (child == POOL_NONE) {
+        return key;
+    }
+
+    Node const *childNode = nodeAt(pf, child);
+    size_t match = matchLabel(childNode, rest, restSize);
+    if (match == childNode->labelLength) {
+        return key + 1;
+    }
+    if (match == restSize || charToDigit(rest[match]) < labelDigit(childNode, match)) {
+        return key;
+    }
+    return key + 2;
+}
+
+/** Function sorts pending numbers of a node by their keys.
+ * Numbers with the same key are sorted lexicographically. They are few, so they are
+ * sorted by insertion.
+ * @param[in, out] walk - a pointer to the state of @ref addSources;
+ * @param[in] first - the index of the first number to sort;
+ * @param[in] end - the index following the last number to sort.
+ */
+static void sortPending(SourceWalk *walk, size_t first, size_t end) {
+    for (size_t i = first + 1; i < end; i++) {
+        PendingSource pending = walk->pending[i];
+        size_t j = i;
+        while (j > first && (walk->pending[j - 1].key > pending.key
+                             || (walk->pending[j - 1].key == pending.key
+                                 && compareSuffixes(walk->suffix + walk->pending[j - 1].offset,
+                                                    walk->suffix + pending.offset) > 0))) {
+            walk->pending[j] = walk->pending[j - 1];
+            j--;
+        }
+        walk->pending[j] = pending;
+    }
+}
+
+/** Function visits a node of the trie of sources.
+ * Function writes the label of the node to the path, moves the numbers passed from its parent
+ * and the number ending at the node, if it is a source, to the pending numbers of the node
+ * and adds the node to the visited path.
+ * @param[in, out] walk - a pointer to the state of @ref addSources;
+ * @param[in] id - the index of the node;
+ * @param[in] depth - the number of digits on the path to the parent of the node;
+ * @param[in] passedFirst - the index of the first pending number passed from the parent;
+ * @param[in] passedEnd - the index following the last pending number passed from the parent.
+ * @return Value @p false if failed to allocate memory. Otherwise @p true.
+ */
+static bool enterSource(SourceWalk *walk, NodeId id, size_t depth, size_t passedFirst, size_t passedEnd) {
+    Node const *node = nodeAt(walk->pf, id);
+    if (depth + node->labelLength + walk->suffixSize >= walk->pathSize) {
+        size_t pathSize = 2 * (depth + node->labelLength + walk->suffixSize + 1);
+        char *path = realloc(walk->path, pathSize * sizeof(char));
+        if (path == NULL) {
+            return false;
+        }
+        walk->path = path;
+        uint8_t *packed = realloc(walk->packed, packedSize(pathSize) + PACKED_PADDING);
+        if (packed == NULL) {
+            return false;
+        }
+        walk->packed = packed;
+        walk->pathSize = pathSize;
+    }
+    size_t pendingCount = walk->pendingCount + passedEnd - passedFirst + 1;
+    if (pendingCount > walk->pendingSize) {
+        size_t pendingSize = 2 * pendingCount;
+        PendingSource *pending = realloc(walk->pending, pendingSize * sizeof(PendingSource));
+        if (pending == NULL) {
+            return false;
+        }
+        walk->pending = pending;
+        walk->pendingSize = pendingSize;
+    }
+    if (walk->framesCount == walk->framesSize) {
+        size_t framesSize = 2 * walk->framesSize;
+        SourceFrame *frames = realloc(walk->frames, framesSize * sizeof(SourceFrame));
+        if (frames == NULL) {
+            return false;
+        }
+        walk->frames = frames;
+        walk->framesSize = framesSize;
+    }
+
+    for (size_t i = 0; i < node->labelLength; i++) {
+        walk->path[depth + i] = digitToChar(labelDigit(node, i));
+    }
+    depth += node->labelLength;
+    // The passed numbers start with the label, so it is skipped in their suffixes.
+    size_t first = walk->pendingCount;
+    for (size_t i = passedFirst; i < passedEnd; i++) {
+        walk->pending[walk->pendingCount++].offset = walk->pending[i].offset + node->labelLength;
+    }
+    if (node->forward != POOL_NONE) {
+        walk->pending[walk->pendingCount++].offset = 0;
+    }
+    for (size_t i = first; i < walk->pendingCount; i++) {
+        size_t offset = walk->pending[i].offset;
+        walk->pending[i].key = pendingKey(walk->pf, node, walk->suffix + offset, walk->suffixSize - offset);
+    }
+    sortPending(walk, first, walk->pendingCount);
+
+    SourceFrame *frame = &walk->frames[walk->framesCount++];
+    frame->node = node;
+    frame->depth = depth;
+    frame->position = 0;
+    frame->first = first;
+    frame->next = first;
+    frame->end = walk->pendingCount;
+    return true;
+}
+
+/** Function adds pending numbers of a visited node.
+ * Function adds the pending numbers of @p frame with keys smaller than @p limit, if they are
+ * forwarded to the given number.
+ * @param[in, out] walk - a pointer to the state of @ref addSources;
+ * @param[in, out] frame - a pointer to the visited node;
+ * @param[in] limit - the key of the first number that is not added;
+ * @param[out] pnum - a pointer to the PhoneNumbers structure.
+ */
+static void addPending(SourceWalk *walk, SourceFrame *frame, size_t limit, PhoneNumbers *pnum) {
+    while (frame->next < frame->end && walk->pending[frame->next].key < limit) {
+        size_t offset = walk->pending[frame->next++].offset;
+        size_t sourceSize = frame->depth - offset;
+        size_t numSize = frame->depth + walk->suffixSize - offset;
+        memcpy(walk->path + frame->depth, walk->suffix + offset, (walk->suffixSize - offset + 1) * sizeof(char));
+
+        // The number is a preimage if the source is its longest forwarded prefix.
+        size_t prefixSize = sourceSize;
+        NodeId forwarded = POOL_NONE;
+        if (walk->onlyPreimages || walk->target != NULL) {
+            packNumber(walk->path, numSize, walk->packed);
+            memset(walk->packed + packedSize(numSize), 0, PACKED_PADDING);
+            forwarded = findPrefix(walk->pf, walk->forwardRoot, walk->packed,
+                                   walk->onlyPreimages ? numSize : sourceSize, &prefixSize);
+        }
+        bool added = prefixSize == sourceSize;
+        if (added && walk->target != NULL) {
+            // The reverse index can still store sources of removed subtrees.
+            Target const *forward = targetAt(walk->pf, nodeAt(walk->pf, forwarded)->forward);
+            added = targetEquals(walk->pf, forward, walk->target, walk->targetSize);
+        }
+        if (added) {
+            addPhoneNumber(pnum, walk->path, numSize);
+        }
+    }
+}
+
+/** Function adds numbers forwarded to a prefix of the number given in @ref phfwdReverse.
+ * Function traverses the trie of sources of one forwarding and for each source
+ * adds the source followed by @p suffix to @p pnum. Children are visited in the order of digits
+ * and the number of a source is added when all smaller numbers have been added, so the added
+ * numbers are sorted lexicographically. A source can be a prefix of another one, so the number
+ * of a source is passed down the trie while it starts with the labels of the nodes.
+ * @param[in] pf - a pointer to the PhoneForward structure;
+ * @param[in] forwardRoot - the root of the read version of the forwarding trie;
+ * @param[in] root - the root of the trie of sources;
+ * @param[in] target - a pointer to the number to which the sources are forwarded if the reverse index
+ * can store removed forwardings, then a source is added only if it is still forwarded to it, or NULL;
+ * @param[in] targetSize - the number of digits of @p target;
+ * @param[in] suffix - a pointer to the digits of the number following the forwarding;
+ * @param[in] suffixSize - the number of digits of @p suffix;
+ * @param[in] onlyPreimages - if @p true, a number is added only if its source is the longest
+ * forwarded prefix of it, so @ref phfwdGet forwards it to the given number;
+ * @param[out] pnum - a pointer to the PhoneNumbers structure.
+ */
+static void addSources(PhoneForward const *pf, NodeId forwardRoot, NodeId root, char const *target,
+                       size_t targetSize, char const *suffix, size_t suffixSize, bool onlyPreimages,
+                       PhoneNumbers *pnum) {
+    SourceWalk walk = {pf, forwardRoot, suffix, suffixSize, onlyPreimages, target, targetSize, NULL, 0, NULL,
+                       malloc(INITIAL_SOURCES_SIZE * sizeof(SourceFrame)), 0, INITIAL_SOURCES_SIZE,
+                       malloc(INITIAL_SOURCES_SIZE * sizeof(PendingSource)), 0, INITIAL_SOURCES_SIZE};
+    bool failed = walk.frames == NULL || walk.pending == NULL || !enterSource(&walk, root, 0, 0, 0);
+
+    while (!failed && walk.framesCount > 0) {
+        SourceFrame *frame = &walk.frames[walk.framesCount - 1];
+        NodeId child = nextChild(pf, frame->node, &frame->position);
+        if (child == POOL_NONE) {
+            addPending(&walk, frame, SIZE_MAX, pnum);
+            walk.pendingCount = frame->first;
+            walk.framesCount--;
+            continue;
+        }
+
+        size_t key = 3 * (size_t) labelDigit(nodeAt(pf, child), 0) + 2;
+        addPending(&walk, frame, key, pnum);
+        size_t passedFirst = frame->next;
+        while (frame->next < frame->end && walk.pending[frame->next].key == key) {
+            frame->next++;
+        }
+        failed = !enterSource(&walk, child, frame->depth, passedFirst, frame->next);
+    }
+    if (failed) {
+        failPhoneNumbers(pnum);
+    }
+    free(walk.path);
+    free(walk.packed);
+    free(walk.frames);
+    free(walk.pending);
+}
+
+/** Function restores the order of a heap of sorted parts of numbers.
+ * The part with the smallest first number is at the top of the heap.
+ * @param[in] pnum - a pointer to the PhoneNumbers structure storing the numbers;
+ * @param[in, out] runs - an array of the parts forming a heap, apart from the part @p i;
+ * @param[in] runsCount - the number of elements of @p runs;
+ * @param[in] i - the index of the part that can be larger than its children.
+ */
+static void siftRun(PhoneNumbers const *pnum, NumbersRun *runs, size_t runsCount, size_t i) {
+    while (true) {
+        size_t smallest = i;
+        for (size_t child = 2 * i + 1; child <= 2 * i + 2 && child < runsCount; child++) {
+            if (compareNumbers(pnum, &pnum->numbers[runs[child].next], &pnum->numbers[runs[smallest].next]) < 0) {
+                smallest = child;
+            }
+        }
+        if (smallest == i) {
+            return;
+        }
+        NumbersRun swap = runs[i];
+        runs[i] = runs[smallest];
+        runs[smallest] = swap;
+        i = smallest;
+    }
+}
+
+/** Function merges sorted parts of numbers.
+ * Function merges the parts with a heap and skips numbers equal to the previous one, so
+ * the numbers of @p pnum become sorted and unique. If it fails to allocate memory,
+ * @ref failPhoneNumbers is called.
+ * @param[in, out] pnum - a pointer to the PhoneNumbers structure;
+ * @param[in, out] runs - an array of non-empty sorted parts covering all numbers of @p pnum,
+ * numbers do not repeat in a part;
+ * @param[in] runsCount - the number of elements of @p runs.
+ */
+static void mergeRuns(PhoneNumbers *pnum, NumbersRun *runs, size_t runsCount) {
+    if (pnum->numbers == NULL || runsCount < 2) {
+        return;
+    }
+    NumberEntry *merged = malloc(pnum->numbersSize * sizeof(NumberEntry));
+    if (merged == NULL) {
+        failPhoneNumbers(pnum);
+        return;
     }
 
-    return pf;
-}
-
-void phfwdDelete(PhoneForward *pf) {
-    if (pf != NULL) {
-        Stack *st = newNode();
-        if (st == NULL) {
-            return;
+    for (size_t i = runsCount / 2; i-- > 0;) {
+        siftRun(pnum, runs, runsCount, i);
+    }
+    size_t count = 0;
+    while (runsCount > 0) {
+        NumberEntry const *entry = &pnum->numbers[runs[0].next++];
+        if (count == 0 || compareNumbers(pnum, entry, &merged[count - 1]) != 0) {
+            merged[count++] = *entry;
         }
-        push(&st, pf);
-
-        while (!is_empty(st)) {
-            PhoneForward *node = top(st);
-            if (node->numberOfNextDigits == 0) {
-                pop(&st);
-                if (node->index != -1) {
-                    (node->prevDigit)->nextDigitsArray[node->index] = NULL;
-                }
-                free(node->forward);
-                free(node);
-            } else {
-                int i = 0;
-                while (i < NUMBER_OF_DIGITS && node->numberOfNextDigits > 0) {
-                    if (node->nextDigitsArray[i] != NULL) {
-                        push(&st, node->nextDigitsArray[i]);
-                        node->numberOfNextDigits--;
-                    }
-                    i++;
-                }
-            }
+        if (runs[0].next == runs[0].end) {
+            runs[0] = runs[--runsCount];
         }
-        removeStack(&st);
+        siftRun(pnum, runs, runsCount, 0);
     }
+    free(pnum->numbers);
+    pnum->numbers = merged;
+    pnum->numbersCount = count;
 }
 
-/** Function returns the length of a number.
- * Function checks if given string is correct (if it contains of digits only and ends with character '\0')
- * and if so, it returns its length.
- * @param[in] num - a pointer to a string representing the number;
- * @return The length of @p num or 0 if the given string @p num is incorrect.
+/** Function finds numbers forwarded to a given number.
+ * Function walks the path of @p num in the reverse index and adds the numbers forwarded
+ * to its prefixes to @p pnum, followed by @p num itself. Numbers of each prefix are added sorted,
+ * and then all of them are merged, so the result is sorted and unique. If @p onlyPreimages is
+ * @p true, only numbers that @ref phfwdGet forwards to @p num are added. Each of them is
+ * forwarded by its longest forwarded prefix, so it is added exactly once.
+ * If it fails to allocate memory, @ref failPhoneNumbers is called.
+ * @param[in] version - a pointer to the read version;
+ * @param[in] view - a pointer to the view of the correct number @p num;
+ * @param[in] onlyPreimages - a boolean informing if only the preimages of @p num are added;
+ * @param[out] pnum - a pointer to the PhoneNumbers structure.
  */
-static size_t length(char const *num) {
-    if (num == NULL) {
-        return 0;
+static void addReverse(Version const *version, PhoneNumberView const *view, bool onlyPreimages,
+                       PhoneNumbers *pnum) {
+    PhoneForward const *pf = version->owner;
+    char const *num = view->num;
+    size_t numSize = view->length;
+    // Each prefix of [num] and [num] itself give at most one sorted part.
+    NumbersRun *runs = malloc((numSize + 1) * sizeof(NumbersRun));
+    if (runs == NULL) {
+        failPhoneNumbers(pnum);
+        return;
     }
+    size_t runsCount = 0;
+
+    // Only forwardings that are prefixes of [num] lie on its path in the reverse index.
+    Node const *node = nodeAt(pf, version->reverseRoot);
     size_t i = 0;
-    while (num[i] != '\0') {
-        if (!isDigit(num[i])) {
-            return 0;
+    while (i < numSize && pnum->numbers != NULL) {
+        NodeId child = getChild(pf, node, charToDigit(num[i]));
+        if (child == POOL_NONE) {
+            break;
+        }
+        node = nodeAt(pf, child);
+        if (matchLabel(node, num + i, numSize - i) < node->labelLength) {
+            break;
+        }
+        i += node->labelLength;
+        if (node->forward != POOL_NONE) {
+            size_t first = pnum->numbersCount;
+            addSources(pf, version->root, node->forward, version->stale ? num : NULL, i, num + i, numSize - i,
+                       onlyPreimages, pnum);
+            if (pnum->numbersCount > first) {
+                runs[runsCount].next = first;
+                runs[runsCount++].end = pnum->numbersCount;
+            }
         }
-        i++;
     }
-    return i;
-}
 
-/** Function marks the end of the prefix @p num1 with corresponding new prefix @p num2.
- * Function sets the forwarding to @p num1 used in @ref phfwdAdd function.
- * @param[in, out] node - a pointer to the @p PhoneNumbers node describing the last character of @p num1;
- * @param[in] forwardNum - a pointer to the new prefix.
- * @return Value @p false if failed to allocate memory. Otherwise @p true.
- */
-static bool mark(PhoneForward *node, char const *forwardNum) {
-    size_t forwardNumSize = length(forwardNum);
-    node->forward = malloc((forwardNumSize + 1) * sizeof(char));
-    if (node->forward == NULL) {
-        return false;
+    size_t prefixSize;
+    if (!onlyPreimages || findPrefix(pf, version->root, view->digits, numSize, &prefixSize) == POOL_NONE) {
+        size_t first = pnum->numbersCount;
+        addPhoneNumber(pnum, num, numSize);
+        if (pnum->numbersCount > first) {
+            runs[runsCount].next = first;
+            runs[runsCount++].end = pnum->numbersCount;
+        }
     }
-    memcpy(node->forward, forwardNum, (forwardNumSize + 1) * sizeof(char));
-    return true;
+    mergeRuns(pnum, runs, runsCount);
+    free(runs);
 }
 
-bool phfwdAdd(PhoneForward *pf, char const *num1, char const *num2) {
+/** Function finds numbers forwarded to a given number and stores them in a new structure.
+ * @param[in] pf - a pointer to a structure that stores number redirections;
+ * @param[in] num - a pointer to the view of the number or NULL;
+ * @param[in] onlyPreimages - a boolean informing if only the preimages of @p num are found.
+ * @return A pointer to the created structure or NULL if failed to allocate memory or @p pf is NULL.
+ */
+static PhoneNumbers *findReverse(PhoneForward const *pf, PhoneNumberView const *num, bool onlyPreimages) {
     if (pf == NULL) {
-        return false;
+        return NULL;
     }
-    PhoneForward *node = pf;
-
-    // Function returns false if any of the numbers ([num1], [num2]) is incorrect,
-    // or if they are the same number.
-    if (length(num1) == 0 || length(num2) == 0 || strcmp(num1, num2) == 0) {
-        return false;
+    PhoneNumbers *pnum = pnumNew(INITIAL_NUMBERS_SIZE, INITIAL_DIGITS_SIZE);
+    if (pnum == NULL) {
+        return NULL;
+    }
+    if (num == NULL || num->length == 0) {
+        addPhoneNumber(pnum, NULL, 0);
+        return pnum;
     }
 
-    size_t i = 0;
-    while (num1[i] != '\0') {
-        int index = charToDigit(num1[i]);
+    Version version = readBegin(pf);
+    addReverse(&version, num, onlyPreimages, pnum);
+    readEnd(&version);
+    if (pnum->numbers == NULL) {
+        phnumDelete(pnum);
+        return NULL;
+    }
+    return pnum;
+}
 
-        if (node->nextDigitsArray[index] == NULL) {
-            node->nextDigitsArray[index] = phfwdNew();
-            // Checking if [node->nextDigitsArray[index]] was allocated properly.
-            if (node->nextDigitsArray[index] == NULL) {
-                return false;
-            }
-            node->nextDigitsArray[index]->prevDigit = node;
-            node->nextDigitsArray[index]->index = index;
-            node->numberOfNextDigits++;
-        }
-        node = node->nextDigitsArray[index];
-        i++;
+PhoneNumbers *phfwdReverse(PhoneForward const *pf, char const *num) {
+    uint8_t local[LOCAL_DIGITS_SIZE];
+    PhoneNumberView view;
+    if (pf == NULL || !initView(&view, num, local, sizeof(local))) {
+        return NULL;
     }
+    PhoneNumbers *pnum = findReverse(pf, &view, false);
+    freeView(&view, local);
+    return pnum;
+}
 
-    free(node->forward);
-    return mark(node, num2);
+PhoneNumbers *phfwdReverseView(PhoneForward const *pf, PhoneNumberView const *num) {
+    return findReverse(pf, num, false);
 }
 
-void phfwdRemove(PhoneForward *pf, char const *num) {
-    if (pf != NULL) {
-        PhoneForward *node = pf;
-        size_t numSize = length(num);
+PhoneNumbers *phfwdGetReverse(PhoneForward const *pf, char const *num) {
+    uint8_t local[LOCAL_DIGITS_SIZE];
+    PhoneNumberView view;
+    if (pf == NULL || !initView(&view, num, local, sizeof(local))) {
+        return NULL;
+    }
+    PhoneNumbers *pnum = findReverse(pf, &view, true);
+    freeView(&view, local);
+    return pnum;
+}
+
+PhoneNumbers *phfwdGetReverseView(PhoneForward const *pf, PhoneNumberView const *num) {
+    return findReverse(pf, num, true);
+}
 
-        /* The last significant node (it has a forwarding,
-         * or it is the prefix of more than one forwarded number). */
-        PhoneForward *lastSigNode = pf;
-        int deleteIndex = 0; // An index of the first of non-significant nodes.
+/** Function reads the size and the memory of a structure.
+ * In concurrent mode they are read while writers wait, but readers are not stopped.
+ * @param[in] pf - a pointer to the structure or its snapshot;
+ * @param[out] stats - a pointer to the description.
+ */
+static void readSize(PhoneForward const *pf, PhoneForwardStats *stats) {
+    PhoneForward const *owner = pf->origin != NULL ? pf->origin : pf;
+    // Only the mutex of writers is changed.
+    pthread_mutex_t *lock = (pthread_mutex_t *) &owner->lock;
+    if (owner->concurrent) {
+        pthread_mutex_lock(lock);
+    }
+    // A snapshot keeps the size of the trie of its version.
+    stats->nodes = pf->trieSize.nodes;
+    stats->rules = pf->trieSize.rules;
+    stats->nodeBytes = pf->trieSize.bytes;
+    stats->targets = owner->targetsCount;
+    stats->forwardBytes = (size_t) owner->targets.count * sizeof(Target) + (size_t) owner->chunks.count * sizeof(Chunk);
+    stats->totalBytes = poolMemory(&owner->nodes) + poolMemory(&owner->smallArrays) + poolMemory(&owner->digitArrays)
+                        + poolMemory(&owner->chunks) + poolMemory(&owner->targets) + owner->mappedSize
+                        + owner->targetBucketsSize * sizeof(uint32_t) + owner->freshSize * sizeof(NodeId)
+                        + owner->reclaimer.retiredSize * sizeof(Retired);
+    if (owner->concurrent) {
+        pthread_mutex_unlock(lock);
+    }
+}
 
-        if (numSize != 0) {
-            for (size_t i = 0; i < numSize; i++) {
-                int index = charToDigit(num[i]);
+/** Function counts the nodes of the trie by their depth and number of children.
+ * @param[in] pf - a pointer to the structure or its snapshot;
+ * @param[out] stats - a pointer to the description, whose counts of nodes are 0.
+ * @return Value @p false if failed to allocate memory. Otherwise @p true.
+ */
+static bool readShape(PhoneForward const *pf, PhoneForwardStats *stats) {
+    size_t framesSize = INITIAL_PATH_SIZE;
+    StatsFrame *frames = malloc(framesSize * sizeof(StatsFrame));
+    if (frames == NULL) {
+        return false;
+    }
 
-                if (node->nextDigitsArray[index] == NULL) {
-                    break;
-                }
+    Version version = readBegin(pf);
+    PhoneForward const *owner = version.owner;
+    size_t framesCount = 0;
+    StatsFrame root = {version.root, 0, 0};
+    frames[framesCount++] = root;
+    bool walked = true;
+    while (walked && framesCount > 0) {
+        StatsFrame frame = frames[--framesCount];
+        Node const *node = nodeAt(owner, frame.id);
+        stats->depths[frame.depth < PHFWD_STATS_DEPTHS ? frame.depth : PHFWD_STATS_DEPTHS - 1]++;
+        stats->fanOuts[node->numberOfNextDigits]++;
+        size_t chain = node->numberOfNextDigits == 1 ? frame.chain + 1 : 0;
+        if (chain > stats->longestChain) {
+            stats->longestChain = chain;
+        }
 
-                if (node->numberOfNextDigits > 1 || node->forward != NULL || i == 0) {
-                    lastSigNode = node;
-                    deleteIndex = index;
-                }
-                node = node->nextDigitsArray[index];
-            }
-            if (lastSigNode->nextDigitsArray[deleteIndex] != NULL) {
-                lastSigNode->numberOfNextDigits--;
-                phfwdDelete(lastSigNode->nextDigitsArray[deleteIndex]);
-                lastSigNode->nextDigitsArray[deleteIndex] = NULL;
+        if (framesCount + node->numberOfNextDigits > framesSize) {
+            size_t newFramesSize = 2 * framesSize + node->numberOfNextDigits;
+            StatsFrame *newFrames = realloc(frames, newFramesSize * sizeof(StatsFrame));
+            if (newFrames == NULL) {
+                walked = false;
+                break;
             }
+            frames = newFrames;
+            framesSize = newFramesSize;
+        }
+        int position = 0;
+        NodeId child;
+        while ((child = nextChild(owner, node, &position)) != POOL_NONE) {
+            // Nodes are scattered in the pool, so children are fetched before they are visited.
+            __builtin_prefetch(nodeAt(owner, child));
+            StatsFrame next = {child, frame.depth + 1, chain};
+            frames[framesCount++] = next;
         }
     }
+    readEnd(&version);
+    free(frames);
+    return walked;
 }
 
-/** Function adds a number to PhoneNumbers.
- * Function reallocates the PhoneNumbers structure if needed and adds a new number @p num.
- * @param[in, out] pn - a pointer to the PhoneNumbers structure;
- * @param[in] num - a pointer to the number to be added.
- */
-static void addPhoneNumber(PhoneNumbers *pn, char const *num) {
-    if (pn == NULL) {
-        return;
+bool phfwdStats(PhoneForward const *pf, PhoneForwardStats *stats, bool shape) {
+    if (pf == NULL || stats == NULL) {
+        return false;
     }
-    if (pn->numbersCount == pn->numbersSize) {
-        pn->numbersSize *= 2;
-        pn->numbers = realloc(pn->numbers, pn->numbersSize * sizeof(char *));
+    memset(stats, 0, sizeof(PhoneForwardStats));
+    if (shape && !readShape(pf, stats)) {
+        return false;
     }
-    if (pn->numbers == NULL) {
-        return;
+    readSize(pf, stats);
+    return true;
+}
+
+PhoneForwardIterator *phfwdIterBegin(PhoneForward const *pf, char const *prefix) {
+    size_t prefixSize = prefix == NULL ? 0 : numberLength(prefix);
+    if (pf == NULL || (prefixSize == 0 && prefix != NULL && prefix[0] != '\0')) {
+        return NULL;
     }
-    size_t numSize = length(num);
-    if (numSize != 0) {
-        pn->numbers[pn->numbersCount] = malloc((numSize + 1) * sizeof(char));
-        if (pn->numbers[pn->numbersCount] == NULL) {
-            return;
+    PhoneForwardIterator *it = malloc(sizeof(PhoneForwardIterator));
+    if (it == NULL) {
+        return NULL;
+    }
+    it->version = readBegin(pf);
+    PhoneForward const *owner = it->version.owner;
+
+    // The prefix can end inside a label, then the whole node is iterated.
+    NodeId id = it->version.root;
+    size_t depth = 0;
+    while (id != POOL_NONE) {
+        Node const *node = nodeAt(owner, id);
+        size_t i = 0;
+        while (i < node->labelLength && depth + i < prefixSize
+               && labelDigit(node, i) == charToDigit(prefix[depth + i])) {
+            i++;
         }
-        memcpy(pn->numbers[pn->numbersCount], num, numSize + 1);
-    } else {
-        pn->numbers[pn->numbersCount] = NULL;
+        if (depth + i == prefixSize) {
+            break;
+        }
+        if (i < node->labelLength) {
+            id = POOL_NONE;
+        } else {
+            depth += node->labelLength;
+            id = getChild(owner, node, charToDigit(prefix[depth]));
+        }
+    }
+    it->start = id;
+    it->startDepth = depth;
+    it->forward = it->localForward;
+    it->forwardSize = WALK_LOCAL_PATH;
+    walkInit(&it->walk, owner, id, prefix != NULL ? prefix : "", depth, false);
+    if (it->walk.failed) {
+        phfwdIterEnd(it);
+        return NULL;
     }
-    pn->numbersCount++;
+    return it;
 }
 
-/** Function merges prefix with the rest of the number,
- * Function creates the forwarded number (the result of @ref phfwdGet function) by merging
- * the @p newPrefix with the rest of the number @p num.
- * @param[in] num - a pointer to the number;
- * @param[in] forwarded - a boolean informing if the number has been forwarded;
- * @param[out] newNumber - a pointer to the forwarding number;
- * @param[in] newPrefix - a pointer to the new prefix;
- * @param[in] prefixIndex - a variable thet informs how many digits of @p num has to be forwarded.
- */
-static void mergePrefNum(char const *num, bool forwarded, char **newNumber, char const *newPrefix, size_t prefixIndex) {
-    char *temp = *newNumber;
-    size_t numSize = length(num);
-    size_t prefixSize = length(newPrefix);
-    if (!forwarded) {
-        temp = calloc((numSize + 1), sizeof(char));
-        if (temp == NULL) {
-            return;
+bool phfwdIterNext(PhoneForwardIterator *it, char const **num1, char const **num2) {
+    if (it == NULL || num1 == NULL || num2 == NULL) {
+        return false;
+    }
+    PhoneForward const *owner = it->version.owner;
+    NodeId id;
+    while ((id = walkNext(&it->walk)) != POOL_NONE) {
+        uint32_t forward = nodeAt(owner, id)->forward;
+        if (forward == POOL_NONE) {
+            continue;
         }
-        memcpy(temp, num, numSize + 1);
-    } else {
-        size_t newNumberSize = numSize + prefixSize - prefixIndex - 1;
-        temp = calloc((newNumberSize + 1), sizeof(char));
-        if (temp == NULL) {
-            return;
+        size_t length = forwardLength(owner, forward);
+        if (!reserveChars(&it->forward, &it->forwardSize, it->localForward, 0, length + 1)) {
+            it->walk.failed = true;
+            return false;
         }
+        copyForward(owner, forward, it->forward);
+        *num1 = it->walk.digits;
+        *num2 = it->forward;
+        return true;
+    }
+    return false;
+}
 
-        memcpy(temp, newPrefix, prefixSize + 1);
+bool phfwdIterSeek(PhoneForwardIterator *it, char const *key) {
+    size_t keySize = numberLength(key);
+    if (it == NULL || keySize == 0) {
+        return false;
+    }
+    TrieWalk *walk = &it->walk;
+    walk->failed = false;
+    walk->framesCount = 0;
+    walk->length = it->startDepth;
+    walk->digits[it->startDepth] = '\0';
+    if (it->start == POOL_NONE) {
+        return true;
+    }
+    walk->frames[walk->framesCount++] = (WalkFrame) {it->start, it->startDepth, -1};
 
-        for (size_t i = 0; i < numSize - prefixIndex - 1; i++) {
-            temp[prefixSize + i] = num[prefixIndex + i + 1];
+    // Digits before the label of the first node are the digits of the prefix.
+    size_t common = keySize < it->startDepth ? keySize : it->startDepth;
+    int order = numberCompare(key, common, walk->digits, common);
+    if (order != 0 || keySize <= it->startDepth) {
+        if (order > 0) {
+            walk->framesCount = 0;
         }
+        return true;
     }
-    *newNumber = temp;
-}
 
-/** Function finds the longest prefix of @p num that has a redirection.
- * Function traverses the @p PhoneForward structure an searches for the longest prefix of @p num
- * that has been forwarded. It merges the new prefix with the rest of the number with @ref mergePrefNum.
- * @param[in] node - a pointer to the PhoneForward structure;
- * @param[in] num - a pointer to the given number;
- * @param[out] newNumber - a pointer to the forwarding number.
- */
-static void findPrefix(PhoneForward const *node, char const *num, char **newNumber) {
-    bool forwarded = false;
-    char *newPrefix;
-    size_t numSize = length(num);
-    size_t prefixSize = 0;
-    newPrefix = calloc((prefixSize + 1), sizeof(char));
-    if (newPrefix == NULL) {
-        return;
+    // Nodes on the path of the key are marked as entered, then the walk continues after the key.
+    while (true) {
+        WalkFrame *frame = &walk->frames[walk->framesCount - 1];
+        Node const *node = nodeAt(walk->pf, frame->id);
+        for (size_t i = 0; i < node->labelLength; i++) {
+            if (frame->depth + i == keySize) {
+                return true;
+            }
+            int digit = charToDigit(key[frame->depth + i]);
+            if (labelDigit(node, i) > digit) {
+                return true;
+            }
+            if (labelDigit(node, i) < digit) {
+                walk->framesCount--;
+                return true;
+            }
+        }
+        if (!walkEnter(walk, frame)) {
+            return false;
+        }
+        if (walk->length == keySize) {
+            return true;
+        }
+        int digit = charToDigit(key[walk->length]);
+        int position = 0;
+        NodeId child;
+        while ((child = nextChild(walk->pf, node, &position)) != POOL_NONE
+               && labelDigit(nodeAt(walk->pf, child), 0) < digit) {
+        }
+        if (child == POOL_NONE || labelDigit(nodeAt(walk->pf, child), 0) > digit) {
+            frame->position = child == POOL_NONE ? position : position - 1;
+            return true;
+        }
+        frame->position = position;
+        if (!walkPush(walk, child, walk->length)) {
+            return false;
+        }
     }
-    size_t prefixIndex = 0; // The index with the longest forwarded prefix.
-
-    for (size_t i = 0; i < numSize; i++) {
-        int index = charToDigit(num[i]);
+}
 
-        if (node->nextDigitsArray[index] == NULL) {
-            break;
+void phfwdIterEnd(PhoneForwardIterator *it) {
+    if (it != NULL) {
+        readEnd(&it->version);
+        walkDestroy(&it->walk);
+        if (it->forward != it->localForward) {
+            free(it->forward);
         }
+        free(it);
+    }
+}
 
-        node = node->nextDigitsArray[index];
+void phnumDelete(PhoneNumbers *pnum) {
+    if (pnum != NULL) {
+        free(pnum->numbers);
+        free(pnum->digits);
+        free(pnum->strings);
+        free(pnum);
+    }
+}
 
-        if (node->forward != NULL) {
-            size_t newPrefixSize = length(node->forward);
-            newPrefix = realloc(newPrefix, newPrefixSize + 1);
-            if (newPrefix == NULL) {
-                return;
-            }
-            prefixSize = newPrefixSize;
-            memcpy(newPrefix, node->forward, prefixSize + 1);
-            prefixIndex = i;
-            forwarded = true;
-        }
+/** Function converts the numbers of a sequence to characters.
+ * Function writes all numbers, each followed by '\0', to one array and replaces their
+ * positions with positions in this array. Then the packed digits are freed.
+ * @param[in, out] pnum - a pointer to the PhoneNumbers structure with packed numbers.
+ * @return Value @p false if failed to allocate memory, then the sequence is not changed.
+ * Otherwise @p true.
+ */
+static bool convertNumbers(PhoneNumbers *pnum) {
+    size_t size = 0;
+    for (size_t i = 0; i < pnum->numbersCount; i++) {
+        size += pnum->numbers[i].length + 1;
+    }
+    char *strings = malloc(size * sizeof(char));
+    if (strings == NULL) {
+        return false;
     }
 
-    mergePrefNum(num, forwarded, newNumber, newPrefix, prefixIndex);
-    free(newPrefix);
+    size_t position = 0;
+    for (size_t i = 0; i < pnum->numbersCount; i++) {
+        NumberEntry *entry = &pnum->numbers[i];
+        unpackNumber(pnum->digits + entry->offset, entry->length, strings + position);
+        strings[position + entry->length] = '\0';
+        entry->offset = position;
+        position += entry->length + 1;
+    }
+    free(pnum->digits);
+    pnum->digits = NULL;
+    pnum->digitsSize = 0;
+    pnum->digitsCount = 0;
+    pnum->strings = strings;
+    return true;
 }
 
-PhoneNumbers *phfwdGet(PhoneForward const *pf, char const *num) {
-    if (pf == NULL) {
+char const *phnumGet(PhoneNumbers const *pnum, size_t idx) {
+    if (pnum == NULL || idx >= pnum->numbersCount || pnum->numbers[idx].length == 0) {
         return NULL;
     }
 
-    size_t numSize = length(num);
-    PhoneNumbers *pnum = pnumNew();
-    PhoneForward const *node = pf;
-    char *newNumber = NULL; // Forwarding number.
+    // Numbers are converted to characters only when they are needed, all of them at once.
+    if (pnum->strings == NULL && !convertNumbers((PhoneNumbers *) pnum)) {
+        return NULL;
+    }
+    return pnum->strings + pnum->numbers[idx].offset;
+}
 
-    if (numSize != 0) {
-        findPrefix(node, num, &newNumber);
+PhoneNumberView *phnumViewNew(char const *num) {
+    size_t numSize = numberLength(num);
+    if (numSize == 0) {
+        return NULL;
     }
-    addPhoneNumber(pnum, newNumber);
-    if (numSize != 0 && newNumber != NULL) {
-        free(newNumber);
+
+    // The digits are stored in the same block of memory as the view.
+    PhoneNumberView *view = malloc(sizeof(PhoneNumberView) + packedSize(numSize) + PACKED_PADDING);
+    if (view != NULL) {
+        view->num = num;
+        view->length = numSize;
+        view->digits = (uint8_t *) (view + 1);
+        packNumber(num, numSize, view->digits);
+        memset(view->digits + packedSize(numSize), 0, PACKED_PADDING);
     }
+    return view;
+}
 
-    return pnum;
+void phnumViewDelete(PhoneNumberView *view) {
+    free(view);
 }
 
-/** Function comapres two strings. Returns positive integer if the first string is larger, negative if smaller,
- * and 0 if they are equal.
- * @param[in] a - a pointer to the first string;
- * @param[in] b - a pointer to the second string;
- * @return 1 if @p a > @p b, -1 if @p a < @p b, 0 otherwise.
+/** Function returns the pools of a structure in the order of the sections of a saved file.
+ * @param[in] pf - a pointer to the PhoneForward structure;
+ * @param[out] pools - an array of @ref STORE_SECTIONS pointers to the pools.
  */
-static int compareString(char const *a, char const *b) {
-    size_t lenA = length(a);
-    size_t lenB = length(b);
+static void sectionPools(PhoneForward *pf, Pool *pools[STORE_SECTIONS]) {
+    pools[0] = &pf->nodes;
+    pools[1] = &pf->smallArrays;
+    pools[2] = &pf->digitArrays;
+    pools[3] = &pf->chunks;
+    pools[4] = &pf->targets;
+}
 
-    for (size_t i = 0; i < lenA; i++) {
-        if (i == lenB) {
-            return 1;
-        }
-        if (compareDigits(a[i], b[i]) != 0) {
-            return compareDigits(a[i], b[i]);
+/** Function copies a node to a compacted structure.
+ * The copied node stores indices of the original structure until it is processed
+ * by @ref copyChildren.
+ * @param[in, out] compaction - a pointer to the copy;
+ * @param[in] copy - the index of an allocated node of the copy;
+ * @param[in] id - the index of the copied node;
+ * @param[in] kind - the kind of the node, from @ref FORWARD_NODE to @ref SOURCE_NODE.
+ * @return Value @p false if failed to allocate memory. Otherwise @p true.
+ */
+static bool copyNode(Compaction *compaction, NodeId copy, NodeId id, uint8_t kind) {
+    if (copy >= compaction->kindsSize) {
+        size_t kindsSize = 2 * compaction->kindsSize > copy ? 2 * compaction->kindsSize : (size_t) copy + 1;
+        uint8_t *kinds = realloc(compaction->kinds, kindsSize * sizeof(uint8_t));
+        if (kinds == NULL) {
+            return false;
         }
+        compaction->kinds = kinds;
+        compaction->kindsSize = kindsSize;
     }
-    if (lenA < lenB) {
-        return -1;
-    } else {
-        return 0;
+    Node *node = nodeAt(compaction->copy, copy);
+    *node = *nodeAt(compaction->pf, id);
+    node->shared = 0;
+    compaction->kinds[copy] = kind;
+    if (kind == FORWARD_NODE) {
+        TrieSize *size = &compaction->copy->trieSize;
+        size->nodes++;
+        size->rules += node->forward != POOL_NONE;
+        size->bytes += nodeBytes(node);
     }
+    return true;
 }
 
-/** Comaparator function for qsort. Returns positive integer if the first string is larger, negative if smaller,
- * and 0 if they are equal.
- * @param[in] a - a pointer to the first string;
- * @param[in] b - a pointer to the second string;
- * @return Positive integer if @p a > @p b, negative if @p a < @p b, 0 otherwise.
+/** Function adds a node to a compacted structure.
+ * Nodes are added in the order they are found, so the walk started from the roots
+ * numbers them in the breadth-first order.
+ * @param[in, out] compaction - a pointer to the copy;
+ * @param[in] id - the index of the copied node;
+ * @param[in] kind - the kind of the node, from @ref FORWARD_NODE to @ref SOURCE_NODE.
+ * @return The index of the node in the copy or @ref POOL_NONE if failed to allocate memory.
  */
-static int compare(const void *a, const void *b) {
-    const char **stringA = (const char **) a;
-    const char **stringB = (const char **) b;
-
-    return compareString(*stringA, *stringB);
+static NodeId addCopiedNode(Compaction *compaction, NodeId id, uint8_t kind) {
+    NodeId copy = poolAlloc(&compaction->copy->nodes);
+    if (copy == POOL_NONE || !copyNode(compaction, copy, id, kind)) {
+        return POOL_NONE;
+    }
+    return copy;
 }
 
-/** Function checks if @p forwarding is the prefix of @p num and if so, it creates the number that is
- * one of the results of @ref phfwdReverse function and saves it in @p newString. Otherwise it does nothing.
- * @param[in] prefix - a pointer to the perfix of the new number;
- * @param[in] prefixSize - an integer describing the number of significant digits in prefix;
- * @param[in] forwarding - a pointer to the forwarding;
- * @param[in] num - a pointer to the number given in @ref phfwdReverse;
- * @param[out] newString - a pointer to the new number.
+/** Function adds a forwarding to a compacted structure.
+ * Each forwarding is copied once, its chunks are stored one after another.
+ * @param[in, out] compaction - a pointer to the copy;
+ * @param[in] forward - the index of the copied forwarding.
+ * @return The index of the forwarding in the copy or @ref POOL_NONE if failed to allocate memory.
  */
-static void merge(char **newString, char const *prefix, size_t prefixSize, char const *forwarding, char const *num) {
-    size_t numSize = length(num);
-    size_t forwardSize = length(forwarding);
-    size_t newStringSize = numSize - forwardSize + prefixSize;
-    if (numSize == 0) {
-        return;
-    }
-    bool isPrefix = false;
-    for (size_t i = 0; i < numSize; i++) {
-        if (forwardSize - i - 1 == 0) {
-            if (compareDigits(num[i], forwarding[i]) != 0) {
-                break;
-            }
-            isPrefix = true;
-            break;
+static uint32_t addCopiedTarget(Compaction *compaction, uint32_t forward) {
+    if (forward >= compaction->targetsSize) {
+        size_t targetsSize = 2 * compaction->targetsSize > forward ? 2 * compaction->targetsSize : (size_t) forward + 1;
+        uint32_t *targets = realloc(compaction->targets, targetsSize * sizeof(uint32_t));
+        if (targets == NULL) {
+            return POOL_NONE;
         }
-        if (compareDigits(num[i], forwarding[i]) != 0) {
-            break;
+        for (size_t i = compaction->targetsSize; i < targetsSize; i++) {
+            targets[i] = POOL_NONE;
         }
+        compaction->targets = targets;
+        compaction->targetsSize = targetsSize;
+    }
+    PhoneForward *copy = compaction->copy;
+    if (compaction->targets[forward] != POOL_NONE) {
+        // References of the original can count forwardings added after the copied version.
+        targetAt(copy, compaction->targets[forward])->references++;
+        return compaction->targets[forward];
     }
 
-    if (isPrefix == true) {
-        *newString = calloc(newStringSize + 1, sizeof(char));
-        if (*newString == NULL) {
-            return;
-        }
-        memcpy(*newString, prefix, prefixSize + 1);
-        (*newString)[prefixSize] = '\0';
-        for (size_t i = prefixSize; i < newStringSize; i++) {
-            (*newString)[i] = num[forwardSize + i - prefixSize];
+    uint32_t copied = poolAlloc(&copy->targets);
+    if (copied == POOL_NONE) {
+        return POOL_NONE;
+    }
+    Target const *target = targetAt(compaction->pf, forward);
+    Target *copiedTarget = targetAt(copy, copied);
+    copiedTarget->chunks = POOL_NONE;
+    copiedTarget->length = target->length;
+    copiedTarget->references = 1;
+    copiedTarget->hash = target->hash;
+    copiedTarget->hashNext = POOL_NONE;
+    uint32_t *last = &copiedTarget->chunks;
+    for (uint32_t chunks = target->chunks; chunks != POOL_NONE;) {
+        uint32_t id = poolAlloc(&copy->chunks);
+        if (id == POOL_NONE) {
+            return POOL_NONE;
         }
+        Chunk const *chunk = poolGet(&compaction->pf->chunks, chunks);
+        Chunk *copiedChunk = poolGet(&copy->chunks, id);
+        *copiedChunk = *chunk;
+        copiedChunk->next = POOL_NONE;
+        *last = id;
+        last = &copiedChunk->next;
+        chunks = chunk->next;
     }
+    copy->targetsCount++;
+    compaction->targets[forward] = copied;
+    return copied;
 }
 
-/** Function removes the duplicates in @p array.
- * @param[in, out] array - a pointer to the array;
- * @param[in, out] size - an integer describing the size of an array.
- */
-static void removeDuplicates(char ***array, size_t *size) {
-    char **temp = calloc(*size + 1, sizeof(char *));
-    size_t uniqueValues = 0;
-    for (size_t i = 0; i < *size; i++) {
-        if (i == 0) {
-            temp[i] = (*array)[i];
-            uniqueValues++;
-        } else {
-            if (strcmp((*array)[i], temp[uniqueValues - 1]) != 0) {
-                temp[uniqueValues] = (*array)[i];
-                uniqueValues++;
-            } else {
-                free((*array)[i]);
+/** Function copies the children and the forwarding of a node of a compacted structure.
+ * Function replaces the indices of the original structure stored in the node with
+ * indices of their copies.
+ * @param[in, out] compaction - a pointer to the copy;
+ * @param[in] copy - the index of the node in the copy.
+ * @return Value @p false if failed to allocate memory. Otherwise @p true.
+ */
+static bool copyChildren(Compaction *compaction, NodeId copy) {
+    Node *node = nodeAt(compaction->copy, copy);
+    uint8_t kind = compaction->kinds[copy];
+    if (node->capacity == 1) {
+        node->next = addCopiedNode(compaction, node->next, kind);
+        if (node->next == POOL_NONE) {
+            return false;
+        }
+    } else if (node->capacity > 1) {
+        NodeId const *children = childArray(compaction->pf, node);
+        Pool *pool = node->capacity == NUMBER_OF_DIGITS ? &compaction->copy->digitArrays
+                                                        : &compaction->copy->smallArrays;
+        uint32_t array = poolAlloc(pool);
+        if (array == POOL_NONE) {
+            return false;
+        }
+        NodeId *copiedChildren = poolGet(pool, array);
+        size_t used = node->capacity == NUMBER_OF_DIGITS ? NUMBER_OF_DIGITS : node->numberOfNextDigits;
+        for (size_t i = 0; i < node->capacity; i++) {
+            copiedChildren[i] = POOL_NONE;
+            if (i < used && children[i] != POOL_NONE) {
+                copiedChildren[i] = addCopiedNode(compaction, children[i], kind);
+                if (copiedChildren[i] == POOL_NONE) {
+                    return false;
+                }
             }
         }
+        node->next = array;
+    } else {
+        node->next = POOL_NONE;
     }
-    free(*array);
-    *array = calloc(uniqueValues, sizeof(char *));
-    for (size_t i = 0; i < uniqueValues; i++) {
-        (*array)[i] = temp[i];
+
+    // In the tries of the reverse index the forwarding is only a mark.
+    if (node->forward != POOL_NONE && kind != SOURCE_NODE) {
+        node->forward = kind == FORWARD_NODE ? addCopiedTarget(compaction, node->forward)
+                                             : addCopiedNode(compaction, node->forward, SOURCE_NODE);
+        if (node->forward == POOL_NONE) {
+            return false;
+        }
     }
-    free(temp);
-    *size = uniqueValues;
+    return true;
 }
 
-/** Function reallocates an @p array if needed.
- * @param[in, out] array - a pointer to the array;
- * @param[in] currentIndex - an integer describing the index of the last significant cell.
- * @param[in, out] maxSize - an integer describing the size of an array.
+/** Function copies a version of a structure without unused elements.
+ * Nodes of the copy are numbered in the breadth-first order: the trie, the reverse index
+ * and the tries of numbers forwarded to one number. Arrays of children, forwardings and their
+ * chunks are stored in the order they are found.
+ * @param[in] version - a pointer to the copied version.
+ * @return A pointer to the copy or NULL if failed to allocate memory.
  */
-static void safeRealloc(char **array, size_t currentIndex, size_t *maxSize) {
-    if (currentIndex >= *maxSize) {
-        *array = realloc(*array, (2 * (*maxSize)) * sizeof(char));
-        *maxSize *= 2;
+static PhoneForward *compactCopy(Version const *version) {
+    Compaction compaction = {version->owner, newPhoneForward(false), NULL, 0, NULL, 0};
+    if (compaction.copy != NULL) {
+        // The size of the copied trie is counted by copyNode.
+        memset(&compaction.copy->trieSize, 0, sizeof(TrieSize));
+    }
+    bool copied = compaction.copy != NULL
+                  && copyNode(&compaction, compaction.copy->root, version->root, FORWARD_NODE)
+                  && copyNode(&compaction, compaction.copy->reverseRoot, version->reverseRoot, REVERSE_NODE);
+    // Nodes are added after the processed ones, so they are processed in the order of indices.
+    for (NodeId id = POOL_NONE + 1; copied && id < compaction.copy->nodes.nextIndex; id++) {
+        copied = copyChildren(&compaction, id);
+    }
+    free(compaction.kinds);
+    free(compaction.targets);
+    if (!copied) {
+        phfwdDelete(compaction.copy);
+        return NULL;
     }
+    return compaction.copy;
 }
 
-/** Function traverses through PhoneForward structure and searches for the forwardigns specified in
- * @ref phfwdReverse function. It allocates the @p pnum structure.
- * @param[in, out] st - a pointer to the stack helpful with traversing;
- * @param[in] node - a pointer to the root of PhoneForward stucture;
- * @param[in] num - a pointer to the number given in @ref phfwdReverse function;
- * @param[out] pnum - a pointer to the PhoneNumbers structure.
+/** Function copies a version whose reverse index can store forwardings of removed subtrees.
+ * Function adds the forwardings of the trie of the version to a new structure in the order
+ * of digits, so its reverse index is built again, and then compacts it.
+ * @param[in] version - a pointer to the copied version.
+ * @return A pointer to the copy or NULL if failed to allocate memory.
  */
-static void traversePhoneForward(Stack **st, PhoneForward const *node, char const *num, PhoneNumbers *pnum) {
-    size_t depth = 0;
-    char *newString = NULL;
-    char *newPrefix = calloc((depth + 1), sizeof(char));
-    if (newPrefix != NULL) {
-        size_t newPrefixSize = depth + 1;
-        PhoneForward *token = NULL;
-
-        while (!is_empty(*st)) {
-            node = top(*st);
-            pop(st);
-            if (node == NULL) {
-                depth--;
-            } else {
-                if (node->index != -1) {
-                    newPrefix[depth - 1] = digitToChar(node->index);
-                }
-                if (node->forward != NULL) {
-                    free(newString);
-                    newString = NULL;
-                    merge(&newString, newPrefix, depth, node->forward, num);
-                    if (newString != NULL) {
-                        addPhoneNumber(pnum, newString);
-                    }
-                }
-                if (node->numberOfNextDigits != 0) {
-                    depth++;
-                    safeRealloc(&newPrefix, depth, &newPrefixSize);
-                    push(st, token);
-                    int i = 0, k = 0;
-                    while (i < NUMBER_OF_DIGITS && node->numberOfNextDigits - k > 0) {
-                        if (node->nextDigitsArray[i] != NULL) {
-                            push(st, node->nextDigitsArray[i]);
-                            k++;
-                        }
-                        i++;
-                    }
-                }
+static PhoneForward *rebuildCopy(Version const *version) {
+    PhoneForward const *pf = version->owner;
+    PhoneForward *rebuilt = newPhoneForward(false);
+    if (rebuilt == NULL) {
+        return NULL;
+    }
+    TrieWalk walk;
+    char localTarget[WALK_LOCAL_PATH];
+    char *target = localTarget;
+    size_t targetSize = WALK_LOCAL_PATH;
+    walkInit(&walk, pf, version->root, "", 0, false);
+    NodeId id;
+    bool copied = true;
+    while (copied && (id = walkNext(&walk)) != POOL_NONE) {
+        uint32_t forward = nodeAt(pf, id)->forward;
+        if (forward != POOL_NONE) {
+            size_t length = forwardLength(pf, forward);
+            copied = reserveChars(&target, &targetSize, localTarget, 0, length + 1);
+            if (copied) {
+                copyForward(pf, forward, target);
+                copied = addForwarding(rebuilt, walk.digits, walk.length, target, length);
             }
         }
-        if (newString != NULL) {
-            free(newString);
-        }
-        free(newPrefix);
     }
-}
+    copied = copied && !walk.failed;
+    walkDestroy(&walk);
+    if (target != localTarget) {
+        free(target);
+    }
 
-PhoneNumbers *phfwdReverse(PhoneForward const *pf, char const *num) {
-    PhoneNumbers *pnum = pnumNew();
-    if (pf == NULL || pnum == NULL) {
-        phnumDelete(pnum);
-        return NULL;
-    } else {
-        if (length(num) == 0) {
-            addPhoneNumber(pnum, NULL);
-            return pnum;
-        }
-        Stack *st = newNode();
-        if (st == NULL) {
-            return NULL;
-        }
-        // Casting pf to non-const to use the stack.
-        PhoneForward *node = (PhoneForward *) pf;
-        push(&st, node);
-        traversePhoneForward(&st, pf, num, pnum);
-        removeStack(&st);
+    PhoneForward *copy = NULL;
+    if (copied) {
+        Version rebuiltVersion = readBegin(rebuilt);
+        copy = compactCopy(&rebuiltVersion);
+        readEnd(&rebuiltVersion);
+    }
+    phfwdDelete(rebuilt);
+    return copy;
+}
 
-        addPhoneNumber(pnum, num);
-        qsort(pnum->numbers, pnum->numbersCount, sizeof(char *), compare);
-        removeDuplicates(&(pnum->numbers), &(pnum->numbersCount));
-        return pnum;
+bool phfwdSave(PhoneForward const *pf, char const *path) {
+    if (pf == NULL || path == NULL) {
+        return false;
+    }
+    Version version = readBegin(pf);
+    PhoneForward *copy = version.stale ? rebuildCopy(&version) : compactCopy(&version);
+    readEnd(&version);
+    if (copy == NULL) {
+        return false;
     }
+    Pool *pools[STORE_SECTIONS];
+    sectionPools(copy, pools);
+    StoreInfo info = {copy->root, copy->reverseRoot, copy->trieSize.nodes, copy->trieSize.rules,
+                      copy->trieSize.bytes};
+    bool saved = storeSave(path, (Pool const *const *) pools, &info);
+    phfwdDelete(copy);
+    return saved;
 }
 
-PhoneNumbers *phfwdGetReverse(PhoneForward const *pf, char const *num) {
+PhoneForward *phfwdLoad(char const *path) {
+    if (path == NULL) {
+        return NULL;
+    }
+    PhoneForward *pf = allocPhoneForward(false);
     if (pf == NULL) {
         return NULL;
     }
-    PhoneNumbers *pnumReverse = phfwdReverse(pf, num);
-    PhoneNumbers *pnumGetReverse = pnumNew();
-    if (pnumGetReverse == NULL || pnumReverse == NULL) {
-        phnumDelete(pnumReverse);
+    // Pools are read from the file until the first change, see ownPools.
+    Pool *pools[STORE_SECTIONS];
+    sectionPools(pf, pools);
+    StoreInfo info;
+    pf->mapped = storeLoad(path, pools, &info, &pf->mappedSize);
+    if (pf->mapped == NULL) {
+        destroyPhoneForward(pf);
         return NULL;
     }
+    pf->root = info.root;
+    pf->reverseRoot = info.reverseRoot;
+    pf->targetsCount = pf->targets.nextIndex - 1;
+    pf->trieSize.nodes = info.nodes;
+    pf->trieSize.rules = info.rules;
+    pf->trieSize.bytes = info.nodeBytes;
+    return pf;
+}
 
-    PhoneNumbers *potentialNumber;
-    for (size_t i = 0; i < pnumReverse->numbersCount; i++) {
-        potentialNumber = phfwdGet(pf, phnumGet(pnumReverse, i));
-        if (potentialNumber != NULL) {
-            if (compareString(phnumGet(potentialNumber, 0), num) == 0) {
-                addPhoneNumber(pnumGetReverse, phnumGet(pnumReverse, i));
-            }
-        }
-        phnumDelete(potentialNumber);
+bool phfwdJournalOpen(PhoneForward *pf, char const *path, size_t syncBatch) {
+    if (pf == NULL || pf->origin != NULL || path == NULL) {
+        return false;
+    }
+    Journal *journal = journalOpen(path, syncBatch);
+    if (journal == NULL) {
+        return false;
+    }
+    writeBegin(pf);
+    bool opened = pf->journal == NULL;
+    if (opened) {
+        pf->journal = journal;
     }
+    writeEnd(pf);
+    if (!opened) {
+        journalClose(journal);
+    }
+    return opened;
+}
 
-    phnumDelete(pnumReverse);
+bool phfwdJournalSync(PhoneForward *pf) {
+    if (pf == NULL || pf->origin != NULL) {
+        return false;
+    }
+    writeBegin(pf);
+    bool synced = pf->journal != NULL && journalSync(pf->journal);
+    writeEnd(pf);
+    return synced;
+}
 
-    return pnumGetReverse;
+bool phfwdJournalClose(PhoneForward *pf) {
+    if (pf == NULL || pf->origin != NULL) {
+        return false;
+    }
+    writeBegin(pf);
+    Journal *journal = pf->journal;
+    pf->journal = NULL;
+    writeEnd(pf);
+    return journal != NULL && journalClose(journal);
 }
 
-void phnumDelete(PhoneNumbers *pnum) {
-    if (pnum != NULL) {
-        if (pnum->numbers != NULL) {
-            for (size_t i = 0; i < pnum->numbersCount; i++) {
-                if (pnum->numbers[i] != NULL) {
-                    free(pnum->numbers[i]);
-                }
-            }
-            free(pnum->numbers);
-        }
-        free(pnum);
+/** Function applies a record of a journal to a structure.
+ * The numbers of records are correct, so they are not checked and the changes are not
+ * written to the journal of the structure.
+ * @param[in, out] data - a pointer to the PhoneForward structure;
+ * @param[in] record - a pointer to the record.
+ * @return Value @p false if failed to allocate memory. Otherwise @p true.
+ */
+static bool applyRecord(void *data, JournalRecord const *record) {
+    PhoneForward *pf = data;
+    if (record->type == JOURNAL_ADD) {
+        return addForwarding(pf, record->num1, record->num1Size, record->num2, record->num2Size);
+    }
+    removeForwarding(pf, record->num1, record->num1Size);
+    return true;
+}
+
+bool phfwdJournalReplay(PhoneForward *pf, char const *path) {
+    if (pf == NULL || pf->origin != NULL || path == NULL) {
+        return false;
     }
+    // All records are one write, so in copying mode each node is copied at most once.
+    writeBegin(pf);
+    bool replayed = ownPools(pf) && journalReplay(path, applyRecord, pf);
+    reclaimRemoved(pf, REMOVED_NODES_PER_WRITE);
+    writeEnd(pf);
+    return replayed;
 }
 
-char const *phnumGet(PhoneNumbers const *pnum, size_t idx) {
-    if (pnum != NULL && idx < pnum->numbersCount) {
-        return pnum->numbers[idx];
-    } else {
-        return NULL;
+bool phfwdJournalCompact(PhoneForward *pf, char const *path) {
+    if (pf == NULL || pf->origin != NULL || path == NULL) {
+        return false;
     }
+    // The old file is replaced only by a complete one, and records already saved in it
+    // can be replayed again without changing the result. The journal is emptied only when
+    // the new file is stored on the disk, so after a crash one of the files has the changes.
+    writeBegin(pf);
+    bool compacted = pf->journal != NULL && phfwdSave(pf, path) && journalReset(pf->journal);
+    writeEnd(pf);
+    return compacted;
 }
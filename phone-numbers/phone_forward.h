@@ -23,6 +23,18 @@ typedef struct PhoneForward PhoneForward;
  */
 typedef struct PhoneNumbers PhoneNumbers;
 
+/**
+ * This is a structure that stores a checked phone number. Functions taking a view
+ * do not check the number again, so a number used many times should be given as a view.
+ * A NULL view is treated like a string that does not represent a number.
+ */
+typedef struct PhoneNumberView PhoneNumberView;
+
+/**
+ * This is a structure that stores a position in the ordered forwardings of a structure.
+ */
+typedef struct PhoneForwardIterator PhoneForwardIterator;
+
 /** @brief Creates a new structure.
  * Creates a new structure containing no redirections.
  * @return A pointer to the created structure, or NULL if failed to
@@ -30,13 +42,128 @@ typedef struct PhoneNumbers PhoneNumbers;
  */
 PhoneForward *phfwdNew(void);
 
+/** @brief Creates a new structure shared by threads.
+ * Creates a new structure containing no redirections, which can be used by many threads
+ * at the same time. Functions that only read the structure (@ref phfwdGet, @ref phfwdGetInto,
+ * @ref phfwdGetBatch, @ref phfwdResolve, @ref phfwdReverse, @ref phfwdGetReverse and their
+ * variants taking views) take no lock and see the structure as it was after some completed call of @ref phfwdAdd or @ref phfwdRemove.
+ * These calls and @ref phfwdSnapshot are serialized with each other. At most 64 threads read
+ * the structure at the same time, the next ones wait. @ref phfwdDelete can not be called
+ * while the structure is used.
+ * @return A pointer to the created structure, or NULL if failed to
+ * allocate memory.
+ */
+PhoneForward *phfwdNewConcurrent(void);
+
 /** @brief Deletes the structure.
  * Deletes the structure pointed to by @p pf. Does nothing if this pointer has a
- * NULL value.
+ * NULL value. A structure and its snapshots can be deleted in any order, the memory
+ * shared by them is freed with the last of them.
  * @param[in] pf - pointer to the structure to be removed.
  */
 void phfwdDelete(PhoneForward *pf);
 
+/** @brief Creates a snapshot of the structure.
+ * Creates a read-only structure that stores the redirections of @p pf as they are now.
+ * Later changes of @p pf do not change the snapshot. The snapshot shares the unchanged part
+ * of memory with @p pf, so each change of @p pf made while the snapshot exists takes memory
+ * proportional to the length of the changed numbers. The snapshot is read by @ref phfwdGet,
+ * @ref phfwdGetInto, @ref phfwdGetBatch, @ref phfwdResolve, @ref phfwdReverse and @ref phfwdGetReverse,
+ * @ref phfwdAdd and @ref phfwdRemove do not change it. It has to be deleted with @ref phfwdDelete.
+ * The snapshot is created in constant time, apart from the first snapshot of a structure
+ * created by @ref phfwdNew, which takes time proportional to the size of @p pf.
+ * @param[in,out] pf - a pointer to a structure storing the redirections or its snapshot.
+ * @return A pointer to the snapshot, or NULL if @p pf is NULL or failed to allocate memory.
+ */
+PhoneForward *phfwdSnapshot(PhoneForward *pf);
+
+/** @brief Saves the structure to a file.
+ * Writes the redirections of @p pf to the file @p path in a compact binary format, which
+ * can be read by @ref phfwdLoad on a machine with the same byte order. The structure is written
+ * to a temporary file, @p path followed by ".tmp", which replaces the file @p path only when
+ * it is complete and stored on the disk, so a failed save leaves an existing file unchanged
+ * and structures loaded from it can still read it. A structure in concurrent mode can be changed by other threads while it is
+ * saved, then the file stores the version that was published when saving started.
+ * @param[in] pf - a pointer to a structure storing the redirections or its snapshot;
+ * @param[in] path - the name of the file.
+ * @return Value @p true if the file has been written. Value @p false if @p pf or @p path
+ * is NULL, the file could not be written or the function failed to allocate memory.
+ */
+bool phfwdSave(PhoneForward const *pf, char const *path);
+
+/** @brief Loads a structure from a file.
+ * Creates a structure storing the redirections saved by @ref phfwdSave. The file is mapped
+ * to memory and read on demand, so loading takes time proportional to the size of the file
+ * only to check its checksum. The structure is read from the file until it is first changed
+ * by @ref phfwdAdd, @ref phfwdRemove or @ref phfwdSnapshot, which copy it to memory first.
+ * The file should not be changed until then. The structure is not in concurrent mode and
+ * it has to be deleted with @ref phfwdDelete.
+ * @param[in] path - the name of the file.
+ * @return A pointer to the created structure, or NULL if @p path is NULL, the file can not
+ * be read, was not written by @ref phfwdSave in this format or has been damaged.
+ */
+PhoneForward *phfwdLoad(char const *path);
+
+/** @brief Starts writing changes of the structure to a journal.
+ * Each later change made by @ref phfwdAdd, @ref phfwdRemove or their view variants is
+ * appended to the file @p path, so the structure can be restored by @ref phfwdLoad of the last
+ * saved structure and @ref phfwdJournalReplay. Changes are stored on the disk in groups of
+ * @p syncBatch, so a crash loses at most @p syncBatch - 1 last changes. If the file exists,
+ * changes are appended after its records. A change that can not be written does not make
+ * the change fail, it is reported by @ref phfwdJournalSync and @ref phfwdJournalClose.
+ * @param[in,out] pf - a pointer to a structure storing the redirections;
+ * @param[in] path - the name of the journal;
+ * @param[in] syncBatch - the number of changes stored on the disk at once, 0 if they are
+ * stored only by @ref phfwdJournalSync and when the journal is closed.
+ * @return Value @p true if the journal has been opened. Value @p false if @p pf or @p path
+ * is NULL, @p pf is a snapshot or already has a journal, the file can not be opened or is not
+ * a journal, or the function failed to allocate memory.
+ */
+bool phfwdJournalOpen(PhoneForward *pf, char const *path, size_t syncBatch);
+
+/** @brief Stores the journal on the disk.
+ * Waits until all changes appended to the journal of @p pf are stored on the disk.
+ * @param[in,out] pf - a pointer to a structure storing the redirections.
+ * @return Value @p true if all changes have been stored. Value @p false if @p pf is NULL,
+ * has no journal or any change could not be written.
+ */
+bool phfwdJournalSync(PhoneForward *pf);
+
+/** @brief Stops writing changes of the structure to a journal.
+ * Stores the journal on the disk like @ref phfwdJournalSync and closes it. The journal is
+ * also closed by @ref phfwdDelete.
+ * @param[in,out] pf - a pointer to a structure storing the redirections.
+ * @return Value @p true if all changes have been stored. Value @p false if @p pf is NULL,
+ * has no journal or any change could not be written.
+ */
+bool phfwdJournalClose(PhoneForward *pf);
+
+/** @brief Applies the changes stored in a journal.
+ * Changes the structure as the changes written to the journal @p path did, in the same order.
+ * It is faster than calling @ref phfwdAdd and @ref phfwdRemove, because the numbers are not
+ * checked again and all changes are one write. Changes are not appended to the journal of
+ * @p pf. Reading stops at a damaged record at the end of the file, left by a crash.
+ * @param[in,out] pf - a pointer to a structure storing the redirections;
+ * @param[in] path - the name of the journal.
+ * @return Value @p true if the changes have been applied. Value @p false if @p pf or
+ * @p path is NULL, @p pf is a snapshot, the file can not be read or is not a journal,
+ * or the function failed to allocate memory.
+ */
+bool phfwdJournalReplay(PhoneForward *pf, char const *path);
+
+/** @brief Saves the structure and clears its journal.
+ * Saves @p pf to the file @p path like @ref phfwdSave and removes all changes from
+ * the journal of @p pf. The journal is cleared only when the new file and its name are
+ * stored on the disk, and replaying changes already included in it does not change the result, so a crash
+ * never loses changes.
+ * @param[in,out] pf - a pointer to a structure storing the redirections;
+ * @param[in] path - the name of the saved file.
+ * @return Value @p true if the structure has been saved. Value @p false if @p pf or
+ * @p path is NULL, @p pf has no journal, the files could not be written or the function
+ * failed to allocate memory.
+ */
+bool phfwdJournalCompact(PhoneForward *pf, char const *path);
+
 /** @brief Adds redirection.
  * Adds a redirection of all numbers having the prefix @p num1, to numbers
  * with that prefix replaced with the @p num2 prefix, respectively. Each number
@@ -51,20 +178,75 @@ void phfwdDelete(PhoneForward *pf);
  * to which the forwarding is made.
  * @return Value @p true if the redirection has been added.
  * Value @p false if an error occurred, e.g. the given string does not
- * represents a number, the two specified numbers are identical, @p pf is NULL or the function
- * failed to allocate memory.
+ * represents a number, the two specified numbers are identical, @p pf is NULL or a snapshot
+ * or the function failed to allocate memory.
  */
 bool phfwdAdd(PhoneForward *pf, char const *num1, char const *num2);
 
+/**
+ * The structure stores a redirection added by @ref phfwdAddBulk.
+ */
+typedef struct PhoneForwardRule {
+    /**@{*/
+    char const *num1; /**< The prefix of the numbers redirected. */
+    char const *num2; /**< The prefix of the numbers, to which the forwarding is made. */
+    /**@}*/
+} PhoneForwardRule;
+
+/** @brief Adds many redirections at once.
+ * Works like calling @ref phfwdAdd for each element of @p rules in order, so a later
+ * redirection of the same @p num1 replaces an earlier one, and incorrect redirections are
+ * skipped. The redirections are sorted, unless they are already sorted by @p num1, and when
+ * @p pf stores no redirections, the trie is built at once in many threads with the nodes
+ * stored in the order of traversal. Otherwise the sorted redirections are added one by one.
+ * @param[in,out] pf - a pointer to a structure storing the redirection numbers;
+ * @param[in] rules - a pointer to the array of redirections;
+ * @param[in] count - the number of redirections.
+ * @return Value @p true if all correct redirections have been added. Value @p false if
+ * @p pf is NULL or a snapshot, @p rules is NULL and @p count is not 0, or the function failed
+ * to allocate memory. Then only some of the redirections may have been added.
+ */
+bool phfwdAddBulk(PhoneForward *pf, PhoneForwardRule const *rules, size_t count);
+
+/** @brief Adds redirection given by views.
+ * Works like @ref phfwdAdd.
+ * @param[in,out] pf - a pointer to a structure storing the redirection numbers;
+ * @param[in] num1 - a pointer to the view of the prefix of the numbers redirected;
+ * @param[in] num2 - a pointer to the view of the prefix, to which the forwarding is made.
+ * @return The same value as @ref phfwdAdd.
+ */
+bool phfwdAddView(PhoneForward *pf, PhoneNumberView const *num1, PhoneNumberView const *num2);
+
 /** @brief Removes redirections.
  * Removes all redirections where the @p num parameter is a prefix
  * of the @p num1 parameter used when adding. If there are no such redirects,
- * @p pf is NULL or the string does not represent a number, it does nothing.
+ * @p pf is NULL or a snapshot or the string does not represent a number, it does nothing.
+ * The redirections are detached in time proportional to the length of @p num, and their
+ * memory is freed by the following changes of @p pf, a bounded part by each of them,
+ * or by @ref phfwdReclaim.
  * @param[in,out] pf - a pointer to a structure that stores phone forwarding;
  * @param[in] num - a pointer to the string representing the number prefix.
  */
 void phfwdRemove(PhoneForward *pf, char const *num);
 
+/** @brief Removes redirections given by a view.
+ * Works like @ref phfwdRemove.
+ * @param[in,out] pf - a pointer to a structure that stores phone forwarding;
+ * @param[in] num - a pointer to the view of the number prefix.
+ */
+void phfwdRemoveView(PhoneForward *pf, PhoneNumberView const *num);
+
+/** @brief Frees memory of removed redirections.
+ * Frees at most @p nodes nodes of the redirections removed by @ref phfwdRemove, which
+ * are otherwise freed a bounded part at a time by the following changes. In concurrent
+ * mode it takes the lock of writers, so it can be called by a background thread.
+ * @param[in,out] pf - a pointer to a structure that stores phone forwarding;
+ * @param[in] nodes - the maximal number of freed nodes.
+ * @return Value @p true if some removed redirections are still not freed. Value @p false
+ * if all of them have been freed or @p pf is NULL or a snapshot.
+ */
+bool phfwdReclaim(PhoneForward *pf, size_t nodes);
+
 /** @brief Calculates the forwarding of the number.
  * Calculates the forwarding of the specified number. Looks for the longest matching
  * prefix for the forwarding of @p num. The result is a string containing at most one number. If a given
@@ -80,6 +262,147 @@ void phfwdRemove(PhoneForward *pf, char const *num);
  */
 PhoneNumbers *phfwdGet(PhoneForward const *pf, char const *num);
 
+/** @brief Calculates the forwarding of a number given by a view.
+ * Works like @ref phfwdGet.
+ * @param[in] pf - a pointer to a structure that stores number redirections;
+ * @param[in] num - a pointer to the view of the number.
+ * @return The same value as @ref phfwdGet.
+ */
+PhoneNumbers *phfwdGetView(PhoneForward const *pf, PhoneNumberView const *num);
+
+/** @brief Calculates the forwarding of the number into a given buffer.
+ * Calculates the same number as @ref phfwdGet, but writes it, followed by '\0',
+ * to the memory given by the caller instead of allocating any structure.
+ * If the result does not fit in @p buf, nothing is written, but the length of the
+ * result is still stored in @p len, so the call can be repeated with a larger buffer.
+ * @param[in] pf - a pointer to a structure that stores number redirections;
+ * @param[in] num - a pointer to a string representing a number;
+ * @param[out] buf - a pointer to the buffer for the result;
+ * @param[in] cap - the size of @p buf in bytes;
+ * @param[out] len - a pointer to the length of the result without '\0', it is set to 0
+ * if @p num does not represent a number. It can be NULL.
+ * @return Value @p true if the result has been written to @p buf.
+ * Value @p false if @p pf is NULL, @p num does not represent a number or
+ * @p cap is not larger than the length of the result.
+ */
+bool phfwdGetInto(PhoneForward const *pf, char const *num, char *buf, size_t cap, size_t *len);
+
+/** @brief Calculates the forwarding of a number given by a view into a given buffer.
+ * Works like @ref phfwdGetInto.
+ * @param[in] pf - a pointer to a structure that stores number redirections;
+ * @param[in] num - a pointer to the view of the number;
+ * @param[out] buf - a pointer to the buffer for the result;
+ * @param[in] cap - the size of @p buf in bytes;
+ * @param[out] len - a pointer to the length of the result without '\0' or NULL.
+ * @return The same value as @ref phfwdGetInto.
+ */
+bool phfwdGetIntoView(PhoneForward const *pf, PhoneNumberView const *num, char *buf, size_t cap, size_t *len);
+
+/** @brief Follows the forwardings of a number to the end.
+ * Forwarding is not transitive, so @ref phfwdGet forwards a number once. This function
+ * forwards the result again, as long as it has a forwarded prefix, and returns the last
+ * number of the chain, which is @p num itself if it is not forwarded. The whole chain is
+ * read from one version of the structure. If the chain comes back to one of its numbers,
+ * or the last number is not reached after @p maxHops forwardings, the result contains no
+ * number, as if @p num did not represent a number. Chains that make numbers longer never end,
+ * so @p maxHops also limits the time of the call. The time of the call depends on the cache:
+ * without it, in concurrent mode or while the structure has snapshots, every call follows
+ * the whole chain at the cost of one lookup per forwarding. With the cache enabled by
+ * @ref phfwdCacheEnable, the chain is cached for the longest forwarded prefix of the number and
+ * shared by all numbers starting with it, so they cost about one lookup until a forwarding on
+ * the chain changes. If later numbers of the chain are forwarded depending on the digits
+ * following the prefix, the chain is cached only for the whole number.
+ * Allocates the @p PhoneNumbers structure, which must be freed using the @ref phnumDelete function.
+ * @param[in] pf - a pointer to a structure that stores number redirections;
+ * @param[in] num - a pointer to a string representing a number;
+ * @param[in] maxHops - the maximal number of forwardings of the chain.
+ * @return A pointer to a structure storing at most one number or NULL when failed to allocate
+ * memory. NULL if @p pf is NULL.
+ */
+PhoneNumbers *phfwdResolve(PhoneForward const *pf, char const *num, size_t maxHops);
+
+/** @brief Follows the forwardings of a number given by a view to the end.
+ * Works like @ref phfwdResolve.
+ * @param[in] pf - a pointer to a structure that stores number redirections;
+ * @param[in] num - a pointer to the view of the number;
+ * @param[in] maxHops - the maximal number of forwardings of the chain.
+ * @return The same value as @ref phfwdResolve.
+ */
+PhoneNumbers *phfwdResolveView(PhoneForward const *pf, PhoneNumberView const *num, size_t maxHops);
+
+/**
+ * This is a structure that stores the counters of the cache of results of @ref phfwdGet.
+ */
+typedef struct PhoneForwardCacheStats {
+    /**@{*/
+    size_t hits; /**< The number of results read from the cache. */
+    size_t misses; /**< The number of results calculated from the trie, with the invalidated ones. */
+    size_t evictions; /**< The number of results removed because the cache was full. */
+    size_t invalidations; /**< The number of results removed because their forwardings changed. */
+    size_t entries; /**< The number of stored results. */
+    size_t capacity; /**< The maximal number of stored results, 0 if the cache is disabled. */
+    /**@}*/
+} PhoneForwardCacheStats;
+
+/** @brief Enables the cache of results of @ref phfwdGet.
+ * Results of @ref phfwdGet, @ref phfwdGetInto and @ref phfwdResolve are kept for at most
+ * @p capacity numbers, the least recently used one is removed first. A result stays in the cache
+ * until a forwarding is added or removed on the path of its number in the trie, or of any number
+ * of its chain, so changes of other prefixes do not remove it. Bulk loads into an empty structure
+ * clear the cache. Numbers and results longer than @ref CACHE_NUMBER_LENGTH digits, 255, bypass
+ * the cache, as do results depending on more than @ref CACHE_PATH_SIZE nodes. Reads use the cache
+ * only while the structure has no snapshots. With the cache enabled reads change
+ * the structure, so one structure can not be read by many threads at the same time.
+ * Enabling the cache again changes its capacity and removes the stored results.
+ * @param[in, out] pf - a pointer to a structure that stores number redirections;
+ * @param[in] capacity - the maximal number of stored results, 0 disables the cache.
+ * @return Value @p false if @p pf is NULL, a snapshot or in concurrent mode, or failed
+ * to allocate memory, then the cache is disabled. Otherwise @p true.
+ */
+bool phfwdCacheEnable(PhoneForward *pf, size_t capacity);
+
+/** @brief Reads the counters of the cache of results.
+ * The counters are kept when the capacity of the cache changes.
+ * @param[in] pf - a pointer to a structure that stores number redirections;
+ * @param[out] stats - a pointer to the counters, they are 0 if the cache has never been enabled.
+ * @return Value @p false if @p pf or @p stats is NULL. Otherwise @p true.
+ */
+bool phfwdCacheStats(PhoneForward const *pf, PhoneForwardCacheStats *stats);
+
+/** @brief Calculates the forwardings of many numbers.
+ * Calculates the result of @ref phfwdGet for each of @p count numbers. The results are written
+ * one after another, each followed by '\0', to the buffer @p buf, and the result for @p nums[i]
+ * starts at @p buf + @p offsets[i]. An incorrect number gives an empty string.
+ * The numbers are resolved together, so it is faster than calling @ref phfwdGet for each of them,
+ * especially when @p nums is sorted.
+ * @param[in] pf - a pointer to a structure that stores number redirections;
+ * @param[in] nums - an array of pointers to strings representing numbers;
+ * @param[in] count - the number of elements of @p nums;
+ * @param[out] buf - a pointer to the buffer for the results;
+ * @param[in] cap - the size of @p buf in bytes;
+ * @param[out] offsets - an array of @p count positions of the results in @p buf;
+ * @param[out] len - a pointer to the number of bytes needed to store all results. It can be NULL.
+ * @return Value @p true if all results have been written to @p buf.
+ * Value @p false if @p pf, @p nums or @p offsets is NULL, the function failed to allocate
+ * memory (then @p len is set to 0) or @p cap is smaller than the size of the results.
+ */
+bool phfwdGetBatch(PhoneForward const *pf, char const *const *nums, size_t count, char *buf, size_t cap,
+                   size_t *offsets, size_t *len);
+
+/** @brief Calculates the forwardings of many numbers given by views.
+ * Works like @ref phfwdGetBatch.
+ * @param[in] pf - a pointer to a structure that stores number redirections;
+ * @param[in] nums - an array of pointers to views of the numbers;
+ * @param[in] count - the number of elements of @p nums;
+ * @param[out] buf - a pointer to the buffer for the results;
+ * @param[in] cap - the size of @p buf in bytes;
+ * @param[out] offsets - an array of @p count positions of the results in @p buf;
+ * @param[out] len - a pointer to the number of bytes needed to store all results. It can be NULL.
+ * @return The same value as @ref phfwdGetBatch.
+ */
+bool phfwdGetBatchView(PhoneForward const *pf, PhoneNumberView const *const *nums, size_t count, char *buf,
+                       size_t cap, size_t *offsets, size_t *len);
+
 /** @brief Calculates the redirections to a given number.
  * Returns the following sequence of numbers: if there is a number @p x that has been forwarded to
  * any prefix of @p num, then the result of a call @ref phfwdReverse with number @p num contains
@@ -95,6 +418,14 @@ PhoneNumbers *phfwdGet(PhoneForward const *pf, char const *num);
 */
 PhoneNumbers *phfwdReverse(PhoneForward const *pf, char const *num);
 
+/** @brief Calculates the redirections to a number given by a view.
+ * Works like @ref phfwdReverse.
+ * @param[in] pf - a pointer to a structure that stores number redirections;
+ * @param[in] num - a pointer to the view of the number.
+ * @return The same value as @ref phfwdReverse.
+ */
+PhoneNumbers *phfwdReverseView(PhoneForward const *pf, PhoneNumberView const *num);
+
 /** @brief Function determines the counter image of the function @ref phfwdGet.
  * Returns the sequence of sorted lexicographically numbers @p x, that the result
  * of @ref phfwdGet(@p x) = @p num. Function allocates the structure of
@@ -109,6 +440,103 @@ PhoneNumbers *phfwdReverse(PhoneForward const *pf, char const *num);
  */
 PhoneNumbers *phfwdGetReverse(PhoneForward const *pf, char const *num);
 
+/** @brief Determines the counter image of the function @ref phfwdGet for a number given by a view.
+ * Works like @ref phfwdGetReverse.
+ * @param[in] pf - a pointer to a structure that stores number redirections;
+ * @param[in] num - a pointer to the view of the number.
+ * @return The same value as @ref phfwdGetReverse.
+ */
+PhoneNumbers *phfwdGetReverseView(PhoneForward const *pf, PhoneNumberView const *num);
+
+/**
+ * A macro that stores the number of depths counted separately by @ref phfwdStats,
+ * deeper nodes are counted together with the last of them.
+ */
+#define PHFWD_STATS_DEPTHS 32
+
+/**
+ * A macro that stores the number of possible numbers of children of a node.
+ */
+#define PHFWD_STATS_FAN_OUTS 13
+
+/**
+ * This is a structure that stores the size and the shape of a structure.
+ */
+typedef struct PhoneForwardStats {
+    /**@{*/
+    size_t nodes; /**< The number of nodes of the trie of forwarded prefixes. */
+    size_t rules; /**< The number of forwardings. */
+    size_t targets; /**< The number of different prefixes to which numbers are forwarded. */
+    size_t nodeBytes; /**< Bytes of the nodes of the trie and of their arrays of children. */
+    size_t forwardBytes; /**< Bytes storing the prefixes to which numbers are forwarded. */
+    size_t totalBytes; /**< Bytes of memory of the structure, with the reverse index and unused space. */
+    size_t depths[PHFWD_STATS_DEPTHS]; /**< Numbers of nodes of the trie by their depth, the root has 0. */
+    size_t fanOuts[PHFWD_STATS_FAN_OUTS]; /**< Numbers of nodes of the trie by the number of their children. */
+    size_t longestChain; /**< The largest number of consecutive nodes of a path that have one child. */
+    /**@}*/
+} PhoneForwardStats;
+
+/** @brief Describes the size and the shape of the structure.
+ * Reads the numbers of nodes, forwardings and bytes, which are kept up to date by changes
+ * of the structure, so it takes constant time and can be called periodically. Nodes and
+ * forwardings of a prefix removed by @ref phfwdRemove are counted until they are freed
+ * by later changes or @ref phfwdReclaim. If @p shape is @p true, also counts the nodes of
+ * the trie storing forwarded prefixes by their depth and number of children, walking the trie
+ * once in time proportional to the number of its nodes. Otherwise @p depths, @p fanOuts and
+ * @p longestChain are 0. A structure in concurrent mode is not blocked by the walk.
+ * For a snapshot @p targets and the numbers of bytes, apart from @p nodeBytes, describe its
+ * structure, with which the snapshot shares the memory.
+ * @param[in] pf - a pointer to a structure that stores number redirections or its snapshot;
+ * @param[out] stats - a pointer to the description;
+ * @param[in] shape - a boolean informing if the nodes are counted by their depth and number of children.
+ * @return Value @p false if @p pf or @p stats is NULL or failed to allocate memory.
+ * Otherwise @p true.
+ */
+bool phfwdStats(PhoneForward const *pf, PhoneForwardStats *stats, bool shape);
+
+/** @brief Starts listing forwardings.
+ * Creates an iterator over the forwardings of prefixes starting with @p prefix. They are
+ * returned in the order of digits, where '*' follows '9' and '#' follows '*', so a prefix
+ * comes before its extensions. The iterator reads the version of the structure current at
+ * this call. A structure that is not concurrent can not be changed until the iterator is
+ * deleted, so a long listing should be split into pages: the last @p num1 of a page is
+ * copied, the iterator deleted, and the next page is started with @ref phfwdIterSeek.
+ * Steps of the iterator do not allocate memory unless the numbers are very long.
+ * @param[in] pf - a pointer to a structure that stores number redirections or its snapshot;
+ * @param[in] prefix - a pointer to the prefix of the listed numbers, all forwardings are listed
+ * if it is NULL or empty.
+ * @return A pointer to the iterator, or NULL if @p pf is NULL, @p prefix does not represent
+ * a number or failed to allocate memory.
+ */
+PhoneForwardIterator *phfwdIterBegin(PhoneForward const *pf, char const *prefix);
+
+/** @brief Returns the next forwarding.
+ * Returned strings belong to the iterator and are valid until its next call.
+ * @param[in, out] it - a pointer to the iterator;
+ * @param[out] num1 - a pointer to the forwarded prefix;
+ * @param[out] num2 - a pointer to the prefix to which it is forwarded.
+ * @return Value @p true if a forwarding has been returned. Value @p false if @p it, @p num1
+ * or @p num2 is NULL, there are no more forwardings or failed to allocate memory.
+ */
+bool phfwdIterNext(PhoneForwardIterator *it, char const **num1, char const **num2);
+
+/** @brief Moves the iterator after a number.
+ * The next forwarding returned by @ref phfwdIterNext is the first one whose prefix
+ * follows @p key in the order of the iterator. The key does not have to be forwarded.
+ * @param[in, out] it - a pointer to the iterator;
+ * @param[in] key - a pointer to the number, usually the last prefix of the previous page.
+ * @return Value @p false if @p it is NULL, @p key does not represent a number or failed
+ * to allocate memory. Otherwise @p true.
+ */
+bool phfwdIterSeek(PhoneForwardIterator *it, char const *key);
+
+/** @brief Deletes the iterator.
+ * Deletes the iterator pointed to by @p it and releases the version of the structure it reads.
+ * Does nothing if this pointer has a NULL value.
+ * @param[in] it - a pointer to the iterator being removed.
+ */
+void phfwdIterEnd(PhoneForwardIterator *it);
+
 /** @brief Deletes the structure.
  * Deletes the structure indicated by @p pnum. Does nothing if this pointer has a
  * NULL value.
@@ -118,7 +546,8 @@ void phnumDelete(PhoneNumbers *pnum);
 
 /** @brief Returns a number.
 * Returns a pointer to the string representing the number. The captions are indexed
- * sequentially from zero.
+ * sequentially from zero. Numbers are stored compactly and each of them is converted
+ * to a string on its first call, so one structure can not be read by many threads at the same time.
  * @param[in] pnum - a pointer to a structure that stores a string of phone numbers;
  * @param[in] idx - an index of the phone number.
  * @return A pointer to a string representing the phone number. NULL value if
@@ -126,6 +555,22 @@ void phnumDelete(PhoneNumbers *pnum);
 */
 char const *phnumGet(PhoneNumbers const *pnum, size_t idx);
 
+/** @brief Creates a view of a number.
+ * Checks if @p num represents a number and stores its length and digits, so the functions
+ * taking the view do not check it again. The view points to @p num, which can not be changed
+ * or freed while the view is used. The view has to be deleted with @ref phnumViewDelete.
+ * @param[in] num - a pointer to a string representing a number.
+ * @return A pointer to the view, or NULL if @p num does not represent a number or failed
+ * to allocate memory.
+ */
+PhoneNumberView *phnumViewNew(char const *num);
+
+/** @brief Deletes a view.
+ * Deletes the view pointed to by @p view. Does nothing if this pointer has a NULL value.
+ * @param[in] view - pointer to the view being removed.
+ */
+void phnumViewDelete(PhoneNumberView *view);
+
 /**
  * This is an auxiliary function that converts a char containing a digit
  * to the corresponding int. Character "*" represents 10, and "#" represents 11.
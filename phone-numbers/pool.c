@@ -0,0 +1,149 @@
+/** @file
+ * The main module of a class that implements a pool of fixed-size elements
+ *
+ * @author Emilia Dębicka <ed438406@students.mimuw.edu.pl>
+ * @copyright University of Warsaw
+ * @date 2022
+ */
+
+#include "pool.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * A macro that stores the number of elements that fit in all slabs.
+ */
+#define POOL_CAPACITY ((uint32_t) (((uint64_t) POOL_FIRST_SLAB_SIZE << POOL_MAX_SLABS) - POOL_FIRST_SLAB_SIZE))
+
+void poolInit(Pool *pool, size_t elementSize) {
+    for (int i = 0; i < POOL_MAX_SLABS; i++) {
+        pool->slabs[i] = NULL;
+    }
+    pool->elementSize = elementSize;
+    // The index 0 is never given, so it can describe no element.
+    pool->nextIndex = 1;
+    pool->freeIndex = POOL_NONE;
+    pool->count = 0;
+    pool->borrowed = false;
+}
+
+/** Function returns the index of the first element of a slab.
+ * @param[in] slab - the number of the slab.
+ * @return The index of the first element stored in the slab.
+ */
+static inline uint64_t slabBegin(int slab) {
+    return ((uint64_t) POOL_FIRST_SLAB_SIZE << slab) - POOL_FIRST_SLAB_SIZE;
+}
+
+void poolAttach(Pool *pool, size_t elementSize, char *elements, uint32_t count) {
+    // Consecutive slabs store consecutive indices, so they can be parts of one array.
+    for (int i = 0; i < POOL_MAX_SLABS; i++) {
+        pool->slabs[i] = slabBegin(i) < count ? elements + slabBegin(i) * elementSize : NULL;
+    }
+    pool->elementSize = elementSize;
+    pool->nextIndex = count;
+    pool->freeIndex = POOL_NONE;
+    pool->count = count - 1;
+    pool->borrowed = true;
+}
+
+bool poolOwn(Pool *pool) {
+    if (!pool->borrowed) {
+        return true;
+    }
+    char *slabs[POOL_MAX_SLABS];
+    for (int i = 0; i < POOL_MAX_SLABS; i++) {
+        slabs[i] = NULL;
+        if (pool->slabs[i] != NULL) {
+            slabs[i] = malloc(((size_t) POOL_FIRST_SLAB_SIZE << i) * pool->elementSize);
+            if (slabs[i] == NULL) {
+                for (int j = 0; j < i; j++) {
+                    free(slabs[j]);
+                }
+                return false;
+            }
+        }
+    }
+
+    // Only the last slab can be filled partially.
+    for (int i = 0; i < POOL_MAX_SLABS && pool->slabs[i] != NULL; i++) {
+        uint64_t end = slabBegin(i + 1) < pool->nextIndex ? slabBegin(i + 1) : pool->nextIndex;
+        memcpy(slabs[i], pool->slabs[i], (end - slabBegin(i)) * pool->elementSize);
+        pool->slabs[i] = slabs[i];
+    }
+    pool->borrowed = false;
+    return true;
+}
+
+uint32_t poolAlloc(Pool *pool) {
+    uint32_t index = pool->freeIndex;
+    if (index != POOL_NONE) {
+        memcpy(&pool->freeIndex, poolGet(pool, index), sizeof(uint32_t));
+        pool->count++;
+        return index;
+    }
+    if (pool->nextIndex == POOL_CAPACITY) {
+        return POOL_NONE;
+    }
+
+    index = pool->nextIndex;
+    uint64_t position = (uint64_t) index + POOL_FIRST_SLAB_SIZE;
+    int slab = 63 - __builtin_clzll(position) - POOL_FIRST_SLAB_BITS;
+    if (pool->slabs[slab] == NULL) {
+        pool->slabs[slab] = malloc(((size_t) POOL_FIRST_SLAB_SIZE << slab) * pool->elementSize);
+        if (pool->slabs[slab] == NULL) {
+            return POOL_NONE;
+        }
+    }
+    pool->nextIndex++;
+    pool->count++;
+    return index;
+}
+
+uint32_t poolAllocRange(Pool *pool, uint32_t count) {
+    if (count > POOL_CAPACITY - pool->nextIndex) {
+        return POOL_NONE;
+    }
+    uint64_t end = (uint64_t) pool->nextIndex + count;
+    for (int i = 0; i < POOL_MAX_SLABS && slabBegin(i) < end; i++) {
+        if (pool->slabs[i] == NULL) {
+            pool->slabs[i] = malloc(((size_t) POOL_FIRST_SLAB_SIZE << i) * pool->elementSize);
+            if (pool->slabs[i] == NULL) {
+                return POOL_NONE;
+            }
+        }
+    }
+    uint32_t index = pool->nextIndex;
+    pool->nextIndex += count;
+    pool->count += count;
+    return index;
+}
+
+void poolFree(Pool *pool, uint32_t index) {
+    memcpy(poolGet(pool, index), &pool->freeIndex, sizeof(uint32_t));
+    pool->freeIndex = index;
+    pool->count--;
+}
+
+size_t poolMemory(Pool const *pool) {
+    size_t memory = 0;
+    for (int i = 0; i < POOL_MAX_SLABS && !pool->borrowed; i++) {
+        if (pool->slabs[i] != NULL) {
+            memory += ((size_t) POOL_FIRST_SLAB_SIZE << i) * pool->elementSize;
+        }
+    }
+    return memory;
+}
+
+void poolDestroy(Pool *pool) {
+    for (int i = 0; i < POOL_MAX_SLABS; i++) {
+        if (!pool->borrowed) {
+            free(pool->slabs[i]);
+        }
+        pool->slabs[i] = NULL;
+    }
+    pool->nextIndex = 1;
+    pool->freeIndex = POOL_NONE;
+    pool->count = 0;
+    pool->borrowed = false;
+}
@@ -0,0 +1,141 @@
+/** @file
+ * An interface for a class implementing a pool of fixed-size elements
+ *
+ * @author Emilia Dębicka <ed438406@students.mimuw.edu.pl>
+ * @copyright University of Warsaw
+ * @date 2022
+ */
+
+#ifndef __POOL_H__
+#define __POOL_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A macro that stores the binary logarithm of the number of elements in the first slab.
+ */
+#define POOL_FIRST_SLAB_BITS 6
+
+/**
+ * A macro that stores the number of elements in the first slab. Each next slab
+ * is twice as big as the previous one.
+ */
+#define POOL_FIRST_SLAB_SIZE (1u << POOL_FIRST_SLAB_BITS)
+
+/**
+ * A macro that informs how many slabs are needed to store every 32-bit index.
+ */
+#define POOL_MAX_SLABS (32 - POOL_FIRST_SLAB_BITS)
+
+/**
+ * A macro that stores the index that does not describe any element.
+ */
+#define POOL_NONE 0
+
+/**
+ * This is a structure of a pool. Elements are addressed by 32-bit indices and
+ * stored in slabs, which are never moved, so pointers to the elements stay
+ * valid until the elements are freed. The slab number @p k stores
+ * @ref POOL_FIRST_SLAB_SIZE * 2^@p k elements.
+ */
+typedef struct Pool {
+    char *slabs[POOL_MAX_SLABS]; /**< An array of slabs, NULL if a slab is not allocated. */
+    size_t elementSize; /**< The size of one element in bytes, at least 4. */
+    uint32_t nextIndex; /**< The smallest index that has never been allocated. */
+    uint32_t freeIndex; /**< The first element of the list of freed elements. */
+    uint32_t count; /**< The number of allocated elements that have not been freed. */
+    bool borrowed; /**< A boolean informing if the slabs are parts of memory not owned by the pool. */
+} Pool;
+
+/** Function initializes a pool.
+ * Function initializes an empty pool of elements of size @p elementSize.
+ * @param[out] pool - a pointer to the pool;
+ * @param[in] elementSize - the size of one element, at least 4 bytes.
+ */
+void poolInit(Pool *pool, size_t elementSize);
+
+/** Function initializes a pool stored in a given array.
+ * Function initializes a pool of @p count elements, which are stored one after another
+ * in @p elements starting from the index 0. The array is not copied, so the elements can be
+ * read as long as the array exists, but the pool can not be changed until @ref poolOwn is called.
+ * @param[out] pool - a pointer to the pool;
+ * @param[in] elementSize - the size of one element, at least 4 bytes;
+ * @param[in] elements - a pointer to the array of elements;
+ * @param[in] count - the number of elements in the array, at least 1.
+ */
+void poolAttach(Pool *pool, size_t elementSize, char *elements, uint32_t count);
+
+/** Function copies the elements of a pool to its own memory.
+ * Function makes a pool initialized by @ref poolAttach independent of its array,
+ * so the pool can be changed. It does nothing for other pools.
+ * @param[in, out] pool - a pointer to the pool.
+ * @return Value @p false if failed to allocate memory, then the pool is not changed.
+ * Otherwise @p true.
+ */
+bool poolOwn(Pool *pool);
+
+/** Function allocates an element.
+ * Function returns an element from the list of freed elements or the next
+ * unused element, allocating a new slab if needed. The element is not initialized.
+ * @param[in, out] pool - a pointer to the pool;
+ * @return The index of the element or @ref POOL_NONE if failed to allocate memory.
+ */
+uint32_t poolAlloc(Pool *pool);
+
+/** Function allocates consecutive elements.
+ * Function returns @p count elements that have never been allocated, with consecutive
+ * indices, allocating new slabs if needed. Freed elements are not reused. The elements
+ * are not initialized.
+ * @param[in, out] pool - a pointer to the pool;
+ * @param[in] count - the number of elements, at least 1.
+ * @return The index of the first element or @ref POOL_NONE if failed to allocate memory.
+ */
+uint32_t poolAllocRange(Pool *pool, uint32_t count);
+
+/** Function frees an element.
+ * Function adds the element to the list of freed elements, so it can be reused.
+ * @param[in, out] pool - a pointer to the pool;
+ * @param[in] index - the index of the element.
+ */
+void poolFree(Pool *pool, uint32_t index);
+
+/** Function returns the memory of a pool.
+ * @param[in] pool - a pointer to the pool.
+ * @return The size of allocated slabs in bytes, 0 for a pool initialized by @ref poolAttach.
+ */
+size_t poolMemory(Pool const *pool);
+
+/** Function deletes the pool.
+ * Function frees all slabs of the pool at once. Elements of a pool initialized by
+ * @ref poolAttach are not freed.
+ * @param[in, out] pool - a pointer to the pool.
+ */
+void poolDestroy(Pool *pool);
+
+/** Function returns an element.
+ * Function calculates the slab and the position of the element with a given index.
+ * @param[in] pool - a pointer to the pool;
+ * @param[in] index - the index of an allocated element.
+ * @return A pointer to the element.
+ */
+static inline void *poolGet(Pool const *pool, uint32_t index) {
+    uint64_t position = (uint64_t) index + POOL_FIRST_SLAB_SIZE;
+    int slab = 63 - __builtin_clzll(position) - POOL_FIRST_SLAB_BITS;
+    position -= (uint64_t) POOL_FIRST_SLAB_SIZE << slab;
+    return pool->slabs[slab] + position * pool->elementSize;
+}
+
+/** Function returns the number of elements stored one after another from a given one.
+ * Elements with consecutive indices are stored together up to the end of their slab.
+ * @param[in] index - the index of an element.
+ * @return The number of elements from @p index to the end of its slab.
+ */
+static inline uint32_t poolContiguous(uint32_t index) {
+    uint64_t position = (uint64_t) index + POOL_FIRST_SLAB_SIZE;
+    int slab = 63 - __builtin_clzll(position) - POOL_FIRST_SLAB_BITS;
+    return ((uint64_t) POOL_FIRST_SLAB_SIZE << (slab + 1)) - position;
+}
+
+#endif /* __POOL_H__ */
@@ -0,0 +1,67 @@
+/** @file
+ * The main module of a class reading a file in large blocks
+ *
+ * @author Emilia Dębicka <ed438406@students.mimuw.edu.pl>
+ * @copyright University of Warsaw
+ * @date 2022
+ */
+
+#include "reader.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+bool readerInit(Reader *reader, int file, size_t size) {
+    reader->file = file;
+    reader->buffer = malloc(size + 1);
+    reader->size = size;
+    reader->begin = 0;
+    reader->end = 0;
+    reader->offset = 0;
+    reader->ended = false;
+    if (reader->buffer == NULL) {
+        return false;
+    }
+    reader->buffer[0] = '\0';
+    return true;
+}
+
+bool readerFill(Reader *reader) {
+    if (reader->ended) {
+        return true;
+    }
+    if (reader->begin > 0) {
+        memmove(reader->buffer, reader->buffer + reader->begin, reader->end - reader->begin);
+        reader->offset += reader->begin;
+        reader->end -= reader->begin;
+        reader->begin = 0;
+    } else if (reader->end == reader->size) {
+        char *buffer = realloc(reader->buffer, 2 * reader->size + 1);
+        if (buffer == NULL) {
+            return false;
+        }
+        reader->buffer = buffer;
+        reader->size *= 2;
+    }
+
+    ssize_t count;
+    do {
+        count = read(reader->file, reader->buffer + reader->end, reader->size - reader->end);
+    } while (count < 0 && errno == EINTR);
+    if (count < 0) {
+        return false;
+    }
+    reader->end += count;
+    reader->ended = count == 0;
+    reader->buffer[reader->end] = '\0';
+    return true;
+}
+
+void readerDestroy(Reader *reader) {
+    free(reader->buffer);
+    reader->buffer = NULL;
+    reader->size = 0;
+    reader->begin = 0;
+    reader->end = 0;
+}
@@ -0,0 +1,68 @@
+/** @file
+ * An interface for a class reading a file in large blocks
+ *
+ * @author Emilia Dębicka <ed438406@students.mimuw.edu.pl>
+ * @copyright University of Warsaw
+ * @date 2022
+ */
+
+#ifndef __READER_H__
+#define __READER_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * This is a structure of a reader. It keeps a block of the file in a buffer, and a parser
+ * reads the bytes from @p begin to @p end directly. The byte at @p end is always '\0',
+ * so a loop over characters of one class stops at the end of the buffer without
+ * checking its position.
+ */
+typedef struct Reader {
+    /**@{*/
+    int file; /**< The descriptor of the file. */
+    char *buffer; /**< Bytes read from the file, followed by '\0'. */
+    size_t size; /**< The size of @p buffer array without the last '\0'. */
+    size_t begin; /**< The position in @p buffer of the first byte that has not been parsed. */
+    size_t end; /**< The position in @p buffer after the last read byte. */
+    uint64_t offset; /**< The position in the file of the first byte of @p buffer. */
+    bool ended; /**< A boolean informing if the whole file has been read. */
+    /**@}*/
+} Reader;
+
+/** Function initializes a reader.
+ * @param[out] reader - a pointer to the reader;
+ * @param[in] file - the descriptor of the read file;
+ * @param[in] size - the initial size of the buffer, at least 1.
+ * @return Value @p false if failed to allocate memory. Otherwise @p true.
+ */
+bool readerInit(Reader *reader, int file, size_t size);
+
+/** Function reads the next bytes of the file.
+ * Function moves the bytes that have not been parsed to the beginning of the buffer
+ * and fills the rest of it. The buffer is enlarged if all its bytes have not been parsed,
+ * so a parser that needs more bytes can always get them. Positions of the unparsed bytes
+ * in the buffer can change.
+ * @param[in, out] reader - a pointer to the reader.
+ * @return Value @p false if failed to read the file or to allocate memory.
+ * Otherwise @p true, also if the file has ended.
+ */
+bool readerFill(Reader *reader);
+
+/** Function returns the position of a byte of the buffer in the file.
+ * @param[in] reader - a pointer to the reader;
+ * @param[in] byte - a pointer to a byte of the buffer.
+ * @return The position counted from 1.
+ */
+static inline uint64_t readerPosition(Reader const *reader, char const *byte) {
+    return reader->offset + (uint64_t) (byte - reader->buffer) + 1;
+}
+
+/** Function deletes the buffer of a reader.
+ * The file is not closed.
+ * @param[in, out] reader - a pointer to the reader.
+ */
+void readerDestroy(Reader *reader);
+
+#endif /* __READER_H__ */
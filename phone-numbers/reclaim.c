@@ -0,0 +1,143 @@
+/** @file
+ * The main module of a class that delays freeing of pool elements until no reader uses them
+ *
+ * @author Emilia Dębicka <ed438406@students.mimuw.edu.pl>
+ * @copyright University of Warsaw
+ * @date 2022
+ */
+
+#include "reclaim.h"
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * A macro that stores the inital size of the array of retired elements.
+ */
+#define INITIAL_RETIRED_SIZE 64
+
+/**
+ * A macro that stores the inital size of the array of held versions.
+ */
+#define INITIAL_HELD_SIZE 4
+
+/**
+ * The slot used by the thread the last time, it is checked first by the next reader.
+ */
+static _Thread_local size_t lastSlot;
+
+void reclaimInit(Reclaimer *reclaimer) {
+    atomic_init(&reclaimer->version, 1);
+    for (size_t i = 0; i < RECLAIM_READERS; i++) {
+        atomic_init(&reclaimer->readers[i], 0);
+    }
+    reclaimer->retired = NULL;
+    reclaimer->retiredFirst = 0;
+    reclaimer->retiredCount = 0;
+    reclaimer->retiredSize = 0;
+    reclaimer->held = NULL;
+    reclaimer->heldCount = 0;
+    reclaimer->heldSize = 0;
+}
+
+size_t reclaimEnter(Reclaimer *reclaimer) {
+    size_t slot = lastSlot;
+    while (true) {
+        for (size_t i = 0; i < RECLAIM_READERS; i++) {
+            uint64_t expected = 0;
+            uint64_t version = atomic_load(&reclaimer->version);
+            // The slot has to be announced before the structure is read, so a writer
+            // that does not see it has already published the next version.
+            if (atomic_compare_exchange_strong(&reclaimer->readers[slot], &expected, version)) {
+                lastSlot = slot;
+                return slot;
+            }
+            slot = (slot + 1) % RECLAIM_READERS;
+        }
+        sched_yield();
+    }
+}
+
+void reclaimExit(Reclaimer *reclaimer, size_t slot) {
+    atomic_store_explicit(&reclaimer->readers[slot], 0, memory_order_release);
+}
+
+bool reclaimRetire(Reclaimer *reclaimer, Pool *pool, uint32_t index) {
+    if (reclaimer->retiredCount == reclaimer->retiredSize) {
+        size_t retiredSize = reclaimer->retiredSize == 0 ? INITIAL_RETIRED_SIZE : 2 * reclaimer->retiredSize;
+        Retired *retired = realloc(reclaimer->retired, retiredSize * sizeof(Retired));
+        if (retired == NULL) {
+            return false;
+        }
+        reclaimer->retired = retired;
+        reclaimer->retiredSize = retiredSize;
+    }
+    Retired *element = &reclaimer->retired[reclaimer->retiredCount++];
+    element->version = atomic_load_explicit(&reclaimer->version, memory_order_relaxed) + 1;
+    element->pool = pool;
+    element->index = index;
+    return true;
+}
+
+bool reclaimHold(Reclaimer *reclaimer, uint64_t version) {
+    if (reclaimer->heldCount == reclaimer->heldSize) {
+        size_t heldSize = reclaimer->heldSize == 0 ? INITIAL_HELD_SIZE : 2 * reclaimer->heldSize;
+        uint64_t *held = realloc(reclaimer->held, heldSize * sizeof(uint64_t));
+        if (held == NULL) {
+            return false;
+        }
+        reclaimer->held = held;
+        reclaimer->heldSize = heldSize;
+    }
+    reclaimer->held[reclaimer->heldCount++] = version;
+    return true;
+}
+
+void reclaimRelease(Reclaimer *reclaimer, uint64_t version) {
+    for (size_t i = 0; i < reclaimer->heldCount; i++) {
+        if (reclaimer->held[i] == version) {
+            reclaimer->held[i] = reclaimer->held[--reclaimer->heldCount];
+            return;
+        }
+    }
+}
+
+void reclaimAdvance(Reclaimer *reclaimer) {
+    uint64_t oldest = atomic_fetch_add(&reclaimer->version, 1) + 1;
+    for (size_t i = 0; i < RECLAIM_READERS; i++) {
+        uint64_t version = atomic_load(&reclaimer->readers[i]);
+        if (version != 0 && version < oldest) {
+            oldest = version;
+        }
+    }
+    for (size_t i = 0; i < reclaimer->heldCount; i++) {
+        if (reclaimer->held[i] < oldest) {
+            oldest = reclaimer->held[i];
+        }
+    }
+
+    // Elements are retired in the order of versions, so the freed ones form a prefix.
+    while (reclaimer->retiredFirst < reclaimer->retiredCount
+           && reclaimer->retired[reclaimer->retiredFirst].version <= oldest) {
+        Retired const *element = &reclaimer->retired[reclaimer->retiredFirst++];
+        poolFree(element->pool, element->index);
+    }
+    if (reclaimer->retiredFirst > reclaimer->retiredCount / 2) {
+        reclaimer->retiredCount -= reclaimer->retiredFirst;
+        memmove(reclaimer->retired, reclaimer->retired + reclaimer->retiredFirst,
+                reclaimer->retiredCount * sizeof(Retired));
+        reclaimer->retiredFirst = 0;
+    }
+}
+
+void reclaimDestroy(Reclaimer *reclaimer) {
+    free(reclaimer->retired);
+    reclaimer->retired = NULL;
+    reclaimer->retiredFirst = 0;
+    reclaimer->retiredCount = 0;
+    reclaimer->retiredSize = 0;
+    free(reclaimer->held);
+    reclaimer->held = NULL;
+    reclaimer->heldCount = 0;
+    reclaimer->heldSize = 0;
+}
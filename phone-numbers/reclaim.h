@@ -0,0 +1,116 @@
+/** @file
+ * An interface for a class that delays freeing of pool elements until no reader uses them
+ *
+ * @author Emilia Dębicka <ed438406@students.mimuw.edu.pl>
+ * @copyright University of Warsaw
+ * @date 2022
+ */
+
+#ifndef __RECLAIM_H__
+#define __RECLAIM_H__
+
+#include "pool.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A macro that informs how many readers can use a structure at the same time.
+ */
+#define RECLAIM_READERS 64
+
+/**
+ * The structure stores an element that waits to be freed.
+ */
+typedef struct Retired {
+    /**@{*/
+    uint64_t version; /**< The first version that does not use the element. */
+    Pool *pool; /**< The pool of the element. */
+    uint32_t index; /**< The index of the element. */
+    /**@}*/
+} Retired;
+
+/**
+ * This is a structure of an epoch-based reclamation. A writer publishes consecutive
+ * versions of a structure. A reader announces the version it has started with,
+ * and elements removed from the structure are freed only when every reader
+ * has started with a version that does not use them. A version can be also held
+ * for a longer time, then it is treated as a reader that never finishes.
+ */
+typedef struct Reclaimer {
+    /**@{*/
+    _Atomic uint64_t version; /**< The last published version, starting from 1. */
+    _Atomic uint64_t readers[RECLAIM_READERS]; /**< Versions announced by readers, 0 if a slot is free. */
+    Retired *retired; /**< Elements waiting to be freed, sorted by their versions. */
+    size_t retiredFirst; /**< The index of the first element in @p retired that has not been freed. */
+    size_t retiredCount; /**< The number of elements in @p retired. */
+    size_t retiredSize; /**< The size of @p retired array. */
+    uint64_t *held; /**< Held versions, they can repeat. */
+    size_t heldCount; /**< The number of versions in @p held. */
+    size_t heldSize; /**< The size of @p held array. */
+    /**@}*/
+} Reclaimer;
+
+/** Function initializes a reclaimer.
+ * @param[out] reclaimer - a pointer to the reclaimer.
+ */
+void reclaimInit(Reclaimer *reclaimer);
+
+/** Function announces a reader.
+ * Function takes a free slot and stores in it the last published version. The reader
+ * has to read the published structure after this call. It waits if all slots are taken.
+ * @param[in, out] reclaimer - a pointer to the reclaimer.
+ * @return The slot of the reader.
+ */
+size_t reclaimEnter(Reclaimer *reclaimer);
+
+/** Function ends a reader.
+ * Function frees the slot taken by @ref reclaimEnter.
+ * @param[in, out] reclaimer - a pointer to the reclaimer;
+ * @param[in] slot - the slot of the reader.
+ */
+void reclaimExit(Reclaimer *reclaimer, size_t slot);
+
+/** Function removes an element from the structure.
+ * Function remembers that the element is not used by the version that will be published
+ * next, so it can be freed when no reader uses older versions.
+ * @param[in, out] reclaimer - a pointer to the reclaimer;
+ * @param[in, out] pool - a pointer to the pool of the element;
+ * @param[in] index - the index of the element.
+ * @return Value @p false if failed to allocate memory. Then the element is never freed.
+ * Otherwise @p true.
+ */
+bool reclaimRetire(Reclaimer *reclaimer, Pool *pool, uint32_t index);
+
+/** Function holds a version.
+ * Elements used by the held version are not freed until @ref reclaimRelease is called.
+ * It has to be called by the writer.
+ * @param[in, out] reclaimer - a pointer to the reclaimer;
+ * @param[in] version - a version that has not been freed yet.
+ * @return Value @p false if failed to allocate memory. Otherwise @p true.
+ */
+bool reclaimHold(Reclaimer *reclaimer, uint64_t version);
+
+/** Function releases a version held by @ref reclaimHold.
+ * Elements are freed by the next call of @ref reclaimAdvance. It has to be called by the writer.
+ * @param[in, out] reclaimer - a pointer to the reclaimer;
+ * @param[in] version - the held version.
+ */
+void reclaimRelease(Reclaimer *reclaimer, uint64_t version);
+
+/** Function publishes a new version.
+ * Function has to be called after the new version of the structure has been published.
+ * It frees all elements not used by versions announced by readers or held.
+ * @param[in, out] reclaimer - a pointer to the reclaimer.
+ */
+void reclaimAdvance(Reclaimer *reclaimer);
+
+/** Function deletes the reclaimer.
+ * Function frees the memory of the reclaimer without freeing waiting elements,
+ * so it should be called when their pools are deleted.
+ * @param[in, out] reclaimer - a pointer to the reclaimer.
+ */
+void reclaimDestroy(Reclaimer *reclaimer);
+
+#endif /* __RECLAIM_H__ */
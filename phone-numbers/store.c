@@ -0,0 +1,312 @@
+/** @file
+ * The main module of a class storing pools of phone number forwarding in a file
+ *
+ * A file starts with StoreHeader, which describes the sections storing the pools. Each
+ * section starts at a multiple of @ref STORE_ALIGNMENT and stores the element 0 as zeros.
+ *
+ * @author Emilia Dębicka <ed438406@students.mimuw.edu.pl>
+ * @copyright University of Warsaw
+ * @date 2022
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "store.h"
+#include "journal.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * A macro that stores the first bytes of a file written by @ref storeSave.
+ */
+#define STORE_MAGIC "PHFWD\0\0\0"
+
+/**
+ * A macro that stores the suffix of the name of the temporary file written by @ref storeSave.
+ */
+#define STORE_TEMPORARY_SUFFIX ".tmp"
+
+/**
+ * A macro that stores the version of the format of files written by @ref storeSave.
+ * It has to be changed with every change of the stored structures.
+ */
+#define STORE_VERSION 3
+
+/**
+ * A macro that stores a number written to a saved file to check the byte order.
+ */
+#define STORE_BYTE_ORDER 0x01020304u
+
+/**
+ * A macro that stores the alignment of the sections of a saved file.
+ */
+#define STORE_ALIGNMENT 64
+
+/**
+ * A macro that stores the multiplier used by the checksum of a saved file.
+ */
+#define CHECKSUM_MULTIPLIER UINT64_C(0x9e3779b97f4a7c15)
+
+/**
+ * The structure stores the header of a file written by @ref storeSave.
+ */
+typedef struct StoreHeader {
+    /**@{*/
+    char magic[8]; /**< The bytes of @ref STORE_MAGIC. */
+    uint32_t version; /**< The version of the format, @ref STORE_VERSION. */
+    uint32_t byteOrder; /**< @ref STORE_BYTE_ORDER in the byte order of the writer. */
+    uint32_t elementSizes[STORE_SECTIONS]; /**< Sizes of elements of the pools. */
+    uint32_t counts[STORE_SECTIONS]; /**< Numbers of elements of the pools, including the index 0. */
+    StoreInfo info; /**< The values saved with the pools. */
+    uint64_t offsets[STORE_SECTIONS]; /**< Positions of the sections in the file. */
+    uint64_t size; /**< The size of the file. */
+    uint64_t checksum; /**< The checksum of the whole file with this field set to 0. */
+    /**@}*/
+} StoreHeader;
+
+/**
+ * The structure stores the state of a checksum computed by parts.
+ */
+typedef struct Checksum {
+    /**@{*/
+    uint64_t hash; /**< The hash of the processed 8-byte words. */
+    uint8_t pending[8]; /**< Bytes that do not form a whole word yet. */
+    size_t pendingSize; /**< The number of bytes in @p pending. */
+    /**@}*/
+} Checksum;
+
+/**
+ * The structure stores a file being written by @ref storeSave.
+ */
+typedef struct StoreWriter {
+    /**@{*/
+    FILE *file; /**< The written file. */
+    uint64_t position; /**< The number of bytes written. */
+    Checksum checksum; /**< The checksum of the written bytes. */
+    bool failed; /**< A boolean informing if any write has failed. */
+    /**@}*/
+} StoreWriter;
+
+/** Function adds bytes to a checksum.
+ * Bytes are processed in 8-byte words, so the checksum does not depend on how they are split.
+ * @param[in, out] checksum - a pointer to the state of the checksum;
+ * @param[in] data - a pointer to the bytes;
+ * @param[in] size - the number of bytes.
+ */
+static void checksumUpdate(Checksum *checksum, uint8_t const *data, size_t size) {
+    if (checksum->pendingSize > 0) {
+        size_t taken = 8 - checksum->pendingSize < size ? 8 - checksum->pendingSize : size;
+        memcpy(checksum->pending + checksum->pendingSize, data, taken);
+        checksum->pendingSize += taken;
+        data += taken;
+        size -= taken;
+        if (checksum->pendingSize < 8) {
+            return;
+        }
+        checksum->pendingSize = 0;
+        checksumUpdate(checksum, checksum->pending, 8);
+    }
+    uint64_t hash = checksum->hash;
+    for (; size >= 8; data += 8, size -= 8) {
+        uint64_t word;
+        memcpy(&word, data, 8);
+        hash = (hash ^ word) * CHECKSUM_MULTIPLIER;
+        hash ^= hash >> 29;
+    }
+    checksum->hash = hash;
+    memcpy(checksum->pending, data, size);
+    checksum->pendingSize = size;
+}
+
+/** Function finishes a checksum.
+ * @param[in, out] checksum - a pointer to the state of the checksum.
+ * @return The checksum of all added bytes.
+ */
+static uint64_t checksumEnd(Checksum *checksum) {
+    if (checksum->pendingSize > 0) {
+        memset(checksum->pending + checksum->pendingSize, 0, 8 - checksum->pendingSize);
+        checksum->pendingSize = 0;
+        checksumUpdate(checksum, checksum->pending, 8);
+    }
+    return checksum->hash;
+}
+
+/** Function returns a position aligned to the start of a section.
+ * @param[in] position - a position in a saved file.
+ * @return The smallest multiple of @ref STORE_ALIGNMENT not smaller than @p position.
+ */
+static inline uint64_t alignSection(uint64_t position) {
+    return (position + STORE_ALIGNMENT - 1) / STORE_ALIGNMENT * STORE_ALIGNMENT;
+}
+
+/** Function writes bytes to a saved file.
+ * @param[in, out] writer - a pointer to the written file;
+ * @param[in] data - a pointer to the bytes;
+ * @param[in] size - the number of bytes.
+ */
+static void storeWrite(StoreWriter *writer, void const *data, size_t size) {
+    if (size > 0 && fwrite(data, 1, size, writer->file) != size) {
+        writer->failed = true;
+    }
+    checksumUpdate(&writer->checksum, data, size);
+    writer->position += size;
+}
+
+/** Function writes zeros to a saved file up to a given position.
+ * @param[in, out] writer - a pointer to the written file;
+ * @param[in] position - the position of the next written byte.
+ */
+static void storePad(StoreWriter *writer, uint64_t position) {
+    uint8_t const zeros[STORE_ALIGNMENT] = {0};
+    while (writer->position < position) {
+        uint64_t size = position - writer->position;
+        storeWrite(writer, zeros, size < STORE_ALIGNMENT ? size : STORE_ALIGNMENT);
+    }
+}
+
+/** Function writes a pool to a saved file.
+ * The element 0 is written as zeros, next elements are written by whole parts of slabs.
+ * @param[in, out] writer - a pointer to the written file;
+ * @param[in] pool - a pointer to the pool with no freed elements.
+ */
+static void storePool(StoreWriter *writer, Pool const *pool) {
+    storePad(writer, writer->position + pool->elementSize);
+    for (uint32_t index = POOL_NONE + 1; index < pool->nextIndex;) {
+        uint32_t count = poolContiguous(index);
+        if (count > pool->nextIndex - index) {
+            count = pool->nextIndex - index;
+        }
+        storeWrite(writer, poolGet(pool, index), (size_t) count * pool->elementSize);
+        index += count;
+    }
+}
+
+bool storeSave(char const *path, Pool const *const pools[STORE_SECTIONS], StoreInfo const *info) {
+    StoreHeader header;
+    memset(&header, 0, sizeof(StoreHeader));
+    memcpy(header.magic, STORE_MAGIC, sizeof(header.magic));
+    header.version = STORE_VERSION;
+    header.byteOrder = STORE_BYTE_ORDER;
+    header.info = *info;
+    uint64_t position = alignSection(sizeof(StoreHeader));
+    for (size_t i = 0; i < STORE_SECTIONS; i++) {
+        header.elementSizes[i] = pools[i]->elementSize;
+        header.counts[i] = pools[i]->nextIndex;
+        header.offsets[i] = position;
+        header.size = position + (uint64_t) pools[i]->nextIndex * pools[i]->elementSize;
+        position = alignSection(header.size);
+    }
+
+    size_t pathSize = strlen(path);
+    char *temporary = malloc(pathSize + sizeof(STORE_TEMPORARY_SUFFIX));
+    if (temporary == NULL) {
+        return false;
+    }
+    memcpy(temporary, path, pathSize);
+    memcpy(temporary + pathSize, STORE_TEMPORARY_SUFFIX, sizeof(STORE_TEMPORARY_SUFFIX));
+    StoreWriter writer = {fopen(temporary, "wb"), 0, {0, {0}, 0}, false};
+    if (writer.file == NULL) {
+        free(temporary);
+        return false;
+    }
+    // The header is written again with the checksum, which is 0 in the checked bytes.
+    storeWrite(&writer, &header, sizeof(StoreHeader));
+    for (size_t i = 0; i < STORE_SECTIONS; i++) {
+        storePad(&writer, header.offsets[i]);
+        storePool(&writer, pools[i]);
+    }
+    header.checksum = checksumEnd(&writer.checksum);
+    if (fseek(writer.file, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(StoreHeader), 1, writer.file) != 1) {
+        writer.failed = true;
+    }
+    // The old file is replaced only by a complete one stored on the disk, and the new name
+    // is stored too before the function returns.
+    if (fflush(writer.file) != 0 || fsync(fileno(writer.file)) != 0) {
+        writer.failed = true;
+    }
+    if (fclose(writer.file) != 0) {
+        writer.failed = true;
+    }
+    if (!writer.failed && rename(temporary, path) != 0) {
+        writer.failed = true;
+    }
+    if (writer.failed) {
+        remove(temporary);
+    }
+    free(temporary);
+    return !writer.failed && journalSyncDirectory(path);
+}
+
+/** Function checks a file written by @ref storeSave.
+ * @param[in] pools - an array of pointers to pools, which give the sizes of elements;
+ * @param[in] data - a pointer to the contents of the file;
+ * @param[in] size - the size of the file, at least the size of StoreHeader.
+ * @return Value @p true if the file was written by @ref storeSave in this format
+ * on a machine with the same byte order and has not been changed. Otherwise @p false.
+ */
+static bool checkStore(Pool *const pools[STORE_SECTIONS], char const *data, size_t size) {
+    StoreHeader const *header = (StoreHeader const *) data;
+    if (memcmp(header->magic, STORE_MAGIC, sizeof(header->magic)) != 0 || header->version != STORE_VERSION
+        || header->byteOrder != STORE_BYTE_ORDER || header->size != size) {
+        return false;
+    }
+    // Sections are stored in order and can not overlap, so no index leads out of its section.
+    uint64_t end = sizeof(StoreHeader);
+    for (size_t i = 0; i < STORE_SECTIONS; i++) {
+        size_t elementSize = pools[i]->elementSize;
+        if (header->elementSizes[i] != elementSize || header->counts[i] == POOL_NONE
+            || header->offsets[i] % STORE_ALIGNMENT != 0 || header->offsets[i] < end
+            || header->offsets[i] > size || (size - header->offsets[i]) / elementSize < header->counts[i]) {
+            return false;
+        }
+        end = header->offsets[i] + (uint64_t) header->counts[i] * elementSize;
+    }
+    StoreInfo const *info = &header->info;
+    if (info->root == POOL_NONE || info->root >= header->counts[0] || info->reverseRoot == POOL_NONE
+        || info->reverseRoot >= header->counts[0]) {
+        return false;
+    }
+    StoreHeader checked = *header;
+    checked.checksum = 0;
+    Checksum checksum = {0, {0}, 0};
+    checksumUpdate(&checksum, (uint8_t const *) &checked, sizeof(StoreHeader));
+    checksumUpdate(&checksum, (uint8_t const *) data + sizeof(StoreHeader), size - sizeof(StoreHeader));
+    return checksumEnd(&checksum) == header->checksum;
+}
+
+char *storeLoad(char const *path, Pool *const pools[STORE_SECTIONS], StoreInfo *info, size_t *size) {
+    int file = open(path, O_RDONLY);
+    if (file < 0) {
+        return NULL;
+    }
+    struct stat status;
+    char *data = MAP_FAILED;
+    if (fstat(file, &status) == 0 && (uint64_t) status.st_size >= sizeof(StoreHeader)) {
+        data = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    }
+    close(file);
+    if (data == MAP_FAILED) {
+        return NULL;
+    }
+    if (!checkStore(pools, data, status.st_size)) {
+        munmap(data, status.st_size);
+        return NULL;
+    }
+
+    StoreHeader const *header = (StoreHeader const *) data;
+    for (size_t i = 0; i < STORE_SECTIONS; i++) {
+        poolAttach(pools[i], header->elementSizes[i], data + header->offsets[i], header->counts[i]);
+    }
+    *info = header->info;
+    *size = status.st_size;
+    return data;
+}
+
+void storeUnmap(char *data, size_t size) {
+    munmap(data, size);
+}
@@ -0,0 +1,69 @@
+/** @file
+ * An interface for a class storing pools of phone number forwarding in a file
+ *
+ * @author Emilia Dębicka <ed438406@students.mimuw.edu.pl>
+ * @copyright University of Warsaw
+ * @date 2022
+ */
+
+#ifndef __STORE_H__
+#define __STORE_H__
+
+#include "pool.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A macro that stores the number of sections of a saved file, one for each pool.
+ */
+#define STORE_SECTIONS 5
+
+/**
+ * This is a structure of the values saved in a file with the pools.
+ */
+typedef struct StoreInfo {
+    /**@{*/
+    uint32_t root; /**< The index of the root of the trie in the first pool. */
+    uint32_t reverseRoot; /**< The index of the root of the reverse index in the first pool. */
+    uint64_t nodes; /**< The number of nodes of the trie. */
+    uint64_t rules; /**< The number of forwardings of the trie. */
+    uint64_t nodeBytes; /**< Bytes of the nodes of the trie and of their arrays of children. */
+    /**@}*/
+} StoreInfo;
+
+/** Function writes pools to a file.
+ * The file stores the pools in sections, one after another, each starting from the index 0,
+ * so it can be read straight from memory by @ref storeLoad. The pools are written to
+ * a temporary file named @p path followed by ".tmp", which is stored on the disk and renamed
+ * to @p path, so an existing file is replaced only by a complete one.
+ * @param[in] path - the name of the file;
+ * @param[in] pools - an array of @ref STORE_SECTIONS pointers to pools with no freed elements;
+ * @param[in] info - a pointer to the values saved with the pools.
+ * @return Value @p false if the file could not be written, then the temporary file is removed
+ * and an existing file @p path is not changed, or if the new name could not be stored on the disk.
+ * Otherwise @p true.
+ */
+bool storeSave(char const *path, Pool const *const pools[STORE_SECTIONS], StoreInfo const *info);
+
+/** Function reads a file written by @ref storeSave.
+ * Function maps the file to memory, checks it and initializes the pools with
+ * @ref poolAttach, so they read the elements from the file until @ref poolOwn is called.
+ * @param[in] path - the name of the file;
+ * @param[in, out] pools - an array of @ref STORE_SECTIONS pointers to empty pools, which give
+ * the sizes of elements;
+ * @param[out] info - a pointer to the values saved with the pools;
+ * @param[out] size - a pointer to the size of the file.
+ * @return A pointer to the contents of the file, which has to be freed by @ref storeUnmap,
+ * or NULL if the file can not be read, was not written by @ref storeSave in this format on
+ * a machine with the same byte order or has been changed. Then the pools are not changed.
+ */
+char *storeLoad(char const *path, Pool *const pools[STORE_SECTIONS], StoreInfo *info, size_t *size);
+
+/** Function frees the contents of a file read by @ref storeLoad.
+ * @param[in] data - a pointer to the contents of the file;
+ * @param[in] size - the size of the file.
+ */
+void storeUnmap(char *data, size_t size);
+
+#endif /* __STORE_H__ */
@@ -0,0 +1,152 @@
+/** @file
+ * The main module of a generator of phone number forwarding used by benchmarks
+ *
+ * @author Emilia Dębicka <ed438406@students.mimuw.edu.pl>
+ * @copyright University of Warsaw
+ * @date 2022
+ */
+
+#include "workload.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+void workloadDefaults(WorkloadConfig *config) {
+    config->rules = 100000;
+    config->queries = 100000;
+    config->lengthDistribution = WORKLOAD_UNIFORM;
+    config->minLength = 4;
+    config->maxLength = 12;
+    config->fanOut = 10;
+    config->sharedTargets = 0;
+    config->specialDigits = 0;
+    config->seed = 1;
+}
+
+uint32_t workloadRandom(uint64_t *seed) {
+    *seed = *seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    return *seed >> 33;
+}
+
+/** Function checks a random event.
+ * @param[in, out] seed - a pointer to the state of the generator;
+ * @param[in] probability - the probability of the event.
+ * @return Value @p true if the event has happened. Otherwise @p false.
+ */
+static bool chance(uint64_t *seed, double probability) {
+    return workloadRandom(seed) < probability * 2147483648.0;
+}
+
+/** Function generates a random digit.
+ * @param[in] config - a pointer to the parameters;
+ * @param[in, out] seed - a pointer to the state of the generator.
+ * @return The character of the digit.
+ */
+static char randomDigit(WorkloadConfig const *config, uint64_t *seed) {
+    // The generator is not used when there are no special digits, so the numbers
+    // of the default parameters do not depend on the frequency of them.
+    if (config->specialDigits > 0 && chance(seed, config->specialDigits)) {
+        return workloadRandom(seed) % 2 == 0 ? '*' : '#';
+    }
+    return '0' + workloadRandom(seed) % config->fanOut;
+}
+
+size_t workloadNumber(WorkloadConfig const *config, uint64_t *seed, size_t minLength, size_t maxLength,
+                      char *num) {
+    size_t length = minLength;
+    if (config->lengthDistribution == WORKLOAD_GEOMETRIC) {
+        while (length < maxLength && workloadRandom(seed) % 2 == 0) {
+            length++;
+        }
+    } else {
+        length += workloadRandom(seed) % (maxLength - minLength + 1);
+    }
+    for (size_t i = 0; i < length; i++) {
+        num[i] = randomDigit(config, seed);
+    }
+    num[length] = '\0';
+    return length;
+}
+
+/** Function generates a query.
+ * The query is a given number followed by at most @ref WORKLOAD_SUFFIX_LENGTH random digits.
+ * @param[in] config - a pointer to the parameters;
+ * @param[in, out] seed - a pointer to the state of the generator;
+ * @param[in] num - a pointer to the number;
+ * @param[out] query - a pointer to the array of at least @ref WORKLOAD_SUFFIX_LENGTH
+ * characters more than @p num.
+ * @return The number of characters of @p query with '\0'.
+ */
+static size_t generateQuery(WorkloadConfig const *config, uint64_t *seed, char const *num, char *query) {
+    size_t length = strlen(num);
+    memcpy(query, num, length);
+    size_t suffix = workloadRandom(seed) % (WORKLOAD_SUFFIX_LENGTH + 1);
+    for (size_t i = 0; i < suffix; i++) {
+        query[length++] = randomDigit(config, seed);
+    }
+    query[length] = '\0';
+    return length + 1;
+}
+
+Workload *workloadNew(WorkloadConfig const *config) {
+    if (config->minLength < 1 || config->maxLength < config->minLength || config->fanOut < 1
+        || config->fanOut > 10 || config->sharedTargets < 0 || config->sharedTargets > 1
+        || config->specialDigits < 0 || config->specialDigits > 1 || (config->rules == 0 && config->queries > 0)) {
+        return NULL;
+    }
+
+    size_t numbers = 2 * config->rules + 2 * config->queries;
+    Workload *workload = malloc(sizeof(Workload));
+    char const **pointers = malloc((numbers > 0 ? numbers : 1) * sizeof(char const *));
+    char *chars = malloc((numbers > 0 ? numbers : 1) * (config->maxLength + WORKLOAD_SUFFIX_LENGTH + 1));
+    if (workload == NULL || pointers == NULL || chars == NULL) {
+        free(workload);
+        free(pointers);
+        free(chars);
+        return NULL;
+    }
+    workload->num1 = pointers;
+    workload->num2 = pointers + config->rules;
+    workload->forwarded = pointers + 2 * config->rules;
+    workload->targets = pointers + 2 * config->rules + config->queries;
+    workload->rules = config->rules;
+    workload->queries = config->queries;
+    workload->chars = chars;
+
+    uint64_t seed = config->seed;
+    char *next = chars;
+    for (size_t i = 0; i < config->rules; i++) {
+        char *num1 = next;
+        next += workloadNumber(config, &seed, config->minLength, config->maxLength, num1) + 1;
+        workload->num1[i] = num1;
+        if (i > 0 && chance(&seed, config->sharedTargets)) {
+            char const *shared = workload->num2[workloadRandom(&seed) % i];
+            if (strcmp(shared, num1) != 0) {
+                workload->num2[i] = shared;
+                continue;
+            }
+        }
+        char *num2 = next;
+        size_t length = workloadNumber(config, &seed, config->minLength, config->maxLength, num2);
+        if (strcmp(num1, num2) == 0) {
+            num2[length - 1] = num2[length - 1] == '0' ? '1' : '0';
+        }
+        next += length + 1;
+        workload->num2[i] = num2;
+    }
+    for (size_t i = 0; i < config->queries; i++) {
+        workload->forwarded[i] = next;
+        next += generateQuery(config, &seed, workload->num1[workloadRandom(&seed) % config->rules], next);
+        workload->targets[i] = next;
+        next += generateQuery(config, &seed, workload->num2[workloadRandom(&seed) % config->rules], next);
+    }
+    return workload;
+}
+
+void workloadDelete(Workload *workload) {
+    if (workload != NULL) {
+        free(workload->num1);
+        free(workload->chars);
+        free(workload);
+    }
+}
@@ -0,0 +1,107 @@
+/** @file
+ * An interface for a generator of phone number forwarding used by benchmarks
+ *
+ * @author Emilia Dębicka <ed438406@students.mimuw.edu.pl>
+ * @copyright University of Warsaw
+ * @date 2022
+ */
+
+#ifndef __WORKLOAD_H__
+#define __WORKLOAD_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A macro that describes lengths of numbers chosen with equal probabilities.
+ */
+#define WORKLOAD_UNIFORM 1
+
+/**
+ * A macro that describes lengths of numbers, each of which is chosen
+ * half as often as the previous one.
+ */
+#define WORKLOAD_GEOMETRIC 2
+
+/**
+ * A macro that stores the maximal number of digits appended to a number of a forwarding
+ * to create a query.
+ */
+#define WORKLOAD_SUFFIX_LENGTH 3
+
+/**
+ * The structure stores parameters of generated forwardings and queries.
+ */
+typedef struct WorkloadConfig {
+    /**@{*/
+    size_t rules; /**< The number of forwardings. */
+    size_t queries; /**< The number of queries of each kind. */
+    int lengthDistribution; /**< @ref WORKLOAD_UNIFORM or @ref WORKLOAD_GEOMETRIC. */
+    size_t minLength; /**< The minimal length of a number of a forwarding, at least 1. */
+    size_t maxLength; /**< The maximal length of a number of a forwarding, at least @p minLength. */
+    unsigned fanOut; /**< The number of decimal digits that can follow a prefix, from 1 to 10. */
+    double sharedTargets; /**< The probability that a forwarding has the same target as an earlier one. */
+    double specialDigits; /**< The probability that a digit is '*' or '#'. */
+    uint64_t seed; /**< The initial state of the random generator. */
+    /**@}*/
+} WorkloadConfig;
+
+/**
+ * The structure stores generated forwardings and queries. Numbers of a query are
+ * numbers of a random forwarding followed by at most @ref WORKLOAD_SUFFIX_LENGTH digits,
+ * so most of the queries find a forwarding.
+ */
+typedef struct Workload {
+    /**@{*/
+    char const **num1; /**< Prefixes of forwarded numbers, @p rules of them. */
+    char const **num2; /**< Prefixes to which they are forwarded, @p rules of them. */
+    char const **forwarded; /**< Numbers starting with a number of @p num1, @p queries of them. */
+    char const **targets; /**< Numbers starting with a number of @p num2, @p queries of them. */
+    size_t rules; /**< The number of forwardings. */
+    size_t queries; /**< The number of queries of each kind. */
+    char *chars; /**< The memory storing all numbers. */
+    /**@}*/
+} Workload;
+
+/** Function sets default parameters.
+ * The default workload has 100000 forwardings and queries with numbers of 4 to 12
+ * decimal digits chosen uniformly.
+ * @param[out] config - a pointer to the parameters.
+ */
+void workloadDefaults(WorkloadConfig *config);
+
+/** Function returns a pseudorandom number.
+ * @param[in, out] seed - a pointer to the state of the generator.
+ * @return A pseudorandom number smaller than 2^31.
+ */
+uint32_t workloadRandom(uint64_t *seed);
+
+/** Function generates a random number.
+ * Its length is chosen from @p minLength to @p maxLength with the distribution
+ * of @p config, and its digits are chosen with the fan-out and the frequency
+ * of '*' and '#' of @p config.
+ * @param[in] config - a pointer to the parameters;
+ * @param[in, out] seed - a pointer to the state of the generator;
+ * @param[in] minLength - the minimal length of the number, at least 1;
+ * @param[in] maxLength - the maximal length of the number, at least @p minLength;
+ * @param[out] num - a pointer to the array of at least @p maxLength + 1 characters.
+ * @return The length of the number.
+ */
+size_t workloadNumber(WorkloadConfig const *config, uint64_t *seed, size_t minLength, size_t maxLength,
+                      char *num);
+
+/** Function generates forwardings and queries.
+ * A forwarding never forwards a number to itself, but numbers of forwardings can repeat.
+ * @param[in] config - a pointer to the parameters.
+ * @return A pointer to the generated workload, or NULL if the parameters are incorrect
+ * or failed to allocate memory.
+ */
+Workload *workloadNew(WorkloadConfig const *config);
+
+/** Function deletes generated forwardings and queries.
+ * Does nothing if @p workload is NULL.
+ * @param[in] workload - a pointer to the workload.
+ */
+void workloadDelete(Workload *workload);
+
+#endif /* __WORKLOAD_H__ */
@@ -0,0 +1,74 @@
+/** @file
+ * The main module of a class writing a file in large blocks
+ *
+ * @author Emilia Dębicka <ed438406@students.mimuw.edu.pl>
+ * @copyright University of Warsaw
+ * @date 2022
+ */
+
+#include "writer.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+bool writerInit(Writer *writer, int file, size_t size) {
+    writer->file = file;
+    writer->buffer = malloc(size);
+    writer->count = 0;
+    writer->size = size;
+    writer->failed = false;
+    return writer->buffer != NULL;
+}
+
+char *writerReserve(Writer *writer, size_t size, size_t *available) {
+    if (writer->size - writer->count < size) {
+        if (!writerFlush(writer)) {
+            return NULL;
+        }
+        if (writer->size < size) {
+            char *buffer = realloc(writer->buffer, size);
+            if (buffer == NULL) {
+                return NULL;
+            }
+            writer->buffer = buffer;
+            writer->size = size;
+        }
+    }
+    *available = writer->size - writer->count;
+    return writer->buffer + writer->count;
+}
+
+bool writerPut(Writer *writer, char const *data, size_t size) {
+    size_t available;
+    char *space = writerReserve(writer, size, &available);
+    if (space == NULL) {
+        return false;
+    }
+    memcpy(space, data, size);
+    writerCommit(writer, size);
+    return true;
+}
+
+bool writerFlush(Writer *writer) {
+    char const *data = writer->buffer;
+    while (!writer->failed && writer->count > 0) {
+        ssize_t written = write(writer->file, data, writer->count);
+        if (written < 0 && errno != EINTR) {
+            writer->failed = true;
+        }
+        if (written > 0) {
+            data += written;
+            writer->count -= written;
+        }
+    }
+    writer->count = 0;
+    return !writer->failed;
+}
+
+void writerDestroy(Writer *writer) {
+    free(writer->buffer);
+    writer->buffer = NULL;
+    writer->count = 0;
+    writer->size = 0;
+}
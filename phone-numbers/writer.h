@@ -0,0 +1,79 @@
+/** @file
+ * An interface for a class writing a file in large blocks
+ *
+ * @author Emilia Dębicka <ed438406@students.mimuw.edu.pl>
+ * @copyright University of Warsaw
+ * @date 2022
+ */
+
+#ifndef __WRITER_H__
+#define __WRITER_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * This is a structure of a writer. Bytes are collected in a buffer and written to the file
+ * when it is full. A result can be written directly to the buffer: @ref writerReserve
+ * returns free space and @ref writerCommit appends the bytes written there.
+ */
+typedef struct Writer {
+    /**@{*/
+    int file; /**< The descriptor of the file. */
+    char *buffer; /**< Bytes that have not been written to the file yet. */
+    size_t count; /**< The number of bytes in @p buffer. */
+    size_t size; /**< The size of @p buffer array. */
+    bool failed; /**< A boolean informing if the file could not be written. */
+    /**@}*/
+} Writer;
+
+/** Function initializes a writer.
+ * @param[out] writer - a pointer to the writer;
+ * @param[in] file - the descriptor of the written file;
+ * @param[in] size - the initial size of the buffer, at least 1.
+ * @return Value @p false if failed to allocate memory. Otherwise @p true.
+ */
+bool writerInit(Writer *writer, int file, size_t size);
+
+/** Function returns free space of the buffer.
+ * Function writes the buffer to the file if it has less than @p size free bytes,
+ * and enlarges it if it is still too small.
+ * @param[in, out] writer - a pointer to the writer;
+ * @param[in] size - the needed number of bytes;
+ * @param[out] available - a pointer to the number of free bytes, at least @p size.
+ * @return A pointer to the first free byte of the buffer, or NULL if failed to write
+ * the file or to allocate memory.
+ */
+char *writerReserve(Writer *writer, size_t size, size_t *available);
+
+/** Function appends bytes written to the space returned by @ref writerReserve.
+ * @param[in, out] writer - a pointer to the writer;
+ * @param[in] size - the number of bytes, not larger than the reserved space.
+ */
+static inline void writerCommit(Writer *writer, size_t size) {
+    writer->count += size;
+}
+
+/** Function appends bytes.
+ * @param[in, out] writer - a pointer to the writer;
+ * @param[in] data - a pointer to the bytes;
+ * @param[in] size - the number of bytes.
+ * @return Value @p false if failed to write the file or to allocate memory.
+ * Otherwise @p true.
+ */
+bool writerPut(Writer *writer, char const *data, size_t size);
+
+/** Function writes all collected bytes to the file.
+ * @param[in, out] writer - a pointer to the writer.
+ * @return Value @p false if this or an earlier write has failed. Otherwise @p true.
+ */
+bool writerFlush(Writer *writer);
+
+/** Function deletes the buffer of a writer.
+ * Collected bytes are not written, so @ref writerFlush has to be called first.
+ * The file is not closed.
+ * @param[in, out] writer - a pointer to the writer.
+ */
+void writerDestroy(Writer *writer);
+
+#endif /* __WRITER_H__ */